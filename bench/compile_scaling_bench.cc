@@ -0,0 +1,192 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+// Measures the time per term spent compiling and evaluating generated
+// expressions of growing length, from 10 terms up to a given maximum
+// (1000000 by default):
+//
+//   sum:    w0*x0 + w1*x1 + ... (a left-deep tree as long as the input)
+//   nested: (...((x0*w0 + x1)*w1 + x2)...) (as many nested brackets)
+//
+// Each expression is compiled into a bytecode program, which is run
+// without recursion, so the time per term should stay flat.
+//
+// The number of global heap allocations made by one compilation is
+// also reported, for a compiler using the heap and for one allocating
+// its nodes from an arena. The arena only holds the nodes: names,
+// argument vectors and literal values are still allocated from the
+// heap, so the arena count grows with the number of distinct names
+// and literals (16 variables and 89 weights here)
+
+#include "nu_expr_eval.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+
+/* -------------------------------------------------------------------------- */
+
+// Counts the allocations made through the global operator new
+static size_t heap_allocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++heap_allocations;
+
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static const size_t features = 16;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Weights are lower than 1, so the nested form does not overflow
+static std::string weight(size_t i)
+{
+    return "0." + std::to_string(i % 89 + 10);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static std::string make_sum(size_t terms)
+{
+    std::string s;
+
+    for (size_t i = 0; i < terms; ++i) {
+        if (i)
+            s += " + ";
+
+        s += weight(i) + "*x" + std::to_string(i % features);
+    }
+
+    return s;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static std::string make_nested(size_t terms)
+{
+    std::string s(terms - 1, '(');
+
+    s += "x0";
+
+    for (size_t i = 1; i < terms; ++i)
+        s += "*" + weight(i) + " + x" + std::to_string(i % features) + ")";
+
+    return s;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+template <class F> static double run(size_t terms, F f)
+{
+    // Repeats short expressions so each measure takes a similar time
+    const size_t reps = terms < 100000 ? 100000 / terms : 1;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < reps; ++i)
+        f();
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count()
+        / double(reps * terms);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the heap allocations made by compiling text into a program,
+// the tokenizer and the compiler being built before counting
+static size_t count_allocations(
+    const std::string& text, nu::expr_compiler_t::arena_handle_t arena)
+{
+    nu::tokenizer_t tknzr(text);
+    nu::expr_compiler_t compiler(arena);
+
+    const size_t before = heap_allocations;
+    auto program = compiler.compile_to_program(tknzr);
+
+    return heap_allocations - before;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static void measure(const char* shape, size_t terms, const std::string& text)
+{
+    nu::ctx_t ctx;
+
+    for (size_t i = 0; i < features; ++i)
+        ctx.define("x" + std::to_string(i), nu::variant_t(double(i) / 4));
+
+    nu::expr_program_t::handle_t program;
+
+    const double t_compile = run(terms, [&]() {
+        nu::tokenizer_t tknzr(text);
+        nu::expr_compiler_t compiler;
+        program = compiler.compile_to_program(tknzr);
+    });
+
+    nu::variant_t result;
+
+    const double t_eval
+        = run(terms, [&]() { result = program->run(ctx); });
+
+    const size_t heap = count_allocations(text, nullptr);
+    const size_t arena
+        = count_allocations(text, std::make_shared<nu::arena_t>());
+
+    std::cout << shape << "\t" << terms << "\t" << t_compile << "\t"
+              << t_eval << "\t" << heap << "\t" << arena << "\t"
+              << result.to_str() << std::endl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char* argv[])
+{
+    const size_t max_terms
+        = argc > 1 ? size_t(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+
+    std::cout << "shape\tterms\tcompile ns/term\teval ns/term"
+              << "\theap allocs/compile\tarena allocs/compile\tresult"
+              << std::endl;
+
+    for (size_t terms = 10; terms <= max_terms; terms *= 10) {
+        measure("sum", terms, make_sum(terms));
+        measure("nested", terms, make_nested(terms));
+    }
+
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
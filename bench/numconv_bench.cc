@@ -0,0 +1,117 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+// Compares the number conversions of nu_string_tool with the standard
+// library functions they replace
+
+#include "nu_string_tool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+template <class F> static double run(size_t n, F f)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < n; ++i)
+        f(i);
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count()
+        / double(n);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static void report(const char* what, double t_std, double t_nu)
+{
+    std::cout << what << ": std " << t_std << " ns, nu " << t_nu
+              << " ns (x" << t_std / t_nu << ")" << std::endl;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char* argv[])
+{
+    const size_t n = argc > 1 ? size_t(std::stoul(argv[1])) : 1000000;
+
+    std::mt19937_64 rnd(1);
+    std::uniform_real_distribution<double> real(-1e6, 1e6);
+
+    std::vector<double> doubles(n);
+    std::vector<long long> integers(n);
+    std::vector<std::string> real_texts(n);
+    std::vector<std::string> int_texts(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        doubles[i] = real(rnd);
+        integers[i] = (long long)(rnd() >> (rnd() % 64));
+
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*g", int(rnd() % 15) + 1,
+            doubles[i]);
+
+        real_texts[i] = buffer;
+        int_texts[i] = std::to_string(integers[i]);
+    }
+
+    size_t sink = 0;
+
+    report("to_str(double)",
+        run(n, [&](size_t i) { sink += std::to_string(doubles[i]).size(); }),
+        run(n, [&](size_t i) { sink += nu::format_fixed(doubles[i]).size(); }));
+
+    report("to_str(long64)",
+        run(n, [&](size_t i) { sink += std::to_string(integers[i]).size(); }),
+        run(n, [&](size_t i) { sink += nu::format_integer(integers[i]).size(); }));
+
+    report("strp(x, 3)",
+        run(n, [&](size_t i) {
+            char buffer[1024] = { 0 };
+            std::string format = "%." + std::to_string(3) + "f";
+            snprintf(buffer, sizeof(buffer) - 1, format.c_str(), doubles[i]);
+            sink += std::string(buffer).size();
+        }),
+        run(n, [&](size_t i) { sink += nu::format_fixed(doubles[i], 3).size(); }));
+
+    report("hex(x)",
+        run(n, [&](size_t i) {
+            std::stringstream ss;
+            ss << std::hex << int(integers[i]);
+            sink += ss.str().size();
+        }),
+        run(n, [&](size_t i) {
+            sink += nu::format_hex(unsigned(int(integers[i]))).size();
+        }));
+
+    report("stod",
+        run(n, [&](size_t i) { sink += std::stod(real_texts[i]) > 0; }),
+        run(n, [&](size_t i) { sink += nu::stod(real_texts[i]) > 0; }));
+
+    report("stoll",
+        run(n, [&](size_t i) { sink += std::stoll(int_texts[i]) > 0; }),
+        run(n, [&](size_t i) { sink += nu::stoll(int_texts[i]) > 0; }));
+
+    return sink == 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
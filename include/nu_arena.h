@@ -0,0 +1,200 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_ARENA_H__
+#define __NU_ARENA_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Monotonic memory arena.
+ * Memory is carved out of large blocks which are released all together
+ * when the arena is destroyed. Small chunks given back by deallocate()
+ * are recycled by later requests of the same size class, so containers
+ * which grow and shrink while the arena is in use (e.g. token lists)
+ * do not make it grow without bound.
+ * An arena is not thread-safe: it is meant to be used by one compilation
+ * at a time.
+ */
+class arena_t {
+public:
+    //! Size of the first block, following ones double up to MAX_BLOCK_SIZE
+    enum { DEFAULT_BLOCK_SIZE = 16 * 1024, MAX_BLOCK_SIZE = 1024 * 1024 };
+
+    explicit arena_t(size_t block_size = DEFAULT_BLOCK_SIZE) noexcept
+        : _next_block_size(block_size)
+    {
+    }
+
+    arena_t(const arena_t&) = delete;
+    arena_t& operator=(const arena_t&) = delete;
+
+    ~arena_t();
+
+    //! Returns size bytes aligned to align
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    //! Gives back memory got by allocate(size, align)
+    void deallocate(void* p, size_t size,
+        size_t align = alignof(std::max_align_t)) noexcept;
+
+    //! Returns the number of blocks allocated from the system
+    size_t blocks() const noexcept {
+        return _blocks;
+    }
+
+    //! Returns the number of bytes allocated from the system
+    size_t capacity() const noexcept {
+        return _capacity;
+    }
+
+private:
+    struct block_t {
+        block_t* next;
+    };
+
+    struct chunk_t {
+        chunk_t* next;
+    };
+
+    // Size classes 16, 32, ... 4096 bytes
+    enum { MIN_CLASS_SHIFT = 4, CLASSES = 9 };
+
+    static int size_class(size_t size, size_t align) noexcept;
+
+    void* bump(size_t size, size_t align);
+
+    block_t* _head = nullptr;
+    char* _ptr = nullptr;
+    char* _end = nullptr;
+    size_t _next_block_size;
+    size_t _blocks = 0;
+    size_t _capacity = 0;
+    chunk_t* _free[CLASSES] = {};
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Standard allocator drawing memory from an arena_t.
+ * The allocator shares the ownership of its arena, so the memory of an
+ * object created by std::allocate_shared() stays valid until the last
+ * handle to it is released, and it is given back to the system in one
+ * shot when the arena itself is destroyed.
+ * A default constructed allocator uses the global heap.
+ * An allocator created with recycle == false never gives memory back to
+ * the arena: objects it allocates may then be destroyed by any thread,
+ * while the arena is still in use by another one.
+ */
+template <class T> class arena_allocator_t {
+public:
+    using value_type = T;
+    using arena_handle_t = std::shared_ptr<arena_t>;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <class U> struct rebind {
+        using other = arena_allocator_t<U>;
+    };
+
+    arena_allocator_t() noexcept = default;
+
+    // Moving an allocator copies it, so that the source keeps its arena
+    arena_allocator_t(const arena_allocator_t&) noexcept = default;
+    arena_allocator_t& operator=(const arena_allocator_t&) noexcept = default;
+
+    arena_allocator_t(arena_handle_t arena, bool recycle = true) noexcept
+        : _arena(std::move(arena))
+        , _recycle(recycle)
+    {
+    }
+
+    template <class U>
+    arena_allocator_t(const arena_allocator_t<U>& other) noexcept
+        : _arena(other.arena())
+        , _recycle(other.recycle())
+    {
+    }
+
+    T* allocate(size_t n) {
+        if (!_arena)
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (!_arena)
+            ::operator delete(p);
+        else if (_recycle)
+            _arena->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    //! Returns the arena used, nullptr for the global heap
+    const arena_handle_t& arena() const noexcept {
+        return _arena;
+    }
+
+    //! Returns whether deallocated memory is given back to the arena
+    bool recycle() const noexcept {
+        return _recycle;
+    }
+
+private:
+    arena_handle_t _arena;
+    bool _recycle = true;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+template <class T, class U>
+bool operator==(
+    const arena_allocator_t<T>& a, const arena_allocator_t<U>& b) noexcept
+{
+    return a.arena() == b.arena();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+template <class T, class U>
+bool operator!=(
+    const arena_allocator_t<T>& a, const arena_allocator_t<U>& b) noexcept
+{
+    return !(a == b);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_ARENA_H__
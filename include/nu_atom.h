@@ -0,0 +1,123 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_ATOM_H__
+#define __NU_ATOM_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Interned immutable string.
+ * Equal strings are mapped to the same entry of a process-wide table,
+ * which stores the text once together with its hash: atoms compare by
+ * pointer and hash in constant time, so they are used as keys of the
+ * symbol tables (see symbol_map_t) and as names of variables and
+ * functions held by the syntax tree.
+ * An entry is removed from the table when its last atom is destroyed.
+ * Interning a string is thread-safe, but it hashes the string and locks
+ * a part of the table: code looking up the same name repeatedly (i.e.
+ * in a symbol table) should create its atom once and reuse it. Copying
+ * an atom is as cheap as copying a shared_ptr.
+ */
+class atom_t {
+public:
+    //! Creates the empty atom
+    atom_t() noexcept = default;
+
+    atom_t(const std::string& s);
+    atom_t(const char* s);
+
+    atom_t(const atom_t&) noexcept = default;
+    atom_t& operator=(const atom_t&) noexcept = default;
+    atom_t(atom_t&&) noexcept = default;
+    atom_t& operator=(atom_t&&) noexcept = default;
+
+    const std::string& str() const noexcept {
+        return _entry ? *_entry->str : empty_str();
+    }
+
+    operator const std::string&() const noexcept {
+        return str();
+    }
+
+    //! Returns the hash of the text, computed once at interning time
+    size_t hash() const noexcept {
+        return _entry ? _entry->hash : 0;
+    }
+
+    bool empty() const noexcept {
+        return str().empty();
+    }
+
+    //! Returns the number of distinct strings currently interned
+    static size_t interned() noexcept;
+
+    friend bool operator==(const atom_t& a, const atom_t& b) noexcept {
+        return a._entry == b._entry;
+    }
+
+    friend bool operator!=(const atom_t& a, const atom_t& b) noexcept {
+        return a._entry != b._entry;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const atom_t& a) {
+        return os << a.str();
+    }
+
+private:
+    struct entry_t {
+        // Key of the entry in the atom table: the text is stored once
+        const std::string* str;
+        size_t hash;
+    };
+
+    friend class atom_tbl_t;
+
+    static const std::string& empty_str() noexcept;
+
+    std::shared_ptr<const entry_t> _entry;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace std {
+
+template <> struct hash<nu::atom_t> {
+    size_t operator()(const nu::atom_t& a) const noexcept {
+        return a.hash();
+    }
+};
+
+} // namespace std
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_ATOM_H__
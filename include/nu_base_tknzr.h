@@ -17,6 +17,7 @@
 #include "nu_token_list.h"
 
 #include <cassert>
+#include <memory>
 #include <string>
 
 
@@ -84,9 +85,17 @@ public:
     }
 
 
-    //! Create a token object
-    static token_t make_token(size_t pos, token_t::data_ptr_t data_ptr) {
-        return token_t(pos, data_ptr);
+    //! Move the buffer pointer to cptr, e.g. to scan the tokens of
+    //! an edited part of the buffer only
+    void seek(size_t cptr) noexcept {
+        _cptr = _reach = cptr;
+    }
+
+
+    //! Return the farthest position of the buffer pointer since the last
+    //! seek(): the symbols read in the meantime are within [cptr, reach()]
+    size_t reach() const noexcept {
+        return _reach;
     }
 
 
@@ -117,15 +126,22 @@ protected:
     }
 
 
+    //! Return the input buffer
+    const std::string& text() const noexcept {
+        return *_data;
+    }
+
+
     //! Return a shared_ptr to internal data
-    token_t::data_ptr_t data() const noexcept { 
+    std::shared_ptr<std::string> data() const noexcept { 
         return _data; 
     }
 
 
 private:
     void _inc_cptr() noexcept { 
-        ++_cptr; 
+        if (++_cptr > _reach)
+            _reach = _cptr;
     }
 
     void _dec_cptr() noexcept { 
@@ -133,12 +149,13 @@ private:
     }
 
     void _rst_cptr() noexcept { 
-        _cptr = 0; 
+        _cptr = _reach = 0; 
     }
 
     std::shared_ptr<std::string> _data;
     size_t _data_len = 0;
     size_t _cptr = 0;
+    size_t _reach = 0;
 };
 
 
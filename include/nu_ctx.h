@@ -14,6 +14,7 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "nu_atom.h"
 #include "nu_symbol_map.h"
 #include "nu_variant.h"
 
@@ -23,12 +24,27 @@
 namespace nu {
 
 
+/* -------------------------------------------------------------------------- */
+
+class slot_tbl_t;
+
+
 /* -------------------------------------------------------------------------- */
 
 /**
- * This class holds the value of variables
+ * This class holds the value of variables.
+ * Variables are keyed by interned names (see atom_t). The evaluators
+ * keep the atoms of the names they refer to, so reading a variable
+ * does not intern its name; callers accessing the same variable many
+ * times should do the same instead of passing a string each time:
+ *
+ *    const atom_t price("price");
+ *    for (const auto& row : rows) {
+ *        ctx[price] = row.price;
+ *        ...
+ *    }
  */
-class ctx_t : public symbol_map_t<std::string, variant_t> {
+class ctx_t : public symbol_map_t<atom_t, variant_t> {
 public:
     using handle_t = std::shared_ptr<ctx_t>;
 
@@ -36,11 +52,20 @@ public:
     ctx_t(const ctx_t&) = default;
     ctx_t& operator=(const ctx_t&) = default;
     
-    bool define(const std::string& name, const variant_t& value) {
+    bool define(const atom_t& name, const variant_t& value) {
         map()[name] = value;
         return true;
     }
 
+    //! Returns the variable bound to slot idx of a given slot table or
+    //! nullptr if such slot is not provided by this context.
+    //! (see slot_ctx_t)
+    virtual variant_t* slot(const slot_tbl_t* tbl, size_t idx) {
+        (void)tbl;
+        (void)idx;
+        return nullptr;
+    }
+
     friend std::stringstream& operator<<(std::stringstream& ss, ctx_t& obj)  {
         for (const auto& e : obj.map()) {
             ss << "\t" << e.first << ": "
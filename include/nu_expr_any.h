@@ -37,13 +37,47 @@ struct expr_any_t {
     using handle_t = std::shared_ptr<expr_any_t>;
     using func_args_t = std::vector<expr_any_t::handle_t>;
 
+    //! Evaluates the expression.
+    //! Trees are evaluated by native recursion, one call per level of
+    //! nesting, so the depth of an expression evaluated this way is
+    //! limited by the thread stack (roughly tens of thousands of nested
+    //! operators). Very long or deeply nested expressions should be
+    //! evaluated by expr_program_t or expr_flat_t, which use explicit
+    //! stacks
     virtual variant_t eval(ctx_t& ctx) const = 0;
+
+    //! Evaluates the expression storing the result into out
+    virtual void eval_into(ctx_t& ctx, variant_t& out) const {
+        out = eval(ctx);
+    }
+
+    //! Returns a reference to the value of the expression.
+    //! Literals and variables return the value they refer to, which is
+    //! valid until ctx or the expression change, avoiding any copy.
+    //! Other expressions evaluate into tmp and return it
+    virtual const variant_t& eval_ref(ctx_t& ctx, variant_t& tmp) const {
+        eval_into(ctx, tmp);
+        return tmp;
+    }
+
     virtual bool empty() const noexcept = 0;
 
     virtual std::string name() const noexcept = 0;
     virtual func_args_t get_args() const noexcept = 0;
 
     virtual ~expr_any_t() {}
+
+protected:
+    //! Releases operand, a child of a node being destroyed.
+    //! Nodes released while another one is being destroyed are queued
+    //! and destroyed one after another by the outermost call, so that
+    //! deep trees are released without recursion
+    static void release(handle_t& operand);
+
+    static void release(func_args_t& operands) {
+        for (auto& operand : operands)
+            release(operand);
+    }
 };
 
 
@@ -15,6 +15,8 @@
 /* -------------------------------------------------------------------------- */
 
 #include "nu_expr_any.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_var.h"
 #include "nu_global_function_tbl.h"
 
 
@@ -29,11 +31,25 @@ class expr_bin_t : public expr_any_t {
 public:
     using func_t = func_bin_t;
 
-    //! ctor
+    //! ctor (built-in operator)
+    expr_bin_t(
+        bin_opcode_t op, expr_any_t::handle_t var1, expr_any_t::handle_t var2)
+        : _op(op)
+        , _var1(var1)
+        , _var2(var2)
+        , _borrow_right(can_borrow(var1, var2))
+        , _chain(is_chain(op, var1))
+    {
+    }
+
+    //! ctor (operator implemented by f)
     expr_bin_t(func_t f, expr_any_t::handle_t var1, expr_any_t::handle_t var2)
-        : _func(f)
+        : _op(bin_opcode_t::CUSTOM)
+        , _func(f)
         , _var1(var1)
         , _var2(var2)
+        , _borrow_right(can_borrow(var1, var2))
+        , _chain(false)
     {
     }
 
@@ -42,9 +58,40 @@ public:
     expr_bin_t(const expr_bin_t&) = default;
     expr_bin_t& operator=(const expr_bin_t&) = default;
 
-    //! Returns f(var1, var2) appling ctor given arguments
+    ~expr_bin_t() {
+        release(_var1);
+        release(_var2);
+    }
+
+    //! Returns f(var1, var2) appling ctor given arguments.
+    //! The right operand is evaluated first
     variant_t eval(ctx_t& ctx) const override {
-        return _func(_var1->eval(ctx), _var2->eval(ctx));
+        if (_chain) {
+            variant_t ret;
+            eval_chain(ctx, ret, 0);
+            return ret;
+        }
+
+        variant_t tb, ta;
+
+        // Literal and variable operands are read in place
+        if (!_borrow_right)
+            _var2->eval_into(ctx, tb);
+
+        const auto& b = _borrow_right ? _var2->eval_ref(ctx, tb) : tb;
+        const auto& a = _var1->eval_ref(ctx, ta);
+
+        if (_op == bin_opcode_t::CUSTOM)
+            return _func(a, b);
+
+        return global_operator_tbl_t::apply(_op, a, b);
+    }
+
+    void eval_into(ctx_t& ctx, variant_t& out) const override {
+        if (_chain)
+            eval_chain(ctx, out, 0);
+        else
+            out = eval(ctx);
     }
 
     //! Returns false for a binary expression
@@ -80,10 +127,84 @@ public:
         return ret;
     }
 
+    //! Returns the operator opcode (CUSTOM if it is not built-in)
+    bin_opcode_t opcode() const noexcept {
+        return _op;
+    }
+
+    //! Returns the implementation of a CUSTOM operator
+    const func_t& func() const noexcept {
+        return _func;
+    }
+
+    //! Returns the left operand
+    const expr_any_t::handle_t& left() const noexcept {
+        return _var1;
+    }
+
+    //! Returns the right operand
+    const expr_any_t::handle_t& right() const noexcept {
+        return _var2;
+    }
+
 
 protected:
+    // The right operand, evaluated first, is borrowed only if evaluating
+    // the left one cannot change it (e.g. "++x + x" must not)
+    static bool can_borrow(const expr_any_t::handle_t& left,
+        const expr_any_t::handle_t& right) noexcept
+    {
+        auto literal = [](const expr_any_t::handle_t& e) {
+            return dynamic_cast<const expr_literal_t*>(e.get()) != nullptr;
+        };
+
+        return literal(left) || literal(right)
+            || dynamic_cast<const expr_var_t*>(left.get()) != nullptr;
+    }
+
+    // True for the last "+" of a chain (((a + b) + c) + ...)
+    static bool is_chain(
+        bin_opcode_t op, const expr_any_t::handle_t& left) noexcept
+    {
+        auto bin = dynamic_cast<const expr_bin_t*>(left.get());
+        return op == bin_opcode_t::ADD && bin && bin->_op == bin_opcode_t::ADD;
+    }
+
+    // Evaluates a chain of "+" into out, appending each operand to the
+    // result of the preceding ones in place.
+    // The right operands are evaluated first, as eval() does, so when
+    // the leftmost one is reached the size of a concatenation of strings
+    // is known (size of the operands on its right is tail) and the result
+    // is allocated once
+    void eval_chain(ctx_t& ctx, variant_t& out, size_t tail) const {
+        variant_t tb;
+
+        if (!_borrow_right)
+            _var2->eval_into(ctx, tb);
+
+        const auto& b = _borrow_right ? _var2->eval_ref(ctx, tb) : tb;
+
+        if (b.is_scalar_str())
+            tail += b.to_str().size();
+
+        if (_chain) {
+            static_cast<const expr_bin_t*>(_var1.get())
+                ->eval_chain(ctx, out, tail);
+        } else {
+            _var1->eval_into(ctx, out);
+
+            if (out.is_scalar_str())
+                out.reserve_str(out.to_str().size() + tail);
+        }
+
+        out += b;
+    }
+
+    bin_opcode_t _op;
     func_bin_t _func;
     expr_any_t::handle_t _var1, _var2;
+    bool _borrow_right;
+    bool _chain;
 };
 
 
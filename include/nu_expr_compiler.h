@@ -14,13 +14,20 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "nu_arena.h"
 #include "nu_exception.h"
 #include "nu_expr_any.h"
+#include "nu_expr_program.h"
 #include "nu_expr_tknzr.h"
 #include "nu_token_list.h"
 #include "nu_ctx.h"
 
+#include <cstdint>
 #include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 /* -------------------------------------------------------------------------- */
@@ -32,8 +39,41 @@ namespace nu {
 
 class expr_compiler_t {
 public:
+    using arena_handle_t = std::shared_ptr<arena_t>;
+
     //! ctors
     expr_compiler_t() = default;
+
+    //! Creates a compiler which allocates the token lists and the nodes
+    //! of the compiled expressions from arena.
+    //! The arena is released when both the compiler and all the
+    //! expressions it has created are destroyed. The nodes never give
+    //! memory back to the arena, so expressions may be released by any
+    //! thread, but the arena keeps growing while the compiler uses it:
+    //! a long-lived compiler should use one arena per batch of
+    //! expressions (see set_arena()).
+    //! Only the nodes and their shared_ptr control blocks are allocated
+    //! from the arena; names, argument vectors, binary operator
+    //! functions and the strings and vectors of literal values still
+    //! use the global heap
+    explicit expr_compiler_t(arena_handle_t arena)
+        : _arena(std::move(arena))
+    {
+    }
+
+    //! Makes the following compilations allocate from arena (nullptr
+    //! for the global heap). The compiler drops its reference to the
+    //! previous arena, which is released as soon as the last
+    //! expression allocated from it is destroyed
+    void set_arena(arena_handle_t arena) noexcept {
+        _arena = std::move(arena);
+    }
+
+    //! Returns the arena in use, nullptr for the global heap
+    const arena_handle_t& arena() const noexcept {
+        return _arena;
+    }
+
     expr_compiler_t(const expr_compiler_t&) = delete;
     expr_compiler_t& operator=(const expr_compiler_t&) = delete;
 
@@ -43,21 +83,153 @@ public:
     //! Creates an expression using a given token-list
     expr_any_t::handle_t compile(token_list_t tl, size_t expr_pos);
 
+    //! Creates an expression and lowers it into a bytecode program
+    expr_program_t::handle_t compile_to_program(expr_tknzr_t& tknzr);
 
-protected:
-    static variant_t::type_t get_type(const token_t& t);
+    class compilation_t;
 
-    expr_any_t::handle_t parse_operand(token_list_t& tl);
+    //! Creates an expression using tokens got by a given tokenizer,
+    //! keeping in c what recompile() needs to update it once the
+    //! expression text is edited
+    expr_any_t::handle_t compile(expr_tknzr_t& tknzr, compilation_t& c);
 
-    bool parse_operator(token_list_t& tl, std::string& value);
+    //! Updates the expression of c after the characters [pos, pos+erased)
+    //! of its text have been replaced by inserted characters. tknzr is
+    //! a tokenizer of the edited text, configured as the one c has been
+    //! compiled with. Only the tokens the edit may have changed are
+    //! scanned again and only the subtrees enclosing it are rebuilt: the
+    //! result is the expression (or the syntax error) compile() gives
+    //! for the edited text
+    expr_any_t::handle_t recompile(expr_tknzr_t& tknzr, compilation_t& c,
+        size_t pos, size_t erased, size_t inserted);
 
-    expr_any_t::handle_t parse(
-        token_list_t& tl, expr_any_t::handle_t first_param = nullptr);
 
-    static void reduce_brackets(token_list_t& rtl);
+protected:
+    class cursor_t;
+    class parser_t;
+
+    static variant_t::type_t get_type(
+        const token_list_t& tl, const token_t& t);
+
+    //! Parses the expression tl into a new expression tree. If c is not
+    //! null, tl are its tokens: the parser resumes from its last state
+    //! saved, reuses its subtrees and saves new ones
+    expr_any_t::handle_t parse_tree(
+        token_list_t& tl, compilation_t* c = nullptr);
+
+    //! Creates the node of binary operator op of tl.
+    //! bare_left and bare_right point to the tokens the operands were
+    //! made of, if they are literals not enclosed in brackets
+    expr_any_t::handle_t make_binary(const token_list_t& tl, const token_t& op,
+        expr_any_t::handle_t left, expr_any_t::handle_t right,
+        const token_t* bare_left, const token_t* bare_right);
+
+    //! Returns the literal node for text of the given type. Identical
+    //! literals of the same expression share one immutable node
+    expr_any_t::handle_t make_literal(
+        const std::string& text, variant_t::type_t type);
+
     static void convert_subscription_brackets(token_list_t& rtl);
 
-    static void fix_real_numbers(token_list_t& rtl);
+    //! Creates a node of the expression tree
+    template <class T, class... Args>
+    std::shared_ptr<T> make_node(Args&&... args) const {
+        if (!_arena)
+            return std::make_shared<T>(std::forward<Args>(args)...);
+
+        return std::allocate_shared<T>(
+            arena_allocator_t<T>(_arena, false), std::forward<Args>(args)...);
+    }
+
+private:
+    using literal_t = std::pair<variant_t::type_t, expr_any_t::handle_t>;
+
+    arena_handle_t _arena;
+    std::unordered_multimap<atom_t, literal_t> _literals;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Compilation of an expression whose text is being edited (e.g. by
+ * a formula editor), which expr_compiler_t::recompile() updates after
+ * each edit.
+ * Besides the tokens, it keeps what an edit may leave valid: the range
+ * of text read to scan each token, the subtrees of the sub-expressions
+ * enclosed in brackets and of the function calls, and the state of the
+ * parser every few tokens. Subtrees are immutable, so they are shared
+ * by the expressions created from the compilation.
+ * The compilation remains valid if the edited text has a syntax error,
+ * so that it can be updated after the next edit. The built-in function
+ * and operator tables are expected not to change in the meantime.
+ */
+class expr_compiler_t::compilation_t {
+public:
+    compilation_t() = default;
+    compilation_t(const compilation_t&) = delete;
+    compilation_t& operator=(const compilation_t&) = delete;
+
+    //! Returns the tokens of the expression text
+    const token_list_t& tokens() const noexcept {
+        return _tl;
+    }
+
+private:
+    friend class expr_compiler_t;
+
+    // A token is scanned from the end of the previous one up to end.
+    // reach is the farthest position read to scan it or any token
+    // preceding it, so tokens whose reach is before an edit are valid
+    struct extent_t {
+        uint32_t end;
+        uint32_t reach;
+    };
+
+    // Subtree made of the tokens [first, last]: either a sub-expression
+    // enclosed in brackets (first is its "(") or a function call (first
+    // is the function name). trailing is true if it is part of an
+    // argument following the first one of a function call
+    struct subtree_t {
+        size_t first;
+        size_t last;
+        expr_any_t::handle_t node;
+        bool trailing;
+    };
+
+    // State of the parser before reading an operand
+    struct checkpoint_t;
+
+    // Scans the whole text of tknzr
+    void scan(expr_tknzr_t& tknzr);
+
+    // Scans the tokens of the edited text which may have changed, and
+    // drops the subtrees and the states the edit invalidates.
+    // Returns false if the edit does not match the text, which is then
+    // to be scanned again
+    bool rescan(
+        expr_tknzr_t& tknzr, size_t pos, size_t erased, size_t inserted);
+
+    // Returns the subtree beginning with token first, or nullptr
+    const subtree_t* find_subtree(size_t first) const noexcept;
+
+    // Adds the subtrees created by the last parse to _subtrees
+    void merge_subtrees();
+
+    bool _scanned = false;
+    size_t _exp_pos = 0;
+    size_t _size = 0;
+
+    token_list_t _tl;
+    std::vector<extent_t> _extents;
+
+    // Subtrees sorted by first token, and the ones created by the
+    // last parse
+    std::vector<subtree_t> _subtrees;
+    std::vector<subtree_t> _new_subtrees;
+
+    // States sorted by token index
+    std::vector<std::shared_ptr<const checkpoint_t>> _checkpoints;
 };
 
 
@@ -0,0 +1,53 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_CONST_FOLDER_H__
+#define __NU_EXPR_CONST_FOLDER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_rewriter.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Constant folding pass.
+ * Built-in operators and pure built-in functions (see
+ * global_function_tbl_t::is_pure()) whose arguments are all literals
+ * are evaluated once and replaced by an expr_literal_t holding the
+ * result. A subtree whose evaluation fails (i.e. "1/0") is left as it
+ * is, so the error is still raised at run-time.
+ */
+class expr_const_folder_t : public expr_rewriter_t {
+public:
+    //! Returns true if evaluating expr has no side effects and
+    //! its result depends on the variables it refers only
+    static bool is_pure(const expr_any_t::handle_t& expr);
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_CONST_FOLDER_H__
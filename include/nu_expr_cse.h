@@ -0,0 +1,178 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_CSE_H__
+#define __NU_EXPR_CSE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Counter of the evaluations of an expression, shared by its
+//! expr_cached_t nodes
+using eval_epoch_t = std::shared_ptr<std::uint64_t>;
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Sub-expression shared by several parents. It is evaluated once per
+//! evaluation of the whole expression (see expr_cse_root_t)
+class expr_cached_t : public expr_any_t {
+public:
+    expr_cached_t(expr_any_t::handle_t expr, eval_epoch_t epoch)
+        : _expr(expr)
+        , _epoch(epoch)
+    {
+    }
+
+    variant_t eval(ctx_t& ctx) const override {
+        return refresh(ctx);
+    }
+
+    const variant_t& eval_ref(ctx_t& ctx, variant_t&) const override {
+        return refresh(ctx);
+    }
+
+    bool empty() const noexcept override {
+        return _expr->empty();
+    }
+
+    std::string name() const noexcept override {
+        return _expr->name();
+    }
+
+    func_args_t get_args() const noexcept override {
+        return _expr->get_args();
+    }
+
+    //! Returns the shared sub-expression
+    const expr_any_t::handle_t& expr() const noexcept {
+        return _expr;
+    }
+
+private:
+    const variant_t& refresh(ctx_t& ctx) const {
+        if (_seen != *_epoch) {
+            _expr->eval_into(ctx, _value);
+            _seen = *_epoch;
+        }
+
+        return _value;
+    }
+
+    expr_any_t::handle_t _expr;
+    eval_epoch_t _epoch;
+    mutable std::uint64_t _seen = 0;
+    mutable variant_t _value;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Root of an expression containing expr_cached_t nodes: each
+//! evaluation starts a new epoch, invalidating the cached values
+class expr_cse_root_t : public expr_any_t {
+public:
+    expr_cse_root_t(expr_any_t::handle_t expr, eval_epoch_t epoch)
+        : _expr(expr)
+        , _epoch(epoch)
+    {
+    }
+
+    variant_t eval(ctx_t& ctx) const override {
+        ++*_epoch;
+        return _expr->eval(ctx);
+    }
+
+    void eval_into(ctx_t& ctx, variant_t& out) const override {
+        ++*_epoch;
+        _expr->eval_into(ctx, out);
+    }
+
+    bool empty() const noexcept override {
+        return _expr->empty();
+    }
+
+    std::string name() const noexcept override {
+        return _expr->name();
+    }
+
+    func_args_t get_args() const noexcept override {
+        return _expr->get_args();
+    }
+
+private:
+    expr_any_t::handle_t _expr;
+    eval_epoch_t _epoch;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Common subexpression elimination.
+ * Structurally identical subtrees are merged (hash-consing), turning the
+ * tree into a DAG. Subtrees referred by more than one parent are wrapped
+ * into an expr_cached_t, so that they are evaluated once per evaluation.
+ *
+ * Expressions with side effects (i.e. "++x" or "rnd(0)", see
+ * expr_const_folder_t::is_pure()) are returned unchanged, since the
+ * values of repeated subtrees may differ.
+ * Cached values make the returned expression unsuitable for concurrent
+ * evaluation by different threads.
+ */
+class expr_cse_t {
+public:
+    //! Applies the pass and returns the (possibly new) expression
+    expr_any_t::handle_t operator()(const expr_any_t::handle_t& expr);
+
+private:
+    using id_t = size_t;
+
+    struct node_t {
+        expr_any_t::handle_t expr;
+        std::vector<id_t> children;
+        size_t parents = 0;
+        expr_any_t::handle_t shared;
+    };
+
+    id_t intern(const expr_any_t::handle_t& expr);
+    std::string key(const expr_any_t::handle_t& expr) const;
+    expr_any_t::handle_t build(id_t id, const eval_epoch_t& epoch);
+
+    std::unordered_map<std::string, id_t> _ids;
+    std::vector<node_t> _nodes;
+    bool _cached = false;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_CSE_H__
@@ -0,0 +1,141 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_EGRAPH_H__
+#define __NU_EXPR_EGRAPH_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_type_inference.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Equality saturation optimizer.
+ * The expression is loaded into an e-graph, a set of equivalence classes
+ * of expressions sharing their sub-expressions, which is saturated by
+ * applying algebraic rules until no new equivalence is found (or a node
+ * or iteration limit is reached). The cheapest expression of the root
+ * class, according to node_cost(), is then extracted.
+ *
+ * Rules:
+ *   a+b = b+a, a*b = b*a          numeric a and b
+ *   (a+b)+c = a+(b+c), same for *  integral a, b and c, or fast_math
+ *   a*b+a*c = a*(b+c)             integral operands, or fast_math
+ *   log(exp(a)) = a               fast_math
+ *   exp(log(a)) = a               fast_math
+ *   exp(a)*exp(b) = exp(a+b)      fast_math
+ * Operators whose operands are constant are folded.
+ *
+ * Types are inferred as expr_type_inference_t does, so variables
+ * should be declared by bind(). Expressions with side effects are
+ * returned unchanged. Sub-expressions may be evaluated in a different
+ * order, so if more of them fail, a different error may be reported.
+ *
+ *    expr_egraph_t egraph;
+ *    egraph.bind("n", variant_t::type_t::LONG64);
+ *    auto expr = egraph(compiled_expr);
+ */
+class expr_egraph_t {
+public:
+    using type_t = variant_t::type_t;
+
+    explicit expr_egraph_t(bool fast_math = false, size_t max_nodes = 10000,
+        size_t max_iterations = 16)
+        : _fast_math(fast_math)
+        , _max_nodes(max_nodes)
+        , _max_iterations(max_iterations)
+    {
+    }
+
+    virtual ~expr_egraph_t() {}
+
+    //! Declares that variable name always holds a value of type t
+    void bind(const std::string& name, type_t t) {
+        _types.bind(name, t);
+    }
+
+    //! Returns the cheapest expression equivalent to expr
+    expr_any_t::handle_t operator()(const expr_any_t::handle_t& expr);
+
+protected:
+    //! Cost of an operator, its operands excluded
+    virtual double_t node_cost(bin_opcode_t op) const;
+
+    //! Cost of a call of built-in function name, its arguments excluded
+    virtual double_t node_cost(const std::string& name) const;
+
+    //! Cost of a leaf: literal, variable or opaque expression
+    virtual double_t leaf_cost(const expr_any_t::handle_t& expr) const;
+
+private:
+    struct enode_t {
+        enum class kind_t { LEAF, BIN, CALL } kind = kind_t::LEAF;
+        bin_opcode_t op = bin_opcode_t::CUSTOM;
+        std::string name;
+        std::vector<size_t> args;
+        size_t leaf = 0;
+        size_t seq = 0;
+    };
+
+    struct eclass_t {
+        std::vector<enode_t> nodes;
+        type_t type = type_t::UNDEFINED;
+        bool has_value = false;
+        variant_t value;
+    };
+
+    void clear();
+    size_t find(size_t id) const;
+    bool merge(size_t a, size_t b);
+    void rebuild();
+    std::string key_of(const enode_t& node) const;
+    size_t add(enode_t node);
+    size_t add_leaf(const expr_any_t::handle_t& expr);
+    size_t add_bin(bin_opcode_t op, size_t a, size_t b);
+    size_t add_call(const std::string& name, size_t arg);
+    size_t load(const expr_any_t::handle_t& expr);
+    bool apply_rules(size_t id, const enode_t& node);
+    bool is_integral(size_t id) const;
+    bool is_number(size_t id) const;
+    expr_any_t::handle_t extract(size_t root);
+
+    bool _fast_math;
+    size_t _max_nodes;
+    size_t _max_iterations;
+    expr_type_inference_t _types;
+
+    mutable std::vector<size_t> _parent;
+    std::vector<eclass_t> _classes;
+    std::unordered_map<std::string, size_t> _memo;
+    std::vector<expr_any_t::handle_t> _leaves;
+    size_t _node_count = 0;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_EGRAPH_H__
@@ -0,0 +1,149 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_FLAT_H__
+#define __NU_EXPR_FLAT_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+#include "nu_expr_function.h"
+#include "nu_expr_var.h"
+#include "nu_global_function_tbl.h"
+#include "nu_ctx.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Flat representation of an expression tree.
+ * The nodes are stored in a single contiguous array, in the order the
+ * tree interpreter evaluates them (right operand first, arguments left
+ * to right, the root last), and refer to their operands by 32-bit
+ * indices. They are evaluated by a loop over the array and a switch
+ * over the node kind, pushing their values on a stack: there are no
+ * virtual calls, no copies of shared_ptr and no native recursion, so
+ * very long expressions can be evaluated too. The arguments of calls
+ * and the nodes evaluated by the tree interpreter are still evaluated
+ * recursively (see expr_program_t).
+ *
+ * Calls of built-in math functions are evaluated in place; other
+ * built-in functions receive their original argument expressions.
+ * Nodes without a flat form (i.e. unary operators or variable
+ * subscriptions) are evaluated by the tree interpreter.
+ *
+ *    auto flat = std::make_shared<expr_flat_t>(compiled_expr);
+ *    auto value = flat->eval(ctx);
+ */
+class expr_flat_t : public expr_any_t {
+public:
+    enum class kind_t : std::uint8_t {
+        LITERAL,   // consts[aux]
+        VAR,       // vars[aux]
+        BINARY,    // a <built-in operator op> b
+        BINARY_FN, // binops[aux](a, b)
+        MATH,      // calls[aux].fn(a)
+        MATH2,     // calls[aux].fn2(a, b)
+        CALL,      // calls[aux].func(calls[aux].args)
+        TREE       // trees[aux]->eval(ctx)
+    };
+
+    //! op of a VAR node whose value is copied, since the nodes following
+    //! it may modify the variable before its value is used
+    enum { COPY = 1 };
+
+    struct node_t {
+        kind_t kind;
+        std::uint8_t op;
+        std::uint32_t a, b;
+        std::uint32_t aux;
+    };
+
+    //! Builds the flat representation of expr
+    explicit expr_flat_t(const expr_any_t::handle_t& expr);
+
+    expr_flat_t(const expr_flat_t&) = delete;
+    expr_flat_t& operator=(const expr_flat_t&) = delete;
+
+    variant_t eval(ctx_t& ctx) const override;
+
+    bool empty() const noexcept override {
+        return false;
+    }
+
+    std::string name() const noexcept override {
+        return "";
+    }
+
+    func_args_t get_args() const noexcept override {
+        func_args_t dummy;
+        return dummy;
+    }
+
+    //! Returns the node array
+    const std::vector<node_t>& nodes() const noexcept {
+        return _nodes;
+    }
+
+    //! Writes a human readable listing of the nodes
+    void dump(std::ostream& os) const;
+
+protected:
+    struct call_t {
+        std::shared_ptr<const expr_function_t> func;
+        func_args_t args;
+        global_function_tbl_t::math_fn_t fn = nullptr;
+        global_function_tbl_t::math_fn2_t fn2 = nullptr;
+    };
+
+    //! Operands of expressions needing up to this number of values
+    //! at a time are stored without any heap allocation
+    enum { SMALL_STACK_SIZE = 16 };
+
+    void flatten(const expr_any_t::handle_t& expr);
+
+    std::uint32_t add_node(kind_t kind, std::uint32_t aux,
+        std::uint32_t a = 0, std::uint32_t b = 0, std::uint8_t op = 0);
+
+    //! Calls the built-in function of a math node with values
+    //! which are not numbers, so that it reports the error
+    variant_t call_with(ctx_t& ctx, const call_t& call, const variant_t& x,
+        const variant_t* y = nullptr) const;
+
+private:
+    std::vector<node_t> _nodes;
+    std::vector<variant_t> _consts;
+    std::vector<std::shared_ptr<const expr_var_t>> _vars;
+    std::vector<func_bin_t> _binops;
+    std::vector<call_t> _calls;
+    std::vector<expr_any_t::handle_t> _trees;
+    size_t _stack_size = 0;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_FLAT_H__
@@ -26,20 +26,22 @@ namespace nu {
 
 /* -------------------------------------------------------------------------- */
 
-//! This class represents a function-call expression
+//! This class represents a function-call expression.
+//! The name is bound to a built-in function when the object is created,
+//! otherwise it is evaluated as subscription of the array variable name
 class expr_function_t : public expr_any_t {
 public:
     //! ctor
-    expr_function_t(const std::string& name, func_args_t var) noexcept
-        : _name(name),
-          _var(var)
-    {
-    }
+    expr_function_t(const atom_t& name, func_args_t var);
 
     expr_function_t() = delete;
     expr_function_t(const expr_function_t&) = default;
     expr_function_t& operator=(const expr_function_t&) = default;
 
+    ~expr_function_t() {
+        release(_var);
+    }
+
     //! Evaluates the function (using name and arguments given to the ctor)
     variant_t eval(ctx_t& ctx) const override;
 
@@ -56,10 +58,23 @@ public:
         return _var; 
     }
 
+    //! Returns true if the name is bound to a built-in function
+    bool is_builtin() const noexcept {
+        return _fptr || _func;
+    }
+
+    //! Calls the bound built-in function passing it args
+    variant_t call(ctx_t& ctx, const func_args_t& args) const {
+        return _fptr ? _fptr(ctx, _name.str(), args)
+                     : (*_func)(ctx, _name.str(), args);
+    }
+
 
 protected:
-    std::string _name;
+    atom_t _name;
     func_args_t _var;
+    func_ptr_t _fptr;
+    const func_t* _func;
 };
 
 
@@ -55,6 +55,15 @@ public:
         return _val;
     }
 
+    void eval_into(ctx_t&, variant_t& out) const override {
+        out = _val;
+    }
+
+    //! Return the literal value, with no copy
+    const variant_t& eval_ref(ctx_t&, variant_t&) const override {
+        return _val;
+    }
+
     //! Return false for this expression type
     virtual bool empty() const noexcept override { 
         return false; 
@@ -69,6 +78,11 @@ public:
         return dummy;
     }
 
+    //! Return the literal value
+    const variant_t& value() const noexcept {
+        return _val;
+    }
+
 protected:
     variant_t _val;
 };
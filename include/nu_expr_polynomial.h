@@ -0,0 +1,95 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_POLYNOMIAL_H__
+#define __NU_EXPR_POLYNOMIAL_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_type_inference.h"
+
+#include <string>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Polynomial recognition pass.
+ * Sums of terms like "a*x^4 + b*x^3 - x^2 + 3*x + 1", where x is a
+ * variable declared DOUBLE by bind(), are replaced by an
+ * expr_double_poly_t which evaluates them in Horner form, or in Estrin
+ * form if the degree is at least estrin_degree.
+ * Coefficients can be numeric literals or pure expressions which do not
+ * refer to x (i.e. other variables); they are summed per degree.
+ * Terms are matched on the compiled tree, so the pass should be applied
+ * before expr_simplifier_t and expr_type_inference_t.
+ * Only polynomials of degree 2 or more made of at least two terms are
+ * replaced.
+ *
+ * The result is DOUBLE, as the one of the original expression, but its
+ * rounding differs (products are fused and terms are reassociated), so
+ * the pass should be applied only where this is acceptable:
+ *
+ *    expr_polynomial_t poly;
+ *    poly.bind("x", variant_t::type_t::DOUBLE);
+ *    poly.bind("a", variant_t::type_t::DOUBLE);
+ *    auto expr = poly(compiled_expr);
+ */
+class expr_polynomial_t : public expr_rewriter_t {
+public:
+    using type_t = variant_t::type_t;
+
+    explicit expr_polynomial_t(size_t estrin_degree = 16)
+        : _estrin_degree(estrin_degree)
+    {
+    }
+
+    //! Declares that variable name always holds a value of type t
+    void bind(const std::string& name, type_t t) {
+        _types.bind(name, t);
+    }
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+
+private:
+    //! k * factors * x^degree
+    struct term_t {
+        double_t k = 1;
+        size_t degree = 0;
+        std::vector<expr_typed_t::typed_handle_t> factors;
+    };
+
+    bool parse_sum(const expr_any_t::handle_t& expr, const std::string& x,
+        double_t sign, std::vector<term_t>& terms) const;
+
+    bool parse_term(const expr_any_t::handle_t& expr, const std::string& x,
+        term_t& term) const;
+
+    size_t _estrin_degree;
+    expr_type_inference_t _types;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_POLYNOMIAL_H__
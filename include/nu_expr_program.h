@@ -0,0 +1,150 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_PROGRAM_H__
+#define __NU_EXPR_PROGRAM_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+#include "nu_expr_function.h"
+#include "nu_expr_var.h"
+#include "nu_global_function_tbl.h"
+#include "nu_ctx.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * An expr_program_t is a flat register-based bytecode obtained by lowering
+ * an expression tree. Instructions are executed by a single dispatch loop
+ * instead of recursive virtual eval() calls. Literals and variables are
+ * addressed in place, so only intermediate results occupy a register.
+ * Variables are read through expr_var_t::lookup(), so slot-bound ones
+ * (see expr_slot_binder_t) are resolved without hashing their names.
+ *
+ * Nodes the bytecode has no instruction for (i.e. unary operators or
+ * variable subscriptions) are executed through the tree interpreter,
+ * which remains the reference backend: operands are evaluated in its
+ * order (the right operand of a binary operator first, the arguments
+ * of a function in order), and a variable which would be read after
+ * code with possible side effects is loaded into a register in advance.
+ *
+ * Lowering walks the tree with an explicit stack, so programs for very
+ * deep trees (e.g. generated sums of a million terms) are built and run
+ * without native recursion.
+ *
+ * A program owns its register file, which run() overwrites, so run() is
+ * not const: a program must not be run concurrently by different threads
+ * (compile one program per thread instead).
+ */
+class expr_program_t {
+public:
+    using handle_t = std::shared_ptr<expr_program_t>;
+
+    enum class opcode_t : std::uint8_t {
+        BINARY,     // dst = a <built-in operator aux> b
+        BINARY_FN,  // dst = binop[aux](a, b)
+        CALL,       // dst = function[aux](args[aux]), args read registers
+        LOAD,       // dst = a
+        EVAL_TREE,  // dst = tree[aux]->eval(ctx)
+        RET         // return a
+    };
+
+    struct operand_t {
+        enum class kind_t : std::uint8_t { REG, CONST, VAR };
+
+        operand_t(kind_t k = kind_t::REG, std::uint32_t i = 0) noexcept
+            : kind(k)
+            , idx(i)
+        {
+        }
+
+        kind_t kind;
+        std::uint32_t idx;
+    };
+
+    struct instr_t {
+        opcode_t op;
+        std::uint32_t dst;
+        operand_t a, b;
+        std::uint32_t aux;
+    };
+
+    //! Lowers the expression tree into a program
+    explicit expr_program_t(const expr_any_t::handle_t& expr);
+
+    expr_program_t() = delete;
+    expr_program_t(const expr_program_t&) = delete;
+    expr_program_t& operator=(const expr_program_t&) = delete;
+
+    //! Executes the program using ctx for resolving variables.
+    //! Registers are overwritten, so the program is modified
+    variant_t run(ctx_t& ctx);
+
+    //! Returns the instruction list
+    const std::vector<instr_t>& code() const noexcept {
+        return _code;
+    }
+
+    //! Returns the number of registers used by the program
+    size_t register_count() const noexcept {
+        return _regs.size();
+    }
+
+    //! Writes a human readable listing of the program
+    void dump(std::ostream& os) const;
+
+protected:
+    struct call_t {
+        std::shared_ptr<const expr_function_t> func;
+        func_args_t args;
+    };
+
+    operand_t lower(const expr_any_t::handle_t& expr, std::uint32_t& top);
+
+    std::uint32_t alloc_reg(std::uint32_t& top);
+
+    void emit(opcode_t op, std::uint32_t dst,
+        operand_t a = operand_t(), operand_t b = operand_t(),
+        std::uint32_t aux = 0);
+
+    const variant_t& fetch(ctx_t& ctx, const operand_t& o) const;
+
+    std::vector<instr_t> _code;
+    std::vector<variant_t> _consts;
+    std::vector<std::shared_ptr<const expr_var_t>> _vars;
+    std::vector<func_bin_t> _binops;
+    std::vector<call_t> _calls;
+    std::vector<expr_any_t::handle_t> _trees;
+
+    std::vector<variant_t> _regs;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_PROGRAM_H__
@@ -0,0 +1,113 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_RANGE_ANALYSIS_H__
+#define __NU_EXPR_RANGE_ANALYSIS_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_type_inference.h"
+
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Value range analysis pass.
+ * The range of the values each sub-expression can produce is computed
+ * by interval arithmetic from literals, from the ranges of variables
+ * declared by bind() and from the known ranges of built-in functions
+ * (i.e. sin(x) is in [-1, 1], x^2 and sqrt(x) are not negative).
+ * Divisions ("/", "div", "mod") whose operand types are known and
+ * whose divisor range does not include zero (i.e. "y / (1 + x^2)") are
+ * replaced by typed expressions which do not check the divisor.
+ *
+ * Bounds are computed with the same floating point operations the
+ * expression performs, which are monotonic, so they hold for the
+ * computed values too. NaN values are never equal to zero and are not
+ * tracked.
+ *
+ * The pass should be applied before expr_type_inference_t, which
+ * handles the rest of the expression:
+ *
+ *    expr_range_analysis_t ranges;
+ *    ranges.bind("x", variant_t::type_t::DOUBLE);
+ *    ranges.bind("n", variant_t::type_t::LONG64, 1, 100);
+ *    auto expr = ranges(compiled_expr);
+ *
+ * Declared ranges are not checked at run-time: a division by a
+ * variable holding a value out of its range is not reported.
+ */
+class expr_range_analysis_t : public expr_rewriter_t {
+public:
+    using type_t = variant_t::type_t;
+
+    //! Closed interval of values
+    struct range_t {
+        double_t lo = -std::numeric_limits<double_t>::infinity();
+        double_t hi = std::numeric_limits<double_t>::infinity();
+
+        range_t() = default;
+
+        range_t(double_t l, double_t h)
+            : lo(l)
+            , hi(h)
+        {
+        }
+
+        bool excludes_zero() const noexcept {
+            return lo > 0 || hi < 0;
+        }
+    };
+
+    //! Declares that variable name always holds a value of type t
+    void bind(const std::string& name, type_t t) {
+        _types.bind(name, t);
+    }
+
+    //! Declares that variable name always holds a value of type t
+    //! in the range [lo, hi]
+    void bind(const std::string& name, type_t t, double_t lo, double_t hi) {
+        _types.bind(name, t);
+        _ranges[name] = range_t(lo, hi);
+    }
+
+    //! Returns the range of the values of expr
+    range_t range_of(const expr_any_t::handle_t& expr) const;
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+
+private:
+    range_t compute_range(const expr_any_t::handle_t& expr) const;
+
+    expr_type_inference_t _types;
+    std::unordered_map<std::string, range_t> _ranges;
+    mutable std::unordered_map<expr_any_t::handle_t, range_t> _cache;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_RANGE_ANALYSIS_H__
@@ -0,0 +1,64 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_REWRITER_H__
+#define __NU_EXPR_REWRITER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Base class of the passes which transform a compiled expression tree.
+ * The tree is visited bottom-up: rewrite() is called for each node once
+ * its children have been processed, and a node is rebuilt only if at
+ * least one of its children has been replaced.
+ * Node types the rewriter does not know about are handled as leaves.
+ */
+class expr_rewriter_t {
+public:
+    virtual ~expr_rewriter_t() {}
+
+    //! Applies the pass and returns the (possibly new) expression
+    expr_any_t::handle_t operator()(const expr_any_t::handle_t& expr);
+
+    //! Returns the sub-expressions of a node
+    static func_args_t children(const expr_any_t::handle_t& expr);
+
+    //! Returns a copy of a node whose sub-expressions are replaced by
+    //! the given ones (in the same order returned by children())
+    static expr_any_t::handle_t rebuild(
+        const expr_any_t::handle_t& expr, const func_args_t& children);
+
+protected:
+    //! Called for each node after its children have been rewritten
+    virtual expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) {
+        return expr;
+    }
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_REWRITER_H__
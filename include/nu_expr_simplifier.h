@@ -0,0 +1,147 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_SIMPLIFIER_H__
+#define __NU_EXPR_SIMPLIFIER_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_type_inference.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+class expr_simplifier_t;
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Rewrite rule of expr_simplifier_t.
+//! apply() returns the replacement of a node, or nullptr if the rule
+//! does not match it
+struct expr_rule_t {
+    using apply_t = std::function<expr_any_t::handle_t(
+        const expr_simplifier_t&, const expr_any_t::handle_t&)>;
+
+    std::string name;
+    apply_t apply;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Algebraic simplification and strength reduction pass.
+ * Each node is matched against a table of rules, in order, until none
+ * of them applies. The default rules are:
+ *
+ *   mul-one     e*1, 1*e -> e
+ *   add-zero    e+0, 0+e, e-0 -> e
+ *   pow-one     e^1 -> e
+ *   sub-self    e-e -> 0
+ *   pow-square  e^2 -> e*e (evaluating e once)
+ *   pow-int     integral a^b -> exponentiation by squaring
+ *   div-const   e/c -> e*(1/c), where c is a power of two
+ *   fma         a*b+c -> fma(a,b,c)
+ *
+ * Types are inferred as expr_type_inference_t does, so variables
+ * should be declared by bind(). A rule is applied only if the result,
+ * including its variant_t type, is the same the original expression
+ * would produce. Rules which change rounding or the IEEE special cases
+ * (fma, e+0, e^1 and e-e for doubles, e/c for any c) require fast_math.
+ * Rules may drop run-time errors of pure operands they remove
+ * (i.e. an undefined variable in "x-x").
+ *
+ * More rules can be added by add_rule():
+ *
+ *    expr_simplifier_t simplifier;
+ *    simplifier.bind("x", variant_t::type_t::DOUBLE);
+ *    simplifier.add_rule({ "my-rule", my_rule });
+ *    auto expr = simplifier(compiled_expr);
+ */
+class expr_simplifier_t : public expr_rewriter_t {
+public:
+    using type_t = variant_t::type_t;
+
+    //! ctor: registers the default rules
+    explicit expr_simplifier_t(bool fast_math = false);
+
+    //! Declares that variable name always holds a value of type t
+    void bind(const std::string& name, type_t t) {
+        _types.bind(name, t);
+    }
+
+    //! Returns true if rules may change the rounding of results
+    bool fast_math() const noexcept {
+        return _fast_math;
+    }
+
+    //! Appends a rule to the table
+    void add_rule(const expr_rule_t& rule) {
+        _rules.push_back(rule);
+    }
+
+    //! Returns the rule table
+    const std::vector<expr_rule_t>& rules() const noexcept {
+        return _rules;
+    }
+
+    //! Returns the inferred type of expr, UNDEFINED if it is not known
+    type_t type_of(const expr_any_t::handle_t& expr) const {
+        return _types.type_of(expr);
+    }
+
+    //! Returns a typed expression reading the value of expr as kind
+    expr_typed_t::typed_handle_t as_typed(
+        const expr_any_t::handle_t& expr, type_t kind) const {
+        return _types.as_typed(expr, kind);
+    }
+
+    //! Returns an expression which evaluates to the scalar value of
+    //! expr, whose type is t. Variables are read by a typed expression,
+    //! so that a vector is never returned in place of its first item
+    expr_any_t::handle_t as_scalar(
+        const expr_any_t::handle_t& expr, type_t t) const;
+
+    //! Returns true if expr is a numeric literal, and stores its value
+    static bool is_number(const expr_any_t::handle_t& expr, double_t& value);
+
+    //! Returns true if a and b are the same expression
+    static bool is_same(
+        const expr_any_t::handle_t& a, const expr_any_t::handle_t& b);
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+
+private:
+    bool _fast_math;
+    std::vector<expr_rule_t> _rules;
+    expr_type_inference_t _types;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_SIMPLIFIER_H__
@@ -0,0 +1,94 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_SLOT_VAR_H__
+#define __NU_EXPR_SLOT_VAR_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_rewriter.h"
+#include "nu_expr_var.h"
+#include "nu_slot_ctx.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Variable resolved to a slot of a slot table.
+//! Evaluated in a context which does not provide the slot (i.e. a plain
+//! ctx_t), the variable is looked up by name
+class expr_slot_var_t : public expr_var_t {
+public:
+    expr_slot_var_t(
+        const atom_t& name, slot_tbl_t::handle_t tbl, size_t idx)
+        : expr_var_t(name)
+        , _tbl(tbl)
+        , _idx(idx)
+    {
+    }
+
+    expr_slot_var_t() = delete;
+    expr_slot_var_t(const expr_slot_var_t&) = default;
+    expr_slot_var_t& operator=(const expr_slot_var_t&) = default;
+
+    const variant_t& lookup(ctx_t& ctx) const override {
+        auto value = ctx.slot(_tbl.get(), _idx);
+        return value ? *value : expr_var_t::lookup(ctx);
+    }
+
+    //! Returns the slot index
+    size_t slot_index() const noexcept {
+        return _idx;
+    }
+
+protected:
+    slot_tbl_t::handle_t _tbl;
+    size_t _idx;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Binds each variable referred by an expression to a slot of a given
+ * slot table. The returned expression is evaluated efficiently using a
+ * slot_ctx_t that shares the same table:
+ *
+ *    slot_ctx_t ctx;
+ *    auto expr = expr_slot_binder_t(ctx.slot_table())(compiled_expr);
+ */
+class expr_slot_binder_t : public expr_rewriter_t {
+public:
+    explicit expr_slot_binder_t(slot_tbl_t::handle_t tbl)
+        : _tbl(tbl)
+    {
+    }
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+
+private:
+    slot_tbl_t::handle_t _tbl;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_SLOT_VAR_H__
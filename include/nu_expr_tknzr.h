@@ -19,10 +19,12 @@
 #include "nu_lxa.h"
 #include "nu_token.h"
 #include "nu_token_list.h"
+#include "nu_token_tbl.h"
 
 #include <deque>
 #include <ostream>
 #include <set>
+#include <vector>
 
 
 /* -------------------------------------------------------------------------- */
@@ -89,20 +91,92 @@ public:
         return _pos; 
     }
 
+    //! Return the table of the identifiers of the tokens
+    const token_tbl_t::handle_t& get_tbl() const noexcept {
+        return _tbl;
+    }
+
+    //! Return the identifier of a token got by next()
+    const std::string& identifier(const token_t& t) const noexcept {
+        return _tbl->str(t.id());
+    }
+
 
 protected:
+    //! Token found by the scanner
+    struct span_t {
+        //! Position of the token, relative to the expression
+        size_t position = 0;
+
+        //! Text of the token in the expression (offset, length);
+        //! string literals, line comments and word operators take
+        //! their identifier from the scanner state
+        size_t offset = 0;
+        size_t length = 0;
+
+        tkncl_t type = tkncl_t::UNDEFINED;
+    };
+
     //! Get a token and advance to the next one (if any)
     token_t _next();
 
+    //! Scan the next token and advance to the next one (if any)
+    span_t _scan();
+
     size_t _pos = 0;
     std::string _subexp_begin_symb;
     std::string _subexp_end_symb;
-    std::set<std::string> _str_op; // mod, div, ...
-    lxa_symb_t _blank, _op, _newl;
-    lxa_word_t _word_op;
     lxa_str_t _strtk;
-
-    std::set<std::string> _line_comment;
+    token_tbl_t::handle_t _tbl;
+
+private:
+    // Character classes
+    enum : unsigned char {
+        CL_BLANK = 0x01,
+        CL_NEWLINE = 0x02,
+        CL_OPERATOR = 0x04,
+        CL_COMMENT = 0x08, // single char line comment
+        CL_IDENT = 0x10,
+        CL_QUOTE = 0x20, // first symbol of begin string marker
+        CL_WORD = 0x40 // symbol of a word operator
+    };
+
+    // Trie node flags
+    enum : unsigned char {
+        TN_WORD = 0x01, // end of word operator or line comment prefix
+        TN_STR_OP = 0x02, // end of word operator
+        TN_COMMENT = 0x04 // end of line comment prefix
+    };
+
+    struct trie_node_t {
+        unsigned child = 0; // first child, 0 if none
+        unsigned sibling = 0; // next sibling, 0 if none
+        unsigned word = 0; // offset of the word in _words
+        unsigned short length = 0; // length of the word
+        char symbol = 0;
+        unsigned char flags = 0;
+    };
+
+    void _add_word(const std::string& word, unsigned char flags);
+
+    // Return the child of node for symbol, or 0 if none
+    unsigned _child(unsigned node, char symbol) const noexcept;
+
+    // Return the identifier of the word ending at node
+    token_t::id_t _word_id(unsigned node);
+
+    // Classify the text [offset, offset + length)
+    tkncl_t _classify(size_t offset, size_t length) const noexcept;
+
+    unsigned char _class[256] = {};
+    std::vector<trie_node_t> _trie; // _trie[0] is the root
+    std::string _words; // text of the words of the trie
+
+    // Word operator matched so far
+    unsigned _word_node = 0;
+
+    // Word operator found by _scan()
+    unsigned _word_found = 0;
 };
 
 
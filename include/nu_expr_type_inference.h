@@ -0,0 +1,87 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_TYPE_INFERENCE_H__
+#define __NU_EXPR_TYPE_INFERENCE_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_rewriter.h"
+#include "nu_expr_typed.h"
+
+#include <string>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Static type inference pass.
+ * Types are inferred from literals, from the variables declared by bind()
+ * and from the return types of built-in functions. Each operator (or
+ * math function call) whose operand types are proven is replaced by a
+ * typed expression (see expr_typed_t) which computes double, long64 or
+ * string values directly. Everything else keeps the generic path.
+ * The results, including their variant_t type, are the same the generic
+ * expression would produce, except for the sign of NaN values computed
+ * from two NaN operands, which depends on the order the compiler gives
+ * to the operands of + and *:
+ *
+ *    expr_type_inference_t infer;
+ *    infer.bind("x", variant_t::type_t::DOUBLE);
+ *    auto expr = infer(compiled_expr);
+ *
+ * Evaluating a bound variable which holds a value of a different type
+ * raises E_TYPE_MISMATCH.
+ */
+class expr_type_inference_t : public expr_rewriter_t {
+public:
+    using type_t = variant_t::type_t;
+
+    //! Declares that variable name always holds a value of type t
+    void bind(const std::string& name, type_t t) {
+        _bindings[name] = t;
+    }
+
+    //! Returns the inferred type of expr, UNDEFINED if it is not known
+    type_t type_of(const expr_any_t::handle_t& expr) const;
+
+    //! Returns the type of the result of operator op applied to values
+    //! of types ta and tb, UNDEFINED if it is not known
+    static type_t result_type(bin_opcode_t op, type_t ta, type_t tb);
+
+    //! Returns a typed expression reading the value of expr as kind
+    //! (DOUBLE, LONG64, BOOLEAN or STRING)
+    expr_typed_t::typed_handle_t as_typed(
+        const expr_any_t::handle_t& expr, type_t kind) const;
+
+protected:
+    expr_any_t::handle_t rewrite(const expr_any_t::handle_t& expr) override;
+
+private:
+    std::unordered_map<std::string, type_t> _bindings;
+    mutable std::unordered_map<expr_any_t::handle_t, type_t> _types;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_TYPE_INFERENCE_H__
@@ -0,0 +1,511 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_EXPR_TYPED_H__
+#define __NU_EXPR_TYPED_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+#include "nu_expr_var.h"
+#include "nu_global_function_tbl.h"
+#include "nu_ctx.h"
+
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Base class of the expressions whose result type is statically known.
+ * Typed expressions are created by expr_type_inference_t and exchange
+ * plain values through eval_double(), eval_long64() and eval_str(),
+ * without building any intermediate variant_t.
+ *
+ * The type() selects the valid accessor:
+ *   DOUBLE                    -> eval_double()
+ *   LONG64, INTEGER, BOOLEAN  -> eval_long64()
+ *   STRING                    -> eval_str()
+ *
+ * eval() returns the same variant_t the generic expression would.
+ */
+class expr_typed_t : public expr_any_t {
+public:
+    using type_t = variant_t::type_t;
+    using typed_handle_t = std::shared_ptr<expr_typed_t>;
+
+    explicit expr_typed_t(type_t t) noexcept
+        : _type(t)
+    {
+    }
+
+    //! Returns the result type
+    type_t type() const noexcept {
+        return _type;
+    }
+
+    //! Returns true if values of type t are read by eval_long64()
+    static bool is_long64_kind(type_t t) noexcept {
+        return t == type_t::LONG64 || t == type_t::INTEGER
+            || t == type_t::BOOLEAN;
+    }
+
+    virtual double_t eval_double(ctx_t& ctx) const;
+    virtual long64_t eval_long64(ctx_t& ctx) const;
+    virtual string_t eval_str(ctx_t& ctx) const;
+
+    //! Returns the result boxed into a variant_t
+    variant_t eval(ctx_t& ctx) const override;
+
+    bool empty() const noexcept override {
+        return false;
+    }
+
+    std::string name() const noexcept override {
+        return "";
+    }
+
+    func_args_t get_args() const noexcept override {
+        func_args_t dummy;
+        return dummy;
+    }
+
+private:
+    type_t _type;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Typed constant
+class expr_typed_const_t : public expr_typed_t {
+public:
+    //! ctor: value is converted to type t
+    expr_typed_const_t(type_t t, const variant_t& value);
+
+    double_t eval_double(ctx_t&) const override {
+        return _d;
+    }
+
+    long64_t eval_long64(ctx_t&) const override {
+        return _i;
+    }
+
+    string_t eval_str(ctx_t&) const override {
+        return _s;
+    }
+
+private:
+    double_t _d = 0;
+    long64_t _i = 0;
+    string_t _s;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Variable whose type has been declared to the type inference.
+//! Evaluating it throws E_TYPE_MISMATCH if the variable in the context
+//! holds a value of a different type
+class expr_typed_var_t : public expr_typed_t {
+public:
+    expr_typed_var_t(type_t t, std::shared_ptr<const expr_var_t> var)
+        : expr_typed_t(t)
+        , _var(var)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        return value(ctx).to_double();
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override {
+        return value(ctx).to_long64();
+    }
+
+    string_t eval_str(ctx_t& ctx) const override {
+        return value(ctx).to_str();
+    }
+
+    std::string name() const noexcept override {
+        return _var->name();
+    }
+
+protected:
+    const variant_t& value(ctx_t& ctx) const {
+        const auto& v = _var->lookup(ctx);
+
+        rt_error_code_t::get_instance().throw_if(
+            v.get_type() != type(), rt_error_code_t::E_TYPE_MISMATCH);
+
+        return v;
+    }
+
+private:
+    std::shared_ptr<const expr_var_t> _var;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Converts the result of a typed expression as variant_t does:
+//! integral to DOUBLE, DOUBLE to LONG64 (truncating) and any number
+//! to BOOLEAN
+class expr_typed_conv_t : public expr_typed_t {
+public:
+    expr_typed_conv_t(type_t t, typed_handle_t arg)
+        : expr_typed_t(t)
+        , _arg(arg)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        return double_t(_arg->eval_long64(ctx));
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override {
+        const auto v = _arg->type() == type_t::DOUBLE
+            ? long64_t(_arg->eval_double(ctx))
+            : _arg->eval_long64(ctx);
+
+        return type() == type_t::BOOLEAN ? v != 0 : v;
+    }
+
+private:
+    typed_handle_t _arg;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Reads the result of a generic expression whose type is known
+//! (or numeric) as plain value
+class expr_typed_unbox_t : public expr_typed_t {
+public:
+    expr_typed_unbox_t(type_t t, expr_any_t::handle_t arg)
+        : expr_typed_t(t)
+        , _arg(arg)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        variant_t tmp;
+        return _arg->eval_ref(ctx, tmp).to_double();
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override {
+        variant_t tmp;
+        const auto v = _arg->eval_ref(ctx, tmp).to_long64();
+        return type() == type_t::BOOLEAN ? v != 0 : v;
+    }
+
+    string_t eval_str(ctx_t& ctx) const override {
+        variant_t tmp;
+        return _arg->eval_ref(ctx, tmp).to_str();
+    }
+
+private:
+    expr_any_t::handle_t _arg;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Binary operator whose operands are both DOUBLE.
+//! The result is DOUBLE for arithmetic operators, BOOLEAN otherwise
+class expr_double_bin_t : public expr_typed_t {
+public:
+    expr_double_bin_t(
+        bin_opcode_t op, type_t t, typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(t)
+        , _op(op)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override;
+    long64_t eval_long64(ctx_t& ctx) const override;
+
+private:
+    bin_opcode_t _op;
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Binary operator whose operands are both read by eval_long64().
+//! The result type (LONG64, INTEGER or BOOLEAN) selects the same
+//! arithmetic variant_t uses for it
+class expr_long64_bin_t : public expr_typed_t {
+public:
+    expr_long64_bin_t(
+        bin_opcode_t op, type_t t, typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(t)
+        , _op(op)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override;
+
+private:
+    bin_opcode_t _op;
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Binary operator whose operands are both STRING.
+//! The result is STRING for '+', BOOLEAN for relational operators
+class expr_str_bin_t : public expr_typed_t {
+public:
+    expr_str_bin_t(
+        bin_opcode_t op, type_t t, typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(t)
+        , _op(op)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override;
+    string_t eval_str(ctx_t& ctx) const override;
+
+private:
+    bin_opcode_t _op;
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Call of a built-in math function with DOUBLE arguments
+class expr_double_call_t : public expr_typed_t {
+public:
+    using math_fn_t = global_function_tbl_t::math_fn_t;
+    using math_fn2_t = global_function_tbl_t::math_fn2_t;
+
+    expr_double_call_t(math_fn_t fn, typed_handle_t x)
+        : expr_typed_t(type_t::DOUBLE)
+        , _fn(fn)
+        , _fn2(nullptr)
+        , _x(x)
+    {
+    }
+
+    expr_double_call_t(math_fn2_t fn, typed_handle_t x, typed_handle_t y)
+        : expr_typed_t(type_t::DOUBLE)
+        , _fn(nullptr)
+        , _fn2(fn)
+        , _x(x)
+        , _y(y)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        if (_fn)
+            return _fn(_x->eval_double(ctx));
+
+        // Arguments are evaluated left to right, like built-in functions do
+        const auto x = _x->eval_double(ctx);
+        return _fn2(x, _y->eval_double(ctx));
+    }
+
+private:
+    math_fn_t _fn;
+    math_fn2_t _fn2;
+    typed_handle_t _x, _y;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Square of a DOUBLE value (x^2 computed as x*x)
+class expr_double_square_t : public expr_typed_t {
+public:
+    explicit expr_double_square_t(typed_handle_t x)
+        : expr_typed_t(type_t::DOUBLE)
+        , _x(x)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        const auto x = _x->eval_double(ctx);
+        return x * x;
+    }
+
+    //! Returns the squared expression
+    const typed_handle_t& arg() const noexcept {
+        return _x;
+    }
+
+private:
+    typed_handle_t _x;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Fused multiply-add a*b+c of DOUBLE values.
+//! The product is not rounded, so the result may differ from a*b+c
+class expr_double_fma_t : public expr_typed_t {
+public:
+    expr_double_fma_t(typed_handle_t a, typed_handle_t b, typed_handle_t c)
+        : expr_typed_t(type_t::DOUBLE)
+        , _a(a)
+        , _b(b)
+        , _c(c)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override;
+
+private:
+    typed_handle_t _a, _b, _c;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Integer power (LONG64 or INTEGER result) computed by exponentiation
+//! by squaring. The result is the one '^' returns for integral operands,
+//! that is the pow() result rounded by adding 0.5 and truncating
+class expr_long64_pow_t : public expr_typed_t {
+public:
+    expr_long64_pow_t(type_t t, typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(t)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override;
+
+private:
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Division of DOUBLE values whose divisor is known not to be zero,
+//! so it is not checked
+class expr_double_div_t : public expr_typed_t {
+public:
+    expr_double_div_t(typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(type_t::DOUBLE)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override {
+        const auto b = _b->eval_double(ctx);
+        return _a->eval_double(ctx) / b;
+    }
+
+private:
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Integer division (div) or modulo (mod) whose divisor is known not to
+//! be zero, so it is not checked. The result type is LONG64 or INTEGER
+class expr_long64_div_t : public expr_typed_t {
+public:
+    expr_long64_div_t(
+        bin_opcode_t op, type_t t, typed_handle_t a, typed_handle_t b)
+        : expr_typed_t(t)
+        , _op(op)
+        , _a(a)
+        , _b(b)
+    {
+    }
+
+    long64_t eval_long64(ctx_t& ctx) const override {
+        const auto b = _b->eval_long64(ctx);
+        const auto a = _a->eval_long64(ctx);
+
+        if (type() == type_t::INTEGER) {
+            return _op == bin_opcode_t::INT_DIV ? integer_t(a) / integer_t(b)
+                                                : integer_t(a) % integer_t(b);
+        }
+
+        return _op == bin_opcode_t::INT_DIV ? a / b : a % b;
+    }
+
+private:
+    bin_opcode_t _op;
+    typed_handle_t _a, _b;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Polynomial in a DOUBLE variable, c[0] + c[1]*x + ... + c[n]*x^n.
+ * It is evaluated in Horner form (n fused multiply-adds), or in Estrin
+ * form, whose independent multiply-adds can be pipelined, if estrin is
+ * true. A null coefficient stands for 0.
+ * Rounding differs from the one of the expanded expression.
+ */
+class expr_double_poly_t : public expr_typed_t {
+public:
+    //! Maximum degree supported
+    enum { MAX_DEGREE = 64 };
+
+    expr_double_poly_t(typed_handle_t x,
+        const std::vector<typed_handle_t>& coefficients, bool estrin)
+        : expr_typed_t(type_t::DOUBLE)
+        , _x(x)
+        , _coefficients(coefficients)
+        , _estrin(estrin)
+    {
+    }
+
+    double_t eval_double(ctx_t& ctx) const override;
+
+    //! Returns the variable (a typed variable)
+    const typed_handle_t& var() const noexcept {
+        return _x;
+    }
+
+    //! Returns the coefficients, c[i] multiplies x^i
+    const std::vector<typed_handle_t>& coefficients() const noexcept {
+        return _coefficients;
+    }
+
+private:
+    typed_handle_t _x;
+    std::vector<typed_handle_t> _coefficients;
+    bool _estrin;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_EXPR_TYPED_H__
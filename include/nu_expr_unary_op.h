@@ -15,6 +15,7 @@
 /* -------------------------------------------------------------------------- */
 
 #include "nu_expr_any.h"
+#include "nu_global_function_tbl.h"
 #include "nu_ctx.h"
 
 
@@ -25,6 +26,8 @@ namespace nu {
 
 /* -------------------------------------------------------------------------- */
 
+//! Unary operator expression (e.g. "++x"). The operator implementation
+//! is bound when the object is created
 class expr_unary_op_t : public expr_any_t {
 public:
     expr_unary_op_t(const std::string& op_name, expr_any_t::handle_t var);
@@ -33,6 +36,11 @@ public:
     expr_unary_op_t(const expr_unary_op_t&) = default;
     expr_unary_op_t& operator=(const expr_unary_op_t&) = default;
 
+    ~expr_unary_op_t() {
+        release(_var);
+        release(_args);
+    }
+
     variant_t eval(ctx_t& ctx) const override;
 
     bool empty() const noexcept override {
@@ -48,9 +56,22 @@ public:
         return dummy;
     }
 
+    //! Returns the operator name (e.g. "++")
+    const std::string& op_name() const noexcept {
+        return _op_name;
+    }
+
+    //! Returns the operand expression
+    const expr_any_t::handle_t& operand() const noexcept {
+        return _var;
+    }
+
 protected:
     std::string _op_name;
     expr_any_t::handle_t _var;
+    func_args_t _args;
+    func_ptr_t _fptr;
+    const func_t* _func;
 };
 
 
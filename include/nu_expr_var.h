@@ -27,7 +27,7 @@ namespace nu {
 
 class expr_var_t : public expr_any_t {
 public:
-    expr_var_t(const std::string& name)
+    expr_var_t(const atom_t& name)
         : _name(name)
     {
     }
@@ -37,6 +37,18 @@ public:
     expr_var_t& operator=(const expr_var_t&) = default;
     variant_t eval(ctx_t& ctx) const override;
 
+    void eval_into(ctx_t& ctx, variant_t& out) const override {
+        out = lookup(ctx);
+    }
+
+    //! Returns the value held by ctx, with no copy
+    const variant_t& eval_ref(ctx_t& ctx, variant_t&) const override {
+        return lookup(ctx);
+    }
+
+    //! Returns a reference to the variable value held by ctx
+    virtual const variant_t& lookup(ctx_t& ctx) const;
+
     virtual bool empty() const noexcept override { 
         return false; 
     }
@@ -45,13 +57,18 @@ public:
         return _name; 
     }
 
+    //! Returns the interned name of the variable
+    const atom_t& atom() const noexcept {
+        return _name;
+    }
+
     func_args_t get_args() const noexcept override   {
         func_args_t dummy;
         return dummy;
     }
 
 protected:
-    std::string _name;
+    atom_t _name;
 };
 
 
@@ -21,6 +21,7 @@
 #include "nu_variant.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <type_traits>
 #include <vector>
@@ -40,10 +41,67 @@ using func_t = std::function<variant_t(
 
 using binop_t = std::function<variant_t(const variant_t&, const variant_t&)>;
 
+//! Plain function pointer type for built-in functions which do not
+//! need a type-erased std::function wrapper
+using func_ptr_t = variant_t (*)(
+    ctx_t&, const std::string&, const func_args_t&);
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Built-in binary operators, bound by the compiler at compile time
+enum class bin_opcode_t : std::uint8_t {
+    ADD,      // +
+    SUB,      // -
+    MUL,      // *
+    DIV,      // /
+    INT_DIV,  // div, '\\'
+    INT_MOD,  // mod
+    POW,      // ^
+    EQ,       // =
+    NE,       // <>
+    LT,       // <
+    LE,       // <=
+    GT,       // >
+    GE,       // >=
+    AND,      // and
+    OR,       // or
+    XOR,      // xor
+    BOR,      // bor
+    BAND,     // band
+    BXOR,     // bxor
+    BSHR,     // bshr
+    BSHL,     // bshl
+    CUSTOM    // not built-in, implemented by a binop_t
+};
+
 
 /* -------------------------------------------------------------------------- */
 
-class global_function_tbl_t : public symbol_map_t<std::string, func_t> {
+class global_function_tbl_t : public symbol_map_t<atom_t, func_t> {
+public:
+    using math_fn_t = double_t (*)(double_t);
+    using math_fn2_t = double_t (*)(double_t, double_t);
+
+    //! Static properties of a built-in function, used by compile-time
+    //! passes (see expr_type_inference_t)
+    struct func_info_t {
+        //! Type of the returned value, UNDEFINED if it is not known
+        variant_t::type_t ret_type = variant_t::type_t::UNDEFINED;
+
+        //! Implementation of the function taking numeric arguments
+        //! converted to double, if it is equivalent to the function
+        math_fn_t math_fn = nullptr;
+        math_fn2_t math_fn2 = nullptr;
+
+        //! True if the result depends on the arguments only and
+        //! the function has no side effects
+        bool pure = false;
+
+        //! Number of arguments, -1 if it is not known
+        int arg_num = -1;
+    };
+
 private:
     global_function_tbl_t() = default;
     global_function_tbl_t(const global_function_tbl_t&) = delete;
@@ -58,12 +116,78 @@ protected:
 
 public:
     static global_function_tbl_t& get_instance();
+
+    //! Returns the function named name, or nullptr if it is not defined.
+    //! The returned pointer is valid until the function is erased
+    const func_t* find(const atom_t& name) const noexcept {
+        auto i = map().find(name);
+        return i == map().end() ? nullptr : &i->second;
+    }
+
+    //! Returns the properties of function name, or nullptr if unknown
+    const func_info_t* get_info(const atom_t& name) const noexcept {
+        auto i = _info.find(name);
+        return i == _info.end() ? nullptr : &i->second;
+    }
+
+    //! Sets the type of the value returned by function name
+    void set_return_type(const atom_t& name, variant_t::type_t t) {
+        _info[name].ret_type = t;
+    }
+
+    //! Declares whether function name is pure
+    void set_pure(const atom_t& name, bool pure) {
+        _info[name].pure = pure;
+    }
+
+    //! Returns true if function name is known to be pure
+    bool is_pure(const atom_t& name) const noexcept {
+        auto info = get_info(name);
+        return info && info->pure;
+    }
+
+    //! Sets the double implementation of function name
+    void set_math_fn(const atom_t& name, math_fn_t fn) {
+        _info[name].math_fn = fn;
+    }
+
+    //! Sets the double implementation of function name
+    void set_math_fn(const atom_t& name, math_fn2_t fn) {
+        _info[name].math_fn2 = fn;
+    }
+
+    //! Sets the number of arguments of function name
+    void set_arg_num(const atom_t& name, int arg_num) {
+        _info[name].arg_num = arg_num;
+    }
+
+    //! Returns true if args are accepted by a function expecting
+    //! arg_num arguments (a single empty argument stands for none)
+    static bool is_valid_arg_num(const func_args_t& args, int arg_num) {
+        return (arg_num == 0 && args.size() == 0)
+            || (arg_num == 0 && args.size() == 1 && args[0]->empty())
+            || (arg_num == 1 && args.size() == 1 && !args[0]->empty())
+            || (arg_num > 1 && int(args.size()) == arg_num);
+    }
+
+    void erase(const atom_t& name) override {
+        _info.erase(name);
+        symbol_map_t<atom_t, func_t>::erase(name);
+    }
+
+    void clear() override {
+        _info.clear();
+        symbol_map_t<atom_t, func_t>::clear();
+    }
+
+private:
+    std::unordered_map<atom_t, func_info_t> _info;
 };
 
 
 /* -------------------------------------------------------------------------- */
 
-class global_operator_tbl_t : public symbol_map_t<std::string, binop_t> {
+class global_operator_tbl_t : public symbol_map_t<atom_t, binop_t> {
 private:
     global_operator_tbl_t() = default;
     global_operator_tbl_t(const global_operator_tbl_t&) = delete;
@@ -78,6 +202,67 @@ protected:
 
 public:
     static global_operator_tbl_t& get_instance();
+
+    //! Gets the opcode of the built-in operator named name.
+    //! Returns false if name is not a built-in operator, or if its entry
+    //! of the table has been replaced: the compiler then calls the
+    //! replacement, as it does for the operators an application defines
+    static bool get_opcode(const std::string& name, bin_opcode_t& code);
+
+    //! Applies the built-in operator code to a and b
+    static variant_t apply(
+        bin_opcode_t code, const variant_t& a, const variant_t& b)
+    {
+        switch (code) {
+        case bin_opcode_t::ADD:
+            return a + b;
+        case bin_opcode_t::SUB:
+            return a - b;
+        case bin_opcode_t::MUL:
+            return a * b;
+        case bin_opcode_t::DIV:
+            return a / b;
+        case bin_opcode_t::INT_DIV:
+            return a.int_div(b);
+        case bin_opcode_t::INT_MOD:
+            return a.int_mod(b);
+        case bin_opcode_t::POW:
+            return a.power(b);
+        case bin_opcode_t::EQ:
+            return a == b;
+        case bin_opcode_t::NE:
+            return a != b;
+        case bin_opcode_t::LT:
+            return a < b;
+        case bin_opcode_t::LE:
+            return a <= b;
+        case bin_opcode_t::GT:
+            return a > b;
+        case bin_opcode_t::GE:
+            return a >= b;
+        case bin_opcode_t::AND:
+            return variant_t(a && b);
+        case bin_opcode_t::OR:
+            return variant_t(a || b);
+        case bin_opcode_t::XOR:
+            return a != b;
+        case bin_opcode_t::BOR:
+            return variant_t(a.to_int() | b.to_int());
+        case bin_opcode_t::BAND:
+            return variant_t(a.to_int() & b.to_int());
+        case bin_opcode_t::BXOR:
+            return variant_t(a.to_int() ^ b.to_int());
+        case bin_opcode_t::BSHR:
+            return variant_t(a.to_int() >> b.to_int());
+        case bin_opcode_t::BSHL:
+            return variant_t(a.to_int() << b.to_int());
+        case bin_opcode_t::CUSTOM:
+        default:
+            break;
+        }
+
+        throw exception_t("Internal error: operator not built-in");
+    }
 };
 
 
@@ -0,0 +1,135 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_SLOT_CTX_H__
+#define __NU_SLOT_CTX_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_ctx.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * A slot table assigns a stable index (slot) to each variable name an
+ * expression refers to. It is filled once, when expressions are bound,
+ * and may be shared by several contexts (i.e. one per thread).
+ * Binding is not synchronized: bind all the expressions before sharing
+ * the table among threads.
+ */
+class slot_tbl_t {
+public:
+    using handle_t = std::shared_ptr<slot_tbl_t>;
+
+    slot_tbl_t() = default;
+    slot_tbl_t(const slot_tbl_t&) = delete;
+    slot_tbl_t& operator=(const slot_tbl_t&) = delete;
+
+    //! Returns the slot of a given name, allocating it if needed
+    size_t bind(const atom_t& name);
+
+    //! Returns true and sets idx if name has a slot
+    bool find(const atom_t& name, size_t& idx) const noexcept;
+
+    //! Returns the name bound to slot idx
+    const atom_t& name(size_t idx) const {
+        return _names[idx];
+    }
+
+    //! Returns the number of slots
+    size_t size() const noexcept {
+        return _names.size();
+    }
+
+private:
+    std::unordered_map<atom_t, size_t> _index;
+    std::vector<atom_t> _names;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Context which provides access to its variables by slot index.
+ * Variables are still stored (and can be defined, read or erased) by
+ * name as in ctx_t; each slot caches the address of its variable once
+ * resolved, so expressions bound to the slot table do not hash their
+ * identifiers at every evaluation.
+ * Names defined later or dynamically are resolved on first access.
+ */
+class slot_ctx_t : public ctx_t {
+public:
+    using handle_t = std::shared_ptr<slot_ctx_t>;
+
+    //! ctor
+    explicit slot_ctx_t(
+        slot_tbl_t::handle_t tbl = std::make_shared<slot_tbl_t>());
+
+    //! copy ctor: slots of the copy are resolved again on first access
+    slot_ctx_t(const slot_ctx_t& other);
+    slot_ctx_t& operator=(const slot_ctx_t&) = delete;
+
+    //! Returns the slot table
+    const slot_tbl_t::handle_t& slot_table() const noexcept {
+        return _tbl;
+    }
+
+    //! Returns the slot of a given name, allocating it if needed
+    size_t bind(const atom_t& name) {
+        return _tbl->bind(name);
+    }
+
+    //! Returns the variable bound to slot idx (nullptr if it is not
+    //! defined or tbl is not the slot table of this context)
+    variant_t* slot(const slot_tbl_t* tbl, size_t idx) override {
+        if (tbl != _tbl.get())
+            return nullptr;
+
+        if (idx < _cache.size() && _cache[idx])
+            return _cache[idx];
+
+        return resolve(idx);
+    }
+
+    //! Assigns value to the variable bound to slot idx
+    void set(size_t idx, const variant_t& value);
+
+    void erase(const atom_t& name) override;
+    void clear() override;
+
+protected:
+    variant_t* resolve(size_t idx);
+
+private:
+    slot_tbl_t::handle_t _tbl;
+    std::vector<variant_t*> _cache;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_SLOT_CTX_H__
@@ -0,0 +1,111 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_STR_VIEW_H__
+#define __NU_STR_VIEW_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include <cstddef>
+#include <string>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Non-owning reference to a sequence of characters.
+ * Used by the string built-in functions to slice and search their
+ * arguments in place: a view is valid as long as the string it refers
+ * to is not modified or destroyed.
+ */
+class str_view_t {
+public:
+    static const size_t npos = size_t(-1);
+
+    str_view_t() noexcept = default;
+
+    str_view_t(const char* data, size_t size) noexcept
+        : _data(data)
+        , _size(size)
+    {
+    }
+
+    str_view_t(const std::string& s) noexcept
+        : _data(s.data())
+        , _size(s.size())
+    {
+    }
+
+    const char* data() const noexcept {
+        return _data;
+    }
+
+    size_t size() const noexcept {
+        return _size;
+    }
+
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    char operator[](size_t idx) const noexcept {
+        return _data[idx];
+    }
+
+    //! Returns the view of n characters beginning at pos, clamped to the
+    //! end of this view
+    str_view_t substr(size_t pos, size_t n = npos) const noexcept {
+        if (pos > _size)
+            pos = _size;
+
+        if (n > _size - pos)
+            n = _size - pos;
+
+        return str_view_t(_data + pos, n);
+    }
+
+    //! Returns a copy of the referred characters
+    std::string str() const {
+        return std::string(_data, _size);
+    }
+
+    //! Returns the position of the first occurrence of s, or npos
+    size_t find(str_view_t s) const noexcept {
+        return search(s, false);
+    }
+
+    //! Returns the position of the first occurrence of s, ignoring the
+    //! case of ASCII letters, or npos
+    size_t ifind(str_view_t s) const noexcept {
+        return search(s, true);
+    }
+
+private:
+    size_t search(str_view_t s, bool icase) const noexcept;
+
+    const char* _data = "";
+    size_t _size = 0;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_STR_VIEW_H__
@@ -37,8 +37,10 @@ inline float stof(const std::string& s) { return (float)atof(s.c_str()); }
 /* -------------------------------------------------------------------------- */
 
 //! Parses s interpreting its content as a floating-point number
-//! which is returned as a value of type float
-inline double stod(const std::string& s) { return std::stod(s); }
+//! which is returned as a value of type double.
+//! Plain decimal numbers are converted by an exact locale-free fast
+//! path; other forms are handled (or rejected) by std::stod()
+double stod(const std::string& s);
 
 
 /* -------------------------------------------------------------------------- */
@@ -51,8 +53,10 @@ inline int stoi(const std::string& s) { return std::stoi(s); }
 /* -------------------------------------------------------------------------- */
 
 //! Parses s interpreting its content as an long integral number
-//! which is returned as an int value
-inline long long stoll(const std::string& s) { return std::stoll(s); }
+//! which is returned as an int value.
+//! Plain decimal numbers are converted by a locale-free fast path;
+//! other forms are handled (or rejected) by std::stoll()
+long long stoll(const std::string& s);
 
 
 /* -------------------------------------------------------------------------- */
@@ -64,6 +68,30 @@ template <class T> inline std::string to_string(const T& item)
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+//! Returns the decimal representation of n (as std::to_string() does)
+std::string format_integer(long long n);
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Largest precision format_fixed() honours: it prints any double
+//! exactly, the digits beyond it would all be zeros
+enum { FORMAT_FIXED_MAX_PREC = 1074 };
+
+//! Returns x formatted with prec decimal digits, as printf("%.<prec>f")
+//! does (std::to_string(x) for prec == 6). A precision greater than
+//! FORMAT_FIXED_MAX_PREC is reduced to it, so that the result is bounded
+std::string format_fixed(double x, int prec = 6);
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Returns the lower-case hexadecimal representation of n
+std::string format_hex(unsigned long long n);
+
+
 /* -------------------------------------------------------------------------- */
 
 } // namespace nu
@@ -14,6 +14,8 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "nu_exception.h"
+
 #include <unordered_map>
 #include <sstream>
 
@@ -49,24 +51,24 @@ public:
         return *this;
     }
 
-    virtual bool define(const std::string& name, const Symb& value) {
+    virtual bool define(const Key& name, const Symb& value) {
         auto i = map().insert(std::make_pair(name, value));
         return i.second;
     }
 
-    virtual void erase(const std::string& name) { 
+    virtual void erase(const Key& name) { 
         map().erase(name); 
     }
 
-    bool is_defined(const std::string& name) const noexcept  {
+    bool is_defined(const Key& name) const noexcept  {
         return _symbols.find(name) != _symbols.end();
     }
 
-    Symb& operator[](const std::string& name) { 
+    Symb& operator[](const Key& name) { 
         return _symbols[name]; 
     }
 
-    const Symb& operator[](const std::string& name) const {
+    const Symb& operator[](const Key& name) const {
         auto i = map().find(name);
 
         if (i == map().end()) {
@@ -15,10 +15,8 @@
 
 /* -------------------------------------------------------------------------- */
 
-#include <algorithm>
-#include <deque>
-#include <memory>
-#include <string>
+#include <cstddef>
+#include <cstdint>
 
 #include "nu_cpp_lang.h"
 
@@ -31,7 +29,7 @@ namespace nu {
 /* -------------------------------------------------------------------------- */
 
 //! Tonken class indentifier
-enum class tkncl_t {
+enum class tkncl_t : uint8_t {
     UNDEFINED,
     BLANK,
     NEWLINE,
@@ -52,35 +50,35 @@ enum class tkncl_t {
 /* -------------------------------------------------------------------------- */
 
 /**
- * This class holds a token data
+ * This class holds a token data.
+ * A token is a plain 16-byte value: its identifier is the index of a
+ * string stored in the token table (see token_tbl_t) of the expression
+ * the token belongs to, so tokens are copied without touching either
+ * the identifier or the expression text
  */
 class token_t {
-    friend class base_tknzr_t;
-
 public:
-    enum class case_t { LOWER, NOCHANGE };
-
-    using data_ptr_t = std::shared_ptr<std::string>;
+    using id_t = uint32_t;
 
-    token_t(const std::string& id, tkncl_t t, size_t pos,
-        data_ptr_t expr_ptr) noexcept : _identifier(id),
-        _type(t),
-        _position(pos),
-        _expression_ptr(expr_ptr)
-    {}
+    token_t() noexcept = default;
 
-    token_t() = delete;
-    token_t(const token_t&) = default;
-    token_t& operator=(const token_t&) = default;
+    token_t(id_t id, tkncl_t t, size_t pos, size_t length = 0) noexcept
+        : _position(uint32_t(pos))
+        , _length(uint32_t(length))
+        , _id(id)
+        , _type(t)
+    {
+    }
 
-    void set_identifier(const std::string& id) noexcept {
-        _identifier = id;
+    //! Returns the index of the identifier in the token table
+    id_t id() const noexcept {
+        return _id;
     }
 
-    const std::string& identifier() const noexcept { 
-        return _identifier; 
+    void set_id(id_t id) noexcept {
+        _id = id;
     }
-        
+
     tkncl_t type() const noexcept { 
         return _type; 
     }
@@ -94,50 +92,28 @@ public:
     }
 
     void set_position(size_t pos) noexcept { 
-        _position = pos; 
-    }
-
-    std::string expression() const noexcept { 
-        return *_expression_ptr; 
+        _position = uint32_t(pos); 
     }
 
-    data_ptr_t expression_ptr() const noexcept { 
-        return _expression_ptr; 
+    //! Returns the length of the token text in the expression,
+    //! zero for tokens which have been added by the compiler
+    size_t length() const noexcept {
+        return _length;
     }
 
-    token_t(token_t&& other)
-        : _identifier(std::move(other._identifier))
-        , _type(std::move(other._type))
-        , _position(std::move(other._position))
-        , _expression_ptr(std::move(other._expression_ptr))
-    {
-    }
-
-    token_t& operator=(token_t&& other) {
-        if (this != &other) {
-            _identifier = std::move(other._identifier);
-            _type = std::move(other._type);
-            _position = std::move(other._position);
-            _expression_ptr = std::move(other._expression_ptr);
-        }
-
-        return *this;
-    }
-
-protected:
-    token_t(size_t pos, data_ptr_t expr_ptr) noexcept
-        : _position(pos),
-          _expression_ptr(expr_ptr)
-    {
+    void set_length(size_t length) noexcept {
+        _length = uint32_t(length);
     }
 
 private:
-    std::string _identifier;
+    uint32_t _position = 0;
+    uint32_t _length = 0;
+    id_t _id = 0;
     tkncl_t _type = tkncl_t::UNDEFINED;
-    size_t _position = 0;
-    data_ptr_t _expression_ptr;
 };
 
+static_assert(sizeof(token_t) == 16, "token_t is expected to be 16 bytes");
+
 
 /* -------------------------------------------------------------------------- */
 
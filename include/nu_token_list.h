@@ -14,14 +14,16 @@
 
 /* -------------------------------------------------------------------------- */
 
+#include "nu_arena.h"
 #include "nu_exception.h"
 #include "nu_token.h"
+#include "nu_token_tbl.h"
 
-#include <deque>
 #include <functional>
 #include <list>
 #include <ostream>
-#include <set>
+#include <string>
+#include <vector>
 
 
 /* -------------------------------------------------------------------------- */
@@ -31,13 +33,19 @@ namespace nu {
 
 /* -------------------------------------------------------------------------- */
 
-//! Defines the structure of an object that represents a collection of tokes
+//! Defines the structure of an object that represents a collection of tokes.
+//! Tokens are stored contiguously; their identifiers are resolved through
+//! the token table shared by the list and by its sublists
 class token_list_t {
+public:
+    using allocator_t = arena_allocator_t<token_t>;
+    using data_t = std::vector<token_t, allocator_t>;
+
 private:
-    std::deque<token_t> _data;
+    data_t _data;
+    token_tbl_t::handle_t _tbl;
 
 public:
-    using data_t = std::deque<token_t>;
     static const size_t npos = size_t(-1);
     using tkp_t = std::pair<std::string, tkncl_t>;
     using btfunc_t = std::function<bool(const token_t&)>;
@@ -47,6 +55,66 @@ public:
     token_list_t() = default;
     token_list_t(const token_list_t&) = default;
     token_list_t& operator=(const token_list_t&) = default;
+    token_list_t(token_list_t&&) = default;
+    token_list_t& operator=(token_list_t&&) = default;
+
+    //! Creates an empty list whose tokens are stored by allocator
+    explicit token_list_t(const allocator_t& allocator)
+        : _data(allocator)
+    {
+    }
+
+
+    //! Creates an empty list of tokens whose identifiers are stored in tbl
+    explicit token_list_t(
+        token_tbl_t::handle_t tbl, const allocator_t& allocator = allocator_t())
+        : _data(allocator)
+        , _tbl(std::move(tbl))
+    {
+    }
+
+
+    //! Returns the allocator used to store the tokens, sublists of
+    //! this list share it
+    allocator_t get_allocator() const {
+        return _data.get_allocator();
+    }
+
+
+    //! Returns the token table
+    const token_tbl_t::handle_t& get_tbl() const noexcept {
+        return _tbl;
+    }
+
+
+    //! Replaces the token table, the list must be empty
+    void set_tbl(token_tbl_t::handle_t tbl) noexcept {
+        _tbl = std::move(tbl);
+    }
+
+
+    //! Returns an empty list sharing token table and allocator
+    token_list_t empty_list() const {
+        return token_list_t(_tbl, get_allocator());
+    }
+
+
+    //! Returns the identifier of a token of the list
+    const std::string& identifier(const token_t& t) const noexcept {
+        return _tbl->str(t.id());
+    }
+
+
+    //! Creates a token which is not part of the expression text
+    token_t make_token(const std::string& identifier, tkncl_t type,
+        size_t position)
+    {
+        return token_t(_tbl->intern(identifier), type, position);
+    }
+
+
+    //! Returns the expression text, used to report syntax errors
+    const std::string& expression() const noexcept;
 
 
     //! Return a reference to standard internal data
@@ -131,15 +199,6 @@ public:
     }
 
 
-    //! Return the list of tokens formed by the two tokens {ltkn, rtkn}
-    friend token_list_t operator+(const token_t& ltkn, const token_t& rtkn) {
-        token_list_t ret;
-        ret += ltkn;
-        ret += rtkn;
-        return ret;
-    }
-
-
     //! Return a list of tokens which is result of concatenation of tknl and tkn
     friend token_list_t operator+(const token_list_t& tknl, const token_t& tkn) {
         token_list_t ret = tknl;
@@ -160,9 +219,10 @@ public:
 
     //! Append to the list all the tokens of a given token list argument
     token_list_t& operator+=(const token_list_t& tknl) {
-        for (const auto& e : tknl.data()) {
-            data().push_back(e);
-        }
+        if (!_tbl)
+            _tbl = tknl._tbl;
+
+        _data.insert(_data.end(), tknl._data.begin(), tknl._data.end());
 
         return *this;
     }
@@ -220,10 +280,7 @@ public:
         const std::string& identifier, size_t pos = 0, size_t items = 0);
     size_t find(const tkncl_t type, size_t pos = 0, size_t items = 0);
 
-    size_t find(const tkp_t& tkp, size_t pos = 0, size_t items = 0) {
-        token_t t(tkp.first, tkp.second, 0, nullptr);
-        return find(t, pos, items);
-    }
+    size_t find(const tkp_t& tkp, size_t pos = 0, size_t items = 0);
 
     // sublist
 
@@ -248,9 +305,12 @@ public:
     token_list_t sublist(const std::string& first, const std::string& second,
         size_t search_from = 0, bool b_erase = false)
     {
+        const auto first_id = find_id(first);
+        const auto second_id = find_id(second);
+
         return sublist(
-            [&](const token_t& t) { return t.identifier() == first; },
-            [&](const token_t& t) { return t.identifier() == second; },
+            [&](const token_t& t) { return t.id() == first_id; },
+            [&](const token_t& t) { return t.id() == second_id; },
             search_from, b_erase);
     }
 
@@ -305,6 +365,15 @@ public:
 
 private:
     void _chekpos(size_t pos, size_t items);
+
+    // Returns the index of identifier, or token_tbl_t::npos if no token
+    // of the list may have it
+    token_t::id_t find_id(const std::string& identifier) const noexcept {
+        return _tbl ? _tbl->find(identifier) : token_tbl_t::npos;
+    }
+
+    // Returns a test matching the tokens equal to the pair tkp
+    btfunc_t match(const tkp_t& tkp) const;
 };
 
 
@@ -0,0 +1,120 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef __NU_TOKEN_TBL_H__
+#define __NU_TOKEN_TBL_H__
+
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_token.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Table of the identifiers of the tokens of an expression.
+ * Each distinct identifier is stored once and tokens refer to it by its
+ * index, so that equal identifiers have equal indices. The table also
+ * shares the expression text, which is only read to report syntax errors.
+ * It is owned by the tokenizer and by the token lists of one compilation
+ * and it is not thread-safe.
+ */
+class token_tbl_t {
+public:
+    using handle_t = std::shared_ptr<token_tbl_t>;
+    using id_t = token_t::id_t;
+
+    static const id_t npos = id_t(-1);
+
+    //! Index of the empty identifier
+    static const id_t empty_id = 0;
+
+    explicit token_tbl_t(std::shared_ptr<std::string> expression);
+
+    token_tbl_t(const token_tbl_t&) = delete;
+    token_tbl_t& operator=(const token_tbl_t&) = delete;
+
+    //! Returns the index of the identifier s, adding it if not yet present
+    id_t intern(const char* s, size_t size);
+
+    id_t intern(const std::string& s) {
+        return intern(s.data(), s.size());
+    }
+
+    //! Returns the index of the identifier s, or npos if not present
+    id_t find(const char* s, size_t size) const noexcept;
+
+    id_t find(const std::string& s) const noexcept {
+        return find(s.data(), s.size());
+    }
+
+    //! Returns the identifier of index id
+    const std::string& str(id_t id) const noexcept {
+        return _ids[id];
+    }
+
+    //! Returns the number of identifiers
+    size_t size() const noexcept {
+        return _ids.size();
+    }
+
+    //! Returns the expression text
+    const std::string& expression() const noexcept {
+        return *_expression;
+    }
+
+    const std::shared_ptr<std::string>& expression_ptr() const noexcept {
+        return _expression;
+    }
+
+    //! Replaces the expression text once it has been edited
+    void set_expression(std::shared_ptr<std::string> expression) noexcept {
+        _expression = std::move(expression);
+    }
+
+private:
+    static size_t hash(const char* s, size_t size) noexcept;
+
+    // Returns the bucket of s: either the one holding its index or the
+    // empty one where it would be added
+    size_t bucket(const char* s, size_t size, size_t h) const noexcept;
+
+    void rehash();
+
+    std::shared_ptr<std::string> _expression;
+
+    // Identifiers never move, so they are referred by the index below
+    std::deque<std::string> _ids;
+    std::vector<size_t> _hashes;
+
+    // Open addressing index of _ids, npos marks an empty bucket
+    std::vector<id_t> _buckets;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
+
+#endif // __NU_TOKEN_TBL_H__
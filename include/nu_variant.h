@@ -20,6 +20,7 @@
 #include "nu_variable.h"
 
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -44,34 +45,118 @@ struct any_variant_t {
 /**
  * A variant is a special data type that can contain any kind of typed data
  * Numeric data can be any integer or real number value.
+ * Scalar values are stored inline (strings use std::string small buffer),
+ * so creating or copying a scalar does not allocate heap memory for
+ * numbers and short strings. Vector values are kept in a separate
+ * heap-allocated array_t, which is shared by copies of the variant and
+ * copied only when one of them is modified (copy-on-write).
+ * A variant can also keep both representations of its value (see
+ * cache_conversions()), so that strings are parsed and numbers formatted
+ * once, instead of at every to_double(), to_long64() or to_str().
  */
 class variant_t {
 protected:
+    //! Storage of vector values
+    struct array_t {
+        size_t size = 0;
+        std::vector<string_t> s_data;
+        std::vector<long64_t> i_data;
+        std::vector<double_t> f_data;
+    };
+
     void _resize(size_t size);
+    void _make_array(size_t size);
+    void _fill(size_t size);
+
+    //! Makes the vector storage owned by this variant only, copying it
+    //! if it is shared with other variants
+    void _unshare() {
+        if (_array && _array.use_count() > 1)
+            _array = std::make_shared<array_t>(*_array);
+    }
 
-    template <class T, class DT = T>
-    void _set(const T& value, std::vector<DT>& data, variable_t::type_t t) {
+    //! Drops the cached conversions of the value
+    void _invalidate() noexcept {
+        _conv.reset();
+    }
+
+    void _set_type(variable_t::type_t t) noexcept {
         _type = t;
+        _has_value = true;
+        _invalidate();
+    }
 
+    template <class T, class DT = T>
+    void _set(const T& value, std::vector<DT>& data) {
         if (data.empty())
             data.resize(1, value);
         else
             data[0] = value;
     }
 
-
     template <class T, class DT = T>
-    void _set(
-        const T& value, std::vector<DT>& data, variable_t::type_t t, size_t idx)  {
-        _type = t;
+    void _set(const T& value, std::vector<DT>& data, size_t idx) {
+        if (idx >= _array->size)
+            _array->size = idx + 1;
 
-        if (idx >= _vect_size)
-            _vect_size = idx + 1;
+        if (data.size() < _array->size)
+            data.resize(_array->size, value);
 
-        if (data.empty())
-            data.resize(_vect_size, value);
+        data[idx] = value;
+    }
+
+    void _set_str(const string_t& value) {
+        if (_array) {
+            _unshare();
+            _set(value, _array->s_data);
+        }
         else
-            data[idx] = value;
+            _s = value;
+
+        _set_type(variable_t::type_t::STRING);
+    }
+
+    void _set_long64(long64_t value, variable_t::type_t t) {
+        if (_array) {
+            _unshare();
+            _set(value, _array->i_data);
+        }
+        else
+            _i = value;
+
+        _set_type(t);
+    }
+
+    void _set_double(double_t value, variable_t::type_t t) {
+        if (_array) {
+            _unshare();
+            _set(value, _array->f_data);
+        }
+        else
+            _f = value;
+
+        _set_type(t);
+    }
+
+    void _set_str(const string_t& value, size_t idx) {
+        _make_array(idx + 1);
+        _set(value, _array->s_data, idx);
+        _type = variable_t::type_t::STRING;
+        _invalidate();
+    }
+
+    void _set_long64(long64_t value, variable_t::type_t t, size_t idx) {
+        _make_array(idx + 1);
+        _set(value, _array->i_data, idx);
+        _type = t;
+        _invalidate();
+    }
+
+    void _set_double(double_t value, variable_t::type_t t, size_t idx) {
+        _make_array(idx + 1);
+        _set(value, _array->f_data, idx);
+        _type = t;
+        _invalidate();
     }
 
 
@@ -81,6 +166,8 @@ public:
 
     static bool is_integer(const std::string& value);
     static bool is_real(const std::string& value);
+    static bool is_integer(const char* value, size_t size);
+    static bool is_real(const char* value, size_t size);
 
     explicit variant_t(const any_variant_t&) : _type(type_t::ANY) {}
 
@@ -99,19 +186,18 @@ public:
     variant_t(const variant_t& v);
     variant_t& operator=(const variant_t& v);
 
-    variant_t(variant_t&& v);
-    variant_t& operator=(variant_t&& v);
+    variant_t(variant_t&& v) noexcept;
+    variant_t& operator=(variant_t&& v) noexcept;
 
     void describe_type(std::stringstream& ss) const noexcept;
 
     void resize(size_t size) {
-        _vector_type = size > 0;
-        _vect_size = size;
         _resize(size);
     }
 
-    bool is_vector() const noexcept { return _vector_type; }
-    size_t vector_size() const noexcept { return _vect_size; }
+    bool is_vector() const noexcept { return _array != nullptr; }
+    bool is_scalar_str() const noexcept { return !_array && _has_value && _type == type_t::STRING; }
+    size_t vector_size() const noexcept { return _array ? _array->size : 0; }
     real_t to_real(size_t idx = 0) const { return real_t(to_double(idx)); }
     double_t to_double(size_t idx = 0) const;
     integer_t to_int(size_t idx = 0) const { return integer_t(to_long64(idx)); }
@@ -135,20 +221,34 @@ public:
 
     const string_t& to_str(size_t idx = 0) const;
 
-    void set_str(const string_t& value) { _set(value, _s_data, type_t::STRING); }
-    void set_str(const char* value) { _set<string_t>(value, _s_data, type_t::STRING); }
-    void set_int(const integer_t& value)  { _set(value, _i_data, type_t::INTEGER); }
-    void set_real(real_t value) { _set(value, _f_data, type_t::FLOAT); }
-    void set_double(double_t value) { _set(value, _f_data, type_t::DOUBLE); }
-    void set_bool(bool_t value) { _set(value, _i_data, type_t::BOOLEAN); }
-    void set_long64(long64_t value) { _set(value, _i_data, type_t::LONG64); }
-    void set_str(const string_t& value, size_t idx) { _set(value, _s_data, type_t::STRING, idx);  }
-    void set_str(const char* value, size_t idx) { _set<string_t>(value, _s_data, type_t::STRING, idx); }
-    void set_int(const integer_t& value, size_t idx) { _set(value, _i_data, type_t::INTEGER, idx); }
-    void set_real(real_t value, size_t idx) { _set(value, _f_data, type_t::FLOAT, idx);  }
-    void set_double(double_t value, size_t idx) { _set(value, _f_data, type_t::DOUBLE); }
-    void set_bool(bool_t value, size_t idx) { _set(value, _i_data, type_t::BOOLEAN, idx); }
-    void set_long64(long64_t value, size_t idx) { _set(value, _i_data, type_t::LONG64, idx); }
+    //! Converts every element once and keeps the results along with the
+    //! value: strings parsed as numbers, numbers formatted as strings.
+    //! Later conversions just read them, until the value is modified.
+    //! Copies of the variant do not keep them.
+    void cache_conversions();
+
+    //! Returns true if cache_conversions() results are available
+    bool has_cached_conversions() const noexcept {
+        return _conv != nullptr;
+    }
+
+    //! Reserves room for size characters of a scalar string
+    void reserve_str(size_t size) { if (is_scalar_str()) _s.reserve(size); }
+
+    void set_str(const string_t& value) { _set_str(value); }
+    void set_str(const char* value) { _set_str(value); }
+    void set_int(const integer_t& value)  { _set_long64(value, type_t::INTEGER); }
+    void set_real(real_t value) { _set_double(value, type_t::FLOAT); }
+    void set_double(double_t value) { _set_double(value, type_t::DOUBLE); }
+    void set_bool(bool_t value) { _set_long64(value, type_t::BOOLEAN); }
+    void set_long64(long64_t value) { _set_long64(value, type_t::LONG64); }
+    void set_str(const string_t& value, size_t idx) { _set_str(value, idx);  }
+    void set_str(const char* value, size_t idx) { _set_str(value, idx); }
+    void set_int(const integer_t& value, size_t idx) { _set_long64(value, type_t::INTEGER, idx); }
+    void set_real(real_t value, size_t idx) { _set_double(value, type_t::FLOAT, idx);  }
+    void set_double(double_t value, size_t idx) { _set_double(value, type_t::DOUBLE, idx); }
+    void set_bool(bool_t value, size_t idx) { _set_long64(value, type_t::BOOLEAN, idx); }
+    void set_long64(long64_t value, size_t idx) { _set_long64(value, type_t::LONG64, idx); }
 
     variant_t operator[](size_t idx) const;
     friend variant_t operator+(const variant_t& a, const variant_t& b);
@@ -173,53 +273,90 @@ public:
 
 protected:
     type_t _type = type_t::UNDEFINED;
-    size_t _vect_size = 0;
-    bool _vector_type = false;
 
-    mutable std::vector<string_t> _s_data;
-    std::vector<long64_t> _i_data;
-    std::vector<double_t> _f_data;
+    // Scalar value: the inline member matching the kind of _type holds
+    // it, if _has_value is set; members of other kinds cannot be read.
+    // _s also holds the last to_str() of numbers
+    bool _has_value = false;
 
-    const std::string& _at_s(size_t idx) const {
+    union {
+        long64_t _i = 0;
+        double_t _f;
+    };
+
+    mutable string_t _s;
+
+    // Vector value, nullptr for scalars
+    std::shared_ptr<array_t> _array;
+
+    // Results of cache_conversions(), one per element: parsed() tells
+    // which of the numbers of a string are valid (it may not be a
+    // number), the string of a number is always valid
+    struct conversions_t {
+        enum { DOUBLE = 1, LONG64 = 2 };
+
+        std::vector<std::uint8_t> parsed;
+        std::vector<double_t> f;
+        std::vector<long64_t> i;
+        std::vector<string_t> s;
+    };
+
+    std::unique_ptr<const conversions_t> _conv;
+
+    static void _check_index(bool valid) {
         rt_error_code_t::get_instance().throw_if(
-            idx >= _s_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
+            !valid, rt_error_code_t::E_VAL_OUT_OF_RANGE);
+    }
+
+    const std::string& _at_s(size_t idx) const {
+        if (!_array) {
+            _check_index(idx == 0 && _has_value && !is_number());
+            return _s;
+        }
 
-        return _s_data[idx];
+        _check_index(idx < _array->s_data.size());
+        return _array->s_data[idx];
     }
 
     std::string& _at_s(size_t idx) {
-        rt_error_code_t::get_instance().throw_if(
-            idx >= _s_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
-
-        return _s_data[idx];
+        _unshare();
+        _invalidate();
+        return const_cast<std::string&>(
+            static_cast<const variant_t*>(this)->_at_s(idx));
     }
 
     const long64_t& _at_i(size_t idx) const {
-        rt_error_code_t::get_instance().throw_if(
-            idx >= _i_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
+        if (!_array) {
+            _check_index(idx == 0 && _has_value && is_integral());
+            return _i;
+        }
 
-        return _i_data[idx];
+        _check_index(idx < _array->i_data.size());
+        return _array->i_data[idx];
     }
 
     long64_t& _at_i(size_t idx) {
-        rt_error_code_t::get_instance().throw_if(
-            idx >= _i_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
-
-        return _i_data[idx];
+        _unshare();
+        _invalidate();
+        return const_cast<long64_t&>(
+            static_cast<const variant_t*>(this)->_at_i(idx));
     }
 
     const double_t& _at_f(size_t idx) const {
-        rt_error_code_t::get_instance().throw_if(
-            idx >= _f_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
+        if (!_array) {
+            _check_index(idx == 0 && _has_value && is_float());
+            return _f;
+        }
 
-        return _f_data[idx];
+        _check_index(idx < _array->f_data.size());
+        return _array->f_data[idx];
     }
 
     double_t& _at_f(size_t idx) {
-        rt_error_code_t::get_instance().throw_if(
-            idx >= _f_data.size(), rt_error_code_t::E_VAL_OUT_OF_RANGE);
-
-        return _f_data[idx];
+        _unshare();
+        _invalidate();
+        return const_cast<double_t&>(
+            static_cast<const variant_t*>(this)->_at_f(idx));
     }
 
 };
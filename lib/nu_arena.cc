@@ -0,0 +1,132 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+arena_t::~arena_t()
+{
+    while (_head) {
+        auto next = _head->next;
+        ::operator delete(_head);
+        _head = next;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int arena_t::size_class(size_t size, size_t align) noexcept
+{
+    if (align > alignof(std::max_align_t))
+        return -1;
+
+    size_t class_size = size_t(1) << MIN_CLASS_SHIFT;
+
+    for (int i = 0; i < CLASSES; ++i, class_size <<= 1) {
+        if (size <= class_size)
+            return i;
+    }
+
+    return -1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void* arena_t::bump(size_t size, size_t align)
+{
+    auto aligned = [&](char* p) {
+        return reinterpret_cast<char*>(
+            (reinterpret_cast<uintptr_t>(p) + align - 1) & ~(align - 1));
+    };
+
+    char* p = aligned(_ptr);
+
+    if (!_ptr || p + size > _end) {
+        const size_t header = sizeof(std::max_align_t);
+        size_t block_size = _next_block_size;
+
+        while (block_size < size + align + header)
+            block_size <<= 1;
+
+        if (_next_block_size < MAX_BLOCK_SIZE)
+            _next_block_size <<= 1;
+
+        auto block = static_cast<block_t*>(::operator new(block_size));
+        block->next = _head;
+        _head = block;
+
+        ++_blocks;
+        _capacity += block_size;
+
+        _ptr = reinterpret_cast<char*>(block) + header;
+        _end = reinterpret_cast<char*>(block) + block_size;
+
+        p = aligned(_ptr);
+    }
+
+    _ptr = p + size;
+
+    return p;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void* arena_t::allocate(size_t size, size_t align)
+{
+    const int i = size_class(size, align);
+
+    if (i < 0)
+        return bump(size, align);
+
+    if (_free[i]) {
+        auto chunk = _free[i];
+        _free[i] = chunk->next;
+        return chunk;
+    }
+
+    return bump(size_t(1) << (i + MIN_CLASS_SHIFT), alignof(std::max_align_t));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void arena_t::deallocate(void* p, size_t size, size_t align) noexcept
+{
+    const int i = size_class(size, align);
+
+    // Large chunks are released with the arena
+    if (!p || i < 0)
+        return;
+
+    auto chunk = static_cast<chunk_t*>(p);
+    chunk->next = _free[i];
+    _free[i] = chunk;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,169 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_atom.h"
+
+#include <mutex>
+#include <unordered_map>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+class atom_tbl_t {
+public:
+    using entry_t = atom_t::entry_t;
+
+    static atom_tbl_t& get_instance() {
+        // Never destroyed, so that atoms held by static objects
+        // may be released at exit in any order
+        static atom_tbl_t* _instance = new atom_tbl_t();
+        return *_instance;
+    }
+
+    std::shared_ptr<const entry_t> intern(const std::string& s);
+
+    size_t size() {
+        size_t n = 0;
+
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            n += shard.tbl.size();
+        }
+
+        return n;
+    }
+
+private:
+    struct slot_t {
+        std::weak_ptr<const entry_t> entry;
+
+        // Number of entries created for the string and not yet deleted.
+        // An expired entry may still be waiting for release() while a
+        // new one is created, so the slot (whose key both entries refer
+        // to) is erased with the last of them
+        size_t entries = 0;
+    };
+
+    // Strings are spread by hash over shards locked independently, so
+    // threads interning different strings seldom wait for each other
+    enum { SHARDS = 16 };
+
+    struct shard_t {
+        std::mutex mtx;
+        std::unordered_map<std::string, slot_t> tbl;
+    };
+
+    shard_t& get_shard(size_t hash) noexcept {
+        return _shards[hash % SHARDS];
+    }
+
+    void release(const entry_t* entry);
+
+    shard_t _shards[SHARDS];
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+std::shared_ptr<const atom_tbl_t::entry_t> atom_tbl_t::intern(
+    const std::string& s)
+{
+    const size_t hash = std::hash<std::string>()(s);
+    auto& shard = get_shard(hash);
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto i = shard.tbl.find(s);
+
+    if (i == shard.tbl.end())
+        i = shard.tbl.emplace(s, slot_t()).first;
+
+    auto entry = i->second.entry.lock();
+
+    if (entry)
+        return entry;
+
+    // New string, or its last atom is being released by another thread
+    entry = std::shared_ptr<const entry_t>(
+        new entry_t{ &i->first, hash },
+        [this](const entry_t* p) { release(p); });
+
+    i->second.entry = entry;
+    ++i->second.entries;
+
+    return entry;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void atom_tbl_t::release(const entry_t* entry)
+{
+    {
+        auto& shard = get_shard(entry->hash);
+
+        std::lock_guard<std::mutex> lock(shard.mtx);
+
+        auto i = shard.tbl.find(*entry->str);
+
+        if (--i->second.entries == 0)
+            shard.tbl.erase(i);
+    }
+
+    delete entry;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+atom_t::atom_t(const std::string& s)
+{
+    if (!s.empty())
+        _entry = atom_tbl_t::get_instance().intern(s);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+atom_t::atom_t(const char* s)
+{
+    if (s && *s)
+        _entry = atom_tbl_t::get_instance().intern(s);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t atom_t::interned() noexcept
+{
+    return atom_tbl_t::get_instance().size();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const std::string& atom_t::empty_str() noexcept
+{
+    static const std::string empty;
+    return empty;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,57 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_any.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_any_t::release(handle_t& operand)
+{
+    // Operands queued by the destructors of the nodes being released
+    static thread_local func_args_t* queue = nullptr;
+
+    if (!operand)
+        return;
+
+    if (queue) {
+        queue->push_back(std::move(operand));
+        return;
+    }
+
+    func_args_t pending;
+    pending.push_back(std::move(operand));
+
+    queue = &pending;
+
+    while (!pending.empty()) {
+        handle_t node(std::move(pending.back()));
+        pending.pop_back();
+
+        // If this is the last owner, the destructor of the node
+        // queues its own operands
+        node.reset();
+    }
+
+    queue = nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
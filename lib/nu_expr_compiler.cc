@@ -15,11 +15,17 @@
 #include "nu_expr_function.h"
 #include "nu_expr_literal.h"
 #include "nu_expr_subscrop.h"
-#include "nu_expr_syntax_tree.h"
 #include "nu_expr_unary_op.h"
 #include "nu_expr_var.h"
+#include "nu_variable.h"
 #include "nu_variant.h"
 
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -30,19 +36,15 @@ namespace nu {
 
 expr_any_t::handle_t expr_compiler_t::compile(expr_tknzr_t& tknzr)
 {
-    token_list_t tl;
+    token_list_t tl((token_list_t::allocator_t(_arena)));
 
     // Split expression in tokens
     tknzr.get_tknlst(tl);
 
-    // Create a syntax tree
-    expr_syntax_tree_t est;
-
-    // Finally parse the expression tree in order to generate
+    // Finally parse the token list in order to generate
     // an executable object
     convert_subscription_brackets(tl);
-    tl = est(tl);
-    return parse(tl);
+    return parse_tree(tl);
 }
 
 
@@ -50,16 +52,236 @@ expr_any_t::handle_t expr_compiler_t::compile(expr_tknzr_t& tknzr)
 
 expr_any_t::handle_t expr_compiler_t::compile(token_list_t tl, size_t expr_pos)
 {
-    expr_syntax_tree_t est;
+    if (tl.get_allocator().arena() != _arena) {
+        token_list_t atl((token_list_t::allocator_t(_arena)));
+        atl += tl;
+        tl = std::move(atl);
+    }
+
     convert_subscription_brackets(tl);
-    tl = est(tl);
-    return parse(tl);
+    return parse_tree(tl);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::compile(
+    expr_tknzr_t& tknzr, compilation_t& c)
+{
+    c.scan(tknzr);
+
+    // expr_tknzr_t does not produce subscription brackets, so the
+    // tokens are parsed as they have been scanned
+    return parse_tree(c._tl, &c);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::recompile(expr_tknzr_t& tknzr,
+    compilation_t& c, size_t pos, size_t erased, size_t inserted)
+{
+    if (!c.rescan(tknzr, pos, erased, inserted))
+        c.scan(tknzr);
+
+    return parse_tree(c._tl, &c);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Precedence levels of the binary operators, from the loosest to the
+// tightest binding one. All the binary operators are left-associative
+enum {
+    LEVEL_BITWISE,
+    LEVEL_RELATIONAL_ANDOR,
+    LEVEL_RELATIONAL,
+    LEVEL_MATH_SUM,
+    LEVEL_MATH_MUL_DIV,
+    LEVEL_STRUCT_ACCESS
+};
+
+static const int no_level = -1;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the precedence level of the binary operator op, or no_level
+static int binary_level(const std::string& op)
+{
+    static const std::unordered_map<std::string, int> levels = {
+        { "band", LEVEL_BITWISE },
+        { "bor", LEVEL_BITWISE },
+        { "bxor", LEVEL_BITWISE },
+        { "bshl", LEVEL_BITWISE },
+        { "bshr", LEVEL_BITWISE },
+        { "and", LEVEL_RELATIONAL_ANDOR },
+        { "or", LEVEL_RELATIONAL_ANDOR },
+        { "xor", LEVEL_RELATIONAL_ANDOR },
+        { "=", LEVEL_RELATIONAL },
+        { "<", LEVEL_RELATIONAL },
+        { ">", LEVEL_RELATIONAL },
+        { ">=", LEVEL_RELATIONAL },
+        { "<=", LEVEL_RELATIONAL },
+        { "<>", LEVEL_RELATIONAL },
+        { "+", LEVEL_MATH_SUM },
+        { "-", LEVEL_MATH_SUM },
+        { "*", LEVEL_MATH_MUL_DIV },
+        { "/", LEVEL_MATH_MUL_DIV },
+        { "^", LEVEL_MATH_MUL_DIV },
+        { "\\", LEVEL_MATH_MUL_DIV },
+        { "mod", LEVEL_MATH_MUL_DIV },
+        { "div", LEVEL_MATH_MUL_DIV },
+        { ".", LEVEL_STRUCT_ACCESS }
+    };
+
+    auto i = levels.find(op);
+    return i != levels.end() ? i->second : no_level;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the tokens of a list in order, skipping blanks and new lines.
+ * The parser visits each token once, so an expression is compiled in
+ * time linear in its length
+ */
+class expr_compiler_t::cursor_t {
+public:
+    explicit cursor_t(const token_list_t& tl)
+        : _tl(tl)
+        , _tokens(tl.data())
+    {
+        skip_blanks();
+    }
+
+    const token_list_t& tl() const noexcept {
+        return _tl;
+    }
+
+    bool end() const noexcept {
+        return _pos >= _tokens.size();
+    }
+
+    //! Returns the current token. The cursor must not be at the end
+    const token_t& peek() const noexcept {
+        return _tokens[_pos];
+    }
+
+    //! Returns true if the current token has given type and identifier
+    bool is(tkncl_t type, const char* id) const noexcept {
+        return !end() && peek().type() == type && _tl.identifier(peek()) == id;
+    }
+
+    //! Moves to the next token, returning the current one
+    const token_t& next() noexcept {
+        _last = _pos++;
+        skip_blanks();
+        return _tokens[_last];
+    }
+
+    //! Returns the index of the current token
+    size_t index() const noexcept {
+        return _pos;
+    }
+
+    //! Returns the index of the last token read
+    size_t last() const noexcept {
+        return _last;
+    }
+
+    //! Returns the position of the last token read
+    size_t last_position() const noexcept {
+        return _last != token_list_t::npos ? _tokens[_last].position() : 0;
+    }
+
+    //! Moves past the token of index last, as if the tokens up to it
+    //! had been read
+    void skip_to(size_t last) noexcept {
+        _last = last;
+        _pos = last + 1;
+        skip_blanks();
+    }
+
+    //! Throws a syntax error at position pos of the expression
+    void error(size_t pos, const std::string& msg = "") const {
+        syntax_error(_tl.expression(), pos, msg);
+    }
+
+    //! Throws the error for the current token, which cannot follow
+    //! an expression
+    void unexpected() const {
+        if (is(tkncl_t::OPERATOR, NU_EXPREVAL_PARAM_SEP))
+            throw exception_t(
+                "'" NU_EXPREVAL_PARAM_SEP "' operator not defined");
+
+        throw exception_t(NU_EXPREVAL_ERROR_STR__SYNTAXERROR);
+    }
+
+    //! Reads the ")" closing the sub-expression opened by begin
+    void close(const token_t& begin) {
+        if (end())
+            error(begin.position(), "Missing token, error");
+
+        if (peek().type() != tkncl_t::SUBEXP_END)
+            unexpected();
+
+        next();
+    }
+
+private:
+    void skip_blanks() noexcept {
+        while (!end()
+            && (peek().type() == tkncl_t::BLANK
+                   || peek().type() == tkncl_t::NEWLINE)) {
+            ++_pos;
+        }
+    }
+
+    const token_list_t& _tl;
+    const token_list_t::data_t& _tokens;
+    size_t _pos = 0;
+    size_t _last = token_list_t::npos;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::make_literal(
+    const std::string& text, variant_t::type_t type)
+{
+    const atom_t key(text);
+
+    auto range = _literals.equal_range(key);
+
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second.first == type)
+            return i->second.second;
+    }
+
+    expr_any_t::handle_t node(
+        make_node<expr_literal_t>(variant_t(text, type)));
+
+    _literals.emplace(key, std::make_pair(type, node));
+
+    return node;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-variant_t::type_t expr_compiler_t::get_type(const token_t& t)
+expr_program_t::handle_t expr_compiler_t::compile_to_program(
+    expr_tknzr_t& tknzr)
+{
+    return make_node<expr_program_t>(compile(tknzr));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t::type_t expr_compiler_t::get_type(
+    const token_list_t& tl, const token_t& t)
 {
     switch (t.type()) {
     case tkncl_t::INTEGRAL:
@@ -76,7 +298,7 @@ variant_t::type_t expr_compiler_t::get_type(const token_t& t)
     }
 
     if (t.type() == tkncl_t::IDENTIFIER
-        && (t.identifier() == "true" || t.identifier() == "false")) {
+        && (tl.identifier(t) == "true" || tl.identifier(t) == "false")) {
         return variant_t::type_t::BOOLEAN;
     }
 
@@ -86,204 +308,519 @@ variant_t::type_t expr_compiler_t::get_type(const token_t& t)
 
 /* -------------------------------------------------------------------------- */
 
-expr_any_t::handle_t expr_compiler_t::parse_operand(token_list_t& tl)
+/**
+ * Builds the tree of an expression reading its tokens once.
+ * Binary operators are folded by precedence level as in the
+ * shunting-yard algorithm: pending operators, unary minus signs,
+ * brackets and function calls are kept in an explicit stack, together
+ * with the operands they are waiting for, so parsing deeply nested or
+ * very long expressions does not consume native stack.
+ * The arguments following the first one of a function call are parsed
+ * as the former multi-pass rewriter left them, which only grouped the
+ * first argument of each call: their operators are applied from right to
+ * left regardless of precedence. An operator found in place of an operand
+ * stands for 0 and ends the chain of operators, the next one is applied
+ * to its result and what follows a second missing operand is ignored
+ * (e.g. in "max(1, 2 * -1 + 5 * -3)" the second argument is
+ * 2 * 0 - (1 + 5 * 0)).
+ * Parsing the tokens of a compilation, the stack is saved every few
+ * tokens and the subtrees of brackets and function calls are recorded:
+ * once an edit is scanned, the parser resumes from the last state saved
+ * before it and takes the subtrees it did not change as they are
+ */
+class expr_compiler_t::parser_t {
+public:
+    parser_t(expr_compiler_t& compiler, cursor_t& c,
+        compilation_t* compilation = nullptr)
+        : _compiler(compiler)
+        , _c(c)
+        , _tl(c.tl())
+        , _compilation(compilation)
+    {
+    }
+
+    parser_t(const parser_t&) = delete;
+    parser_t& operator=(const parser_t&) = delete;
+
+    //! Parses the expression up to the end of the token list
+    expr_any_t::handle_t operator()();
+
+    enum class frame_kind_t { BINARY, MINUS, GROUP, CALL };
+
+    // Tokens are referred by index, so that a stack saved in a
+    // compilation remains valid when the tokens following it change
+    struct frame_t {
+        frame_kind_t kind;
+
+        // Operator, "-" sign, "(" of a group or name of a function
+        size_t token;
+
+        // Precedence level of a binary operator
+        int level;
+
+        // "(" of the arguments of a function call
+        size_t begin;
+        func_args_t args;
+
+        // True if the frame is part of an argument following the first
+        // one of a function call (see trailing())
+        bool trailing;
+
+        // True if an operand of the argument being read, or of the
+        // sub-expression, has been found missing in a trailing argument
+        bool missing;
+    };
+
+    struct operand_t {
+        expr_any_t::handle_t node;
+
+        // Token the operand was made of, if it is a literal not
+        // enclosed in brackets (see make_binary()), or npos
+        size_t bare;
+    };
+
+private:
+    enum class state_t { EXPRESSION, OPERAND, OPERATOR, DONE };
+
+    // Minimum number of tokens between two states saved, and maximum
+    // size of a stack worth saving
+    enum { CHECKPOINT_TOKENS = 64, CHECKPOINT_SIZE = 32 };
+
+    const token_t& token(size_t idx) const noexcept {
+        return _tl.data()[idx];
+    }
+
+    const token_t* bare_token(size_t idx) const noexcept {
+        return idx != token_list_t::npos ? &token(idx) : nullptr;
+    }
+
+    //! Returns true if the parser is reading an argument following the
+    //! first one of a function call, or a part of it
+    bool trailing() const noexcept {
+        return !_frames.empty() && _frames.back().trailing;
+    }
+
+    void push_frame(frame_kind_t kind, size_t token, int level = 0,
+        size_t begin = token_list_t::npos)
+    {
+        _frames.push_back(
+            frame_t{ kind, token, level, begin, {}, trailing(), false });
+    }
+
+    void push_zero() {
+        push_operand(_compiler.make_node<expr_literal_t>(variant_t(0)));
+    }
+
+    expr_any_t::handle_t pop_operand() {
+        auto node = std::move(_operands.back().node);
+        _operands.pop_back();
+        return node;
+    }
+
+    state_t begin_expression();
+    state_t read_operand();
+    state_t read_operator();
+    state_t end_call();
+
+    bool read_inc_dec();
+    void skip_argument();
+    bool merge_exponent();
+
+    void push_operand(expr_any_t::handle_t node,
+        size_t bare = token_list_t::npos);
+
+    void reduce(int min_level);
+
+    expr_any_t::handle_t make_identifier(const token_t& t);
+
+    state_t resume();
+    void checkpoint();
+    bool reuse_subtree(size_t first);
+    void add_subtree(size_t first, const expr_any_t::handle_t& node);
+
+    expr_compiler_t& _compiler;
+    cursor_t& _c;
+    const token_list_t& _tl;
+    compilation_t* _compilation;
+
+    std::vector<frame_t> _frames;
+    std::vector<operand_t> _operands;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+struct expr_compiler_t::compilation_t::checkpoint_t {
+    // Index of the current token and of the last token read
+    size_t index;
+    size_t last;
+
+    std::vector<parser_t::frame_t> frames;
+    std::vector<parser_t::operand_t> operands;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::parser_t::operator()()
 {
-    // An empty list generates an empty expression
-    if (tl.empty())
-        return expr_any_t::handle_t(std::make_shared<expr_empty_t>());
+    state_t state = resume();
 
-    reduce_brackets(tl);
+    while (state != state_t::DONE) {
+        switch (state) {
+        case state_t::EXPRESSION:
+            state = begin_expression();
+            break;
 
-    token_t t(*tl.begin());
+        case state_t::OPERAND:
+            checkpoint();
+            state = read_operand();
+            break;
 
-    switch (t.type()) {
-    case tkncl_t::OPERATOR:
+        case state_t::OPERATOR:
+        default:
+            state = read_operator();
+            break;
+        }
+    }
+
+    assert(_frames.empty() && _operands.size() == 1);
+
+    return pop_operand();
+}
 
-        // ++<identifier> / --<identifier>
-        if (tl.size() > 1 && (tl[0].identifier() == NU_EXPREVAL_OP_INC
-                                 || tl[0].identifier() == NU_EXPREVAL_OP_DEC)
-            && tl[1].type() == tkncl_t::IDENTIFIER) {
-            auto ret_handle
-                = std::make_shared<expr_unary_op_t>(tl[0].identifier(),
-                    std::make_shared<expr_var_t>(tl[1].identifier()));
 
-            tl.data().erase(tl.begin(), tl.begin() + 2);
+/* -------------------------------------------------------------------------- */
 
-            return tl.empty() ? ret_handle : parse(tl, ret_handle);
+// An expression, an argument of a function call or a sub-expression
+// enclosed in brackets may begin with a unary operator
+expr_compiler_t::parser_t::state_t
+expr_compiler_t::parser_t::begin_expression()
+{
+    // A leading operator of a trailing argument is a missing operand
+    // (see read_operand())
+    if (trailing())
+        return read_inc_dec() ? state_t::OPERATOR : state_t::OPERAND;
+
+    // A leading "+" is ignored
+    if (_c.is(tkncl_t::OPERATOR, "+")) {
+        _c.next();
+
+        if (_c.end()) {
+            push_operand(_compiler.make_node<expr_empty_t>());
+            return state_t::OPERATOR;
         }
+    }
 
-        break;
+    // -x is compiled as 0-x, where x is the operand only
+    if (_c.is(tkncl_t::OPERATOR, "-")) {
+        _c.next();
+        push_frame(frame_kind_t::MINUS, _c.last());
+        return state_t::OPERAND;
+    }
 
-    case tkncl_t::IDENTIFIER:
+    return read_inc_dec() ? state_t::OPERATOR : state_t::OPERAND;
+}
 
-        // <identifier>+"(" => function
-        if (tl.size() > 1 && tl[1].type() == tkncl_t::SUBEXP_BEGIN) {
-            std::string function_name = tl.begin()->identifier();
-            func_args_t function_args;
-
-            size_t size = 0;
-
-            if (tl.size() > 2 && tl[2].type() == tkncl_t::SUBEXP_END) {
-                size = 3;
-            } else {
-                // Splits the parameters list in listes of tokens
-                auto params = tl.get_parameters(
-                    { NU_EXPREVAL_BEGIN_SUBEXPR_OP, tkncl_t::SUBEXP_BEGIN },
-                    { NU_EXPREVAL_END_SUBEXPR_OP, tkncl_t::SUBEXP_END },
-                    { NU_EXPREVAL_PARAM_SEP, tkncl_t::OPERATOR });
-
-                // size here starts from 2.
-                // One is identifier and one is "("
-                size = 2;
-
-                // Parse each parameter
-                for (auto par : params) {
-                    auto param_tl = par;
-                    size += par.size() + 1;
-
-                    reduce_brackets(param_tl);
-
-                    expr_any_t::handle_t arg(parse(param_tl));
-                    function_args.push_back(arg);
-                }
-            }
 
-            // Remove from original list token parsed
-            tl.data().erase(tl.begin(), tl.begin() + size);
+/* -------------------------------------------------------------------------- */
 
-            expr_any_t::handle_t ret_handle = nullptr;
+// Reads ++<identifier> / --<identifier>, if it is the next operand
+bool expr_compiler_t::parser_t::read_inc_dec()
+{
+    if (!_c.is(tkncl_t::OPERATOR, NU_EXPREVAL_OP_INC)
+        && !_c.is(tkncl_t::OPERATOR, NU_EXPREVAL_OP_DEC)) {
+        return false;
+    }
 
-            if (function_name.size() > 1
-                && *function_name.rbegin() == NU_EXPREVAL_BEGIN_SUBSCR) {
-                ret_handle = std::make_shared<expr_subscrop_t>(
-                    function_name.substr(0, function_name.size() - 1),
-                    function_args);
+    const std::string& op = _tl.identifier(_c.next());
 
-            } else {
-                // Create an executable object for the parsed function
-                ret_handle = std::make_shared<expr_function_t>(
-                    function_name, function_args);
-            }
+    syntax_error_if(_c.end() || _c.peek().type() != tkncl_t::IDENTIFIER,
+        "'" + op + "' operator not defined");
 
-            // Check if we have other to parse
-            // YES: call recursively parse()
-            // NO : return the handle to executable object
-            return tl.empty() ? ret_handle : parse(tl, ret_handle);
-        } else {
-            std::string id = t.identifier();
-            expr_any_t::handle_t ret_handle;
+    push_operand(_compiler.make_node<expr_unary_op_t>(op,
+        _compiler.make_node<expr_var_t>(_tl.identifier(_c.next()))));
 
-            if (id == "true") {
-                tl.data().erase(tl.begin());
+    return true;
+}
 
-                ret_handle = expr_any_t::handle_t(
-                    std::make_shared<expr_literal_t>(variant_t(true)));
-            } else if (id == "false") {
-                tl.data().erase(tl.begin());
 
-                ret_handle = expr_any_t::handle_t(
-                    std::make_shared<expr_literal_t>(variant_t(false)));
-            }
-            // 0xnnnnnn  (hexadecimal value)
-            else if (id.size() > 2 && id.c_str()[0] == '&'
-                && toupper(id.c_str()[1]) == 'H') {
-                tl.data().erase(tl.begin());
-
-                std::string hex = id.substr(2, id.size() - 2);
-                int n = 0;
-                sscanf(hex.c_str(), "%x", &n);
-
-                ret_handle = expr_any_t::handle_t(
-                    std::make_shared<expr_literal_t>(variant_t(n)));
-            } else {
-                std::string id = t.identifier();
-
-                if (id.size() > 1 && *id.rbegin() == NU_EXPREVAL_BEGIN_SUBSCR)
-                    id = id.substr(0, id.size() - 1);
-
-                if (! variable_t::is_valid_name(id)) {
-                    syntax_error(t.expression(), t.position(),
-                        "\"" + id + "\" is an invalid identifier");
-                }
+/* -------------------------------------------------------------------------- */
 
-                tl.data().erase(tl.begin());
+// Reads a literal, a variable, or opens a function call or
+// a sub-expression enclosed in brackets
+expr_compiler_t::parser_t::state_t expr_compiler_t::parser_t::read_operand()
+{
+    if (_c.end())
+        _c.error(_c.last_position());
 
-                ret_handle
-                    = expr_any_t::handle_t(std::make_shared<expr_var_t>(id));
-            }
+    if (trailing() && _c.peek().type() == tkncl_t::OPERATOR) {
+        if (read_inc_dec())
+            return state_t::OPERATOR;
+
+        // An operator cannot be repeated, and only a sign may follow "("
+        const token_t& prev = token(_c.last());
+        const std::string& op = _tl.identifier(_c.peek());
 
-            return tl.empty() ? ret_handle : parse(tl, ret_handle);
+        if ((prev.type() == tkncl_t::SUBEXP_BEGIN && op != "+" && op != "-")
+            || (prev.type() == tkncl_t::OPERATOR
+                   && _tl.identifier(prev) == op)) {
+            _c.error(_c.peek().position());
         }
 
-        break;
+        // The operand is 0 and ends the chain of operators
+        push_zero();
+        reduce(LEVEL_BITWISE);
+
+        auto frame = _frames.rbegin();
+
+        while (frame->kind == frame_kind_t::BINARY)
+            ++frame;
+
+        if (frame->missing)
+            skip_argument();
 
+        frame->missing = true;
 
+        return state_t::OPERATOR;
+    }
+
+    const token_t& t = _c.next();
+    const size_t t_idx = _c.last();
+
+    switch (t.type()) {
     // numerical token
     case tkncl_t::INTEGRAL:
     case tkncl_t::REAL:
     case tkncl_t::STRING_LITERAL:
-        do {
-            // Remove token from tl
-            tl.data().erase(tl.begin());
+        // Generates a literal using a "variant" instance
+        // for the executable object
+        push_operand(
+            _compiler.make_literal(_tl.identifier(t), get_type(_tl, t)),
+            t_idx);
+
+        return state_t::OPERATOR;
+
+    case tkncl_t::IDENTIFIER:
+
+        // <identifier>+"(" => function
+        if (!_c.end() && _c.peek().type() == tkncl_t::SUBEXP_BEGIN) {
+            if (reuse_subtree(t_idx))
+                return state_t::OPERATOR;
 
-            // Generates a literal using a "variant" instance
-            // for the executable object
-            expr_any_t::handle_t ret_handle(std::make_shared<expr_literal_t>(
-                variant_t(t.identifier(), get_type(t))));
+            _c.next();
+            push_frame(frame_kind_t::CALL, t_idx, 0, _c.last());
 
-            // Check if we have other to parse
-            // YES: call recursively parse()
-            // NO : return the handle to executable object
-            return tl.empty() ? ret_handle : parse(tl, ret_handle);
-        } while (0);
+            if (!_c.end() && _c.peek().type() == tkncl_t::SUBEXP_END) {
+                _c.next();
+                return end_call();
+            }
+
+            return state_t::EXPRESSION;
+        }
+
+        push_operand(make_identifier(t));
+
+        return state_t::OPERATOR;
 
     case tkncl_t::SUBEXP_BEGIN:
 
+        // "()" is not an expression
+        if (!_c.end() && _c.peek().type() == tkncl_t::SUBEXP_END)
+            throw exception_t(NU_EXPREVAL_ERROR_STR__SYNTAXERROR);
+
+        if (reuse_subtree(t_idx))
+            return state_t::OPERATOR;
+
         // this is a sub expression
-        if (tl.size() >= 3) {
-            token_list_t rtl = tl.sublist(
-                tkncl_t::SUBEXP_BEGIN, tkncl_t::SUBEXP_END, 0, false);
+        push_frame(frame_kind_t::GROUP, t_idx);
+
+        return state_t::EXPRESSION;
+
+    default:
+        break;
+    }
+
+    _c.error(t.position());
+
+    return state_t::DONE;
+}
 
-            tl.data().erase(tl.begin(), tl.begin() + rtl.size());
 
-            // simplify "(((....)))"
-            reduce_brackets(rtl);
+/* -------------------------------------------------------------------------- */
+
+// Reads the binary operator following an operand, or ends the innermost
+// (sub-)expression
+expr_compiler_t::parser_t::state_t expr_compiler_t::parser_t::read_operator()
+{
+    if (!_c.end() && _c.peek().type() == tkncl_t::OPERATOR) {
+        const token_t& op = _c.peek();
+        const int level = binary_level(_tl.identifier(op));
+
+        if (level != no_level) {
+            // Operators on the stack which bind at least as tight as op
+            // take the operands on their left. The ones of a trailing
+            // argument are all applied from right to left instead
+            if (!trailing())
+                reduce(level);
+
+            _c.next();
+
+            if (trailing() && merge_exponent())
+                return state_t::OPERATOR;
 
-            // Parse the sub-expression
-            auto h(parse(rtl));
+            push_frame(frame_kind_t::BINARY, _c.last(),
+                trailing() ? int(LEVEL_BITWISE) : level);
 
-            // Check if we have other to parse
-            // YES: call recursively parse()
-            // NO : return the handle to executable object
-            return tl.empty() ? h : parse(tl, h);
-        } else {
-            return expr_any_t::handle_t(std::make_shared<expr_empty_t>());
+            return state_t::OPERAND;
         }
 
-        break;
+        // The separator ends an argument of a function call
+        if (_tl.identifier(op) != NU_EXPREVAL_PARAM_SEP)
+            _c.error(op.position());
+    }
 
-    default:
-        break;
+    reduce(LEVEL_BITWISE);
+
+    if (_frames.empty()) {
+        if (!_c.end())
+            _c.unexpected();
+
+        return state_t::DONE;
     }
 
-    return expr_any_t::handle_t(std::make_shared<expr_empty_t>());
+    auto& frame = _frames.back();
+
+    if (frame.kind == frame_kind_t::GROUP) {
+        const size_t begin = frame.token;
+
+        _c.close(token(begin));
+        _frames.pop_back();
+
+        auto node = pop_operand();
+        add_subtree(begin, node);
+        push_operand(std::move(node));
+
+        return state_t::OPERATOR;
+    }
+
+    assert(frame.kind == frame_kind_t::CALL);
+
+    frame.args.push_back(pop_operand());
+
+    if (_c.is(tkncl_t::OPERATOR, NU_EXPREVAL_PARAM_SEP)) {
+        _c.next();
+        frame.trailing = true;
+        frame.missing = false;
+        return state_t::EXPRESSION;
+    }
+
+    _c.close(token(frame.begin));
+
+    return end_call();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Creates the function call on the top of the stack, whose arguments
+// have all been parsed
+expr_compiler_t::parser_t::state_t expr_compiler_t::parser_t::end_call()
+{
+    const size_t t_idx = _frames.back().token;
+    const token_t& t = token(t_idx);
+    func_args_t function_args(std::move(_frames.back().args));
+
+    _frames.pop_back();
+
+    const std::string& function_name = _tl.identifier(t);
+
+    if (function_name.size() > 1
+        && *function_name.rbegin() == NU_EXPREVAL_BEGIN_SUBSCR) {
+        expr_any_t::handle_t node(_compiler.make_node<expr_subscrop_t>(
+            function_name.substr(0, function_name.size() - 1),
+            function_args));
+
+        add_subtree(t_idx, node);
+        push_operand(std::move(node));
+
+        return state_t::OPERATOR;
+    }
+
+    // Create an executable object for the parsed function
+    auto fn_handle
+        = _compiler.make_node<expr_function_t>(function_name, function_args);
+
+    // A name which is not bound to any built-in function
+    // can only be the subscription of an array variable
+    if (!fn_handle->is_builtin() && !variable_t::is_valid_name(function_name)) {
+        _c.error(t.position(), "\"" + function_name + "\" is not defined");
+    }
+
+    add_subtree(t_idx, fn_handle);
+    push_operand(fn_handle);
+
+    return state_t::OPERATOR;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-bool expr_compiler_t::parse_operator(token_list_t& tl, std::string& value)
+// Skips the tokens up to the end of the argument or of the sub-expression
+// being read
+void expr_compiler_t::parser_t::skip_argument()
 {
-    if (tl.empty())
+    size_t depth = 0;
+
+    while (!_c.end()) {
+        const token_t& t = _c.peek();
+
+        if (t.type() == tkncl_t::SUBEXP_BEGIN) {
+            ++depth;
+        } else if (t.type() == tkncl_t::SUBEXP_END) {
+            if (depth == 0)
+                break;
+
+            --depth;
+        } else if (depth == 0
+            && _c.is(tkncl_t::OPERATOR, NU_EXPREVAL_PARAM_SEP)) {
+            break;
+        }
+
+        _c.next();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// A real number whose exponent has a sign is scanned as three tokens
+// (e.g. "1E" "+" "2"). Within a trailing argument they are merged into
+// one literal as soon as the sign has been read, since the operators
+// there are not reduced in order (see make_binary())
+bool expr_compiler_t::parser_t::merge_exponent()
+{
+    auto& left = _operands.back();
+    const std::string& sign = _tl.identifier(token(_c.last()));
+
+    if (left.bare == token_list_t::npos || _c.end()
+        || token(left.bare).type() != tkncl_t::REAL
+        || _c.peek().type() != tkncl_t::INTEGRAL
+        || (sign != "+" && sign != "-")) {
         return false;
+    }
 
-    token_t t(*tl.begin());
+    const std::string& mantissa = _tl.identifier(token(left.bare));
 
-    if (t.type() != tkncl_t::OPERATOR)
+    if (mantissa.empty()
+        || ::toupper(*mantissa.rbegin()) != NU_EXPREVAL_EXPONENT_SYMB) {
         return false;
+    }
 
-    value = t.identifier();
-    tl.data().erase(tl.begin());
+    left.node = _compiler.make_literal(
+        mantissa + sign + _tl.identifier(_c.next()), variant_t::type_t::DOUBLE);
+
+    left.bare = token_list_t::npos;
 
     return true;
 }
@@ -291,104 +828,234 @@ bool expr_compiler_t::parse_operator(token_list_t& tl, std::string& value)
 
 /* -------------------------------------------------------------------------- */
 
-expr_any_t::handle_t expr_compiler_t::parse(
-    token_list_t& tl, expr_any_t::handle_t first_param)
+void expr_compiler_t::parser_t::push_operand(
+    expr_any_t::handle_t node, size_t bare)
 {
-    fix_real_numbers(tl);
+    if (!_frames.empty() && _frames.back().kind == frame_kind_t::MINUS) {
+        const token_t& minus = token(_frames.back().token);
+        _frames.pop_back();
+
+        node = _compiler.make_binary(_tl, minus,
+            _compiler.make_literal("0", variant_t::type_t::LONG64), node,
+            nullptr, nullptr);
 
-    if (!first_param)
-        first_param = parse_operand(tl);
+        bare = token_list_t::npos;
+    }
 
-    if (!first_param)
-        return nullptr;
+    _operands.push_back(operand_t{ std::move(node), bare });
+}
 
-    if (tl.empty())
-        return first_param;
 
-    reduce_brackets(tl);
+/* -------------------------------------------------------------------------- */
 
-    std::string op;
-    expr_any_t::handle_t second_param;
+void expr_compiler_t::parser_t::reduce(int min_level)
+{
+    // All the binary operators are left-associative
+    while (!_frames.empty() && _frames.back().kind == frame_kind_t::BINARY
+        && _frames.back().level >= min_level) {
+        operand_t right(std::move(_operands.back()));
+        _operands.pop_back();
 
-    auto err = !parse_operator(tl, op);
-    syntax_error_if(err, NU_EXPREVAL_ERROR_STR__SYNTAXERROR);
+        auto& left = _operands.back();
 
-    second_param = parse_operand(tl);
-    syntax_error_if(!second_param, NU_EXPREVAL_ERROR_STR__SYNTAXERROR);
+        left.node = _compiler.make_binary(_tl, token(_frames.back().token),
+            left.node, right.node, bare_token(left.bare),
+            bare_token(right.bare));
 
-    // resolve built-in operator implementation
-    auto operator_implementation = global_operator_tbl_t::get_instance()[op];
+        left.bare = token_list_t::npos;
 
-    // create the expression object using built-in
-    // operator_implementation semantic
-    return expr_any_t::handle_t(std::make_shared<expr_bin_t>(
-        operator_implementation, first_param, second_param));
+        _frames.pop_back();
+    }
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-void expr_compiler_t::fix_real_numbers(token_list_t& rtl)
+// Restores the last state saved in the compilation, if any
+expr_compiler_t::parser_t::state_t expr_compiler_t::parser_t::resume()
 {
-    auto tl_size = rtl.size();
+    if (!_compilation || _compilation->_checkpoints.empty())
+        return state_t::EXPRESSION;
+
+    const auto& cp = *_compilation->_checkpoints.back();
 
-    if (tl_size < 3)
+    _c.skip_to(cp.last);
+    _frames = cp.frames;
+    _operands = cp.operands;
+
+    return state_t::OPERAND;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Saves the state of the parser, which is about to read an operand, in
+// the compilation. The stack only depends on the tokens read and on the
+// current one (see begin_expression()), so it is valid until an edit
+// changes any of them
+void expr_compiler_t::parser_t::checkpoint()
+{
+    if (!_compilation)
         return;
 
-    token_list_t tl(std::move(rtl));
-    rtl.clear();
+    auto& checkpoints = _compilation->_checkpoints;
 
-    for (decltype(tl_size) i = 0; i < tl_size; ++i) {
-        auto tk = tl[i];
+    const size_t from = checkpoints.empty() ? 0 : checkpoints.back()->index;
 
-        if (tk.type() == tkncl_t::REAL) {
-            const std::string& id = tk.identifier();
+    if (_c.index() < from + CHECKPOINT_TOKENS
+        || _c.last() == token_list_t::npos
+        || _frames.size() + _operands.size() > CHECKPOINT_SIZE) {
+        return;
+    }
 
-            if (!id.empty()
-                && ::toupper(id.c_str()[id.size() - 1])
-                    == NU_EXPREVAL_EXPONENT_SYMB
-                && i < (tl_size - 1)) {
-                const auto& tkop = tl[i + 1];
+    size_t size = 0;
 
-                if (tkop.type() == tkncl_t::OPERATOR
-                    && (tkop.identifier() == "+" || tkop.identifier() == "-")
-                    && i < (tl_size - 2)) {
-                    const auto& tkn = tl[i + 2];
+    for (const auto& frame : _frames)
+        size += frame.args.size();
 
-                    if (tkn.type() == tkncl_t::INTEGRAL) {
-                        std::string new_id = tk.identifier() + tkop.identifier()
-                            + tkn.identifier();
+    if (size > CHECKPOINT_SIZE)
+        return;
 
-                        tk.set_identifier(new_id);
+    auto cp = std::make_shared<compilation_t::checkpoint_t>();
 
-                        i += 2;
-                    }
-                }
-            }
-        }
+    cp->index = _c.index();
+    cp->last = _c.last();
+    cp->frames = _frames;
+    cp->operands = _operands;
+
+    checkpoints.push_back(std::move(cp));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Takes the subtree of the compilation beginning with token first as
+// the next operand, if it is still valid
+bool expr_compiler_t::parser_t::reuse_subtree(size_t first)
+{
+    if (!_compilation)
+        return false;
+
+    auto subtree = _compilation->find_subtree(first);
 
-        rtl += tk;
+    // The same tokens are parsed differently within a trailing argument
+    if (!subtree || subtree->trailing != trailing())
+        return false;
+
+    _c.skip_to(subtree->last);
+    push_operand(subtree->node);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Records the subtree of the tokens from first up to the last one read
+void expr_compiler_t::parser_t::add_subtree(
+    size_t first, const expr_any_t::handle_t& node)
+{
+    if (_compilation) {
+        _compilation->_new_subtrees.push_back(
+            compilation_t::subtree_t{ first, _c.last(), node, trailing() });
     }
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-void expr_compiler_t::reduce_brackets(token_list_t& rtl)
+expr_any_t::handle_t expr_compiler_t::parser_t::make_identifier(
+    const token_t& t)
 {
-    // simplify "(((....)))"
-    while (rtl.size() > 2 && rtl.begin()->type() == tkncl_t::SUBEXP_BEGIN
-        && (rtl.end() - 1)->type() == tkncl_t::SUBEXP_END) {
-        auto substr
-            = rtl.sublist(tkncl_t::SUBEXP_BEGIN, tkncl_t::SUBEXP_END, 0, false);
-
-        if (substr.size() == (rtl.size())) {
-            --rtl; // remove head token
-            rtl--; // remove tail token
-        } else {
-            break;
+    std::string id = _tl.identifier(t);
+
+    if (id == "true")
+        return _compiler.make_node<expr_literal_t>(variant_t(true));
+
+    if (id == "false")
+        return _compiler.make_node<expr_literal_t>(variant_t(false));
+
+    // 0xnnnnnn  (hexadecimal value)
+    if (id.size() > 2 && id.c_str()[0] == '&'
+        && toupper(id.c_str()[1]) == 'H') {
+        std::string hex = id.substr(2, id.size() - 2);
+        int n = 0;
+        sscanf(hex.c_str(), "%x", &n);
+
+        return _compiler.make_node<expr_literal_t>(variant_t(n));
+    }
+
+    if (id.size() > 1 && *id.rbegin() == NU_EXPREVAL_BEGIN_SUBSCR)
+        id = id.substr(0, id.size() - 1);
+
+    if (!variable_t::is_valid_name(id))
+        _c.error(t.position(), "\"" + id + "\" is an invalid identifier");
+
+    return _compiler.make_node<expr_var_t>(id);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::make_binary(const token_list_t& tl,
+    const token_t& op, expr_any_t::handle_t left, expr_any_t::handle_t right,
+    const token_t* bare_left, const token_t* bare_right)
+{
+    const std::string& id = tl.identifier(op);
+
+    // A real number whose exponent has a sign is scanned as three
+    // tokens (e.g. "1E" "+" "2"), merged here into one literal
+    if (bare_left && bare_right && bare_left->type() == tkncl_t::REAL
+        && bare_right->type() == tkncl_t::INTEGRAL
+        && (id == "+" || id == "-")) {
+        const std::string& mantissa = tl.identifier(*bare_left);
+
+        if (!mantissa.empty()
+            && ::toupper(*mantissa.rbegin()) == NU_EXPREVAL_EXPONENT_SYMB) {
+            return make_literal(mantissa + id + tl.identifier(*bare_right),
+                variant_t::type_t::DOUBLE);
         }
     }
+
+    // bind the built-in operator opcode, unless the application replaced
+    // its implementation in the operator table
+    bin_opcode_t opcode;
+
+    if (global_operator_tbl_t::get_opcode(id, opcode))
+        return make_node<expr_bin_t>(opcode, left, right);
+
+    // otherwise resolve a user defined operator implementation
+    const auto& optbl = global_operator_tbl_t::get_instance();
+
+    syntax_error_if(!optbl.is_defined(id) || !optbl[id],
+        "'" + id + "' operator not defined");
+
+    return make_node<expr_bin_t>(optbl[id], left, right);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_compiler_t::parse_tree(
+    token_list_t& tl, compilation_t* compilation)
+{
+    // Literals are shared within a single expression only, so that the
+    // compiler does not keep alive nodes of expressions it returned
+    _literals.clear();
+
+    cursor_t c(tl);
+    expr_any_t::handle_t expr;
+
+    // An empty list generates an empty expression
+    if (c.end()) {
+        expr = make_node<expr_empty_t>();
+    } else {
+        expr = parser_t(*this, c, compilation)();
+    }
+
+    _literals.clear();
+
+    return expr;
 }
 
 
@@ -406,30 +1073,226 @@ void expr_compiler_t::convert_subscription_brackets(token_list_t& rtl)
 
         if (token.type() == tkncl_t::SUBSCR_BEGIN) {
             if (token_prev) {
-                auto id = token_prev->identifier();
+                auto id = rtl.identifier(*token_prev);
 
                 if (!id.empty() && *id.rbegin() != NU_EXPREVAL_BEGIN_SUBSCR) {
                     id.push_back(NU_EXPREVAL_BEGIN_SUBSCR);
-                    token_prev->set_identifier(id);
+                    token_prev->set_id(rtl.get_tbl()->intern(id));
                 }
             }
 
             token.set_type(tkncl_t::SUBEXP_BEGIN);
 
-            if (token.identifier() == NU_EXPREVAL_BEGIN_SUBSCR_OP)
-                token.set_identifier(NU_EXPREVAL_BEGIN_SUBEXPR_OP);
+            if (rtl.identifier(token) == NU_EXPREVAL_BEGIN_SUBSCR_OP) {
+                token.set_id(
+                    rtl.get_tbl()->intern(NU_EXPREVAL_BEGIN_SUBEXPR_OP));
+            }
         }
 
         else if (token.type() == tkncl_t::SUBSCR_END) {
             token.set_type(tkncl_t::SUBEXP_END);
 
-            if (token.identifier() == NU_EXPREVAL_END_SUBSCR_OP)
-                token.set_identifier(NU_EXPREVAL_END_SUBEXPR_OP);
+            if (rtl.identifier(token) == NU_EXPREVAL_END_SUBSCR_OP) {
+                token.set_id(
+                    rtl.get_tbl()->intern(NU_EXPREVAL_END_SUBEXPR_OP));
+            }
         }
     }
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+// Replaces count elements of v beginning at first with the ones of with
+template <class V, class W>
+static void splice(V& v, size_t first, size_t count, const W& with)
+{
+    const size_t n = std::min(count, with.size());
+
+    std::copy(with.begin(), with.begin() + n, v.begin() + first);
+
+    if (count > n)
+        v.erase(v.begin() + first + n, v.begin() + first + count);
+    else
+        v.insert(v.begin() + first + n, with.begin() + n, with.end());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_compiler_t::compilation_t::scan(expr_tknzr_t& tknzr)
+{
+    _tl = token_list_t(tknzr.get_tbl());
+    _extents.clear();
+    _subtrees.clear();
+    _new_subtrees.clear();
+    _checkpoints.clear();
+
+    _exp_pos = tknzr.get_exp_pos();
+    _size = tknzr.size();
+
+    size_t reach = 0;
+
+    for (size_t cptr = 0; cptr < _size; cptr = tknzr.tell()) {
+        tknzr.seek(cptr);
+        _tl += tknzr.next();
+
+        reach = std::max(reach, tknzr.reach());
+        _extents.push_back(extent_t{ uint32_t(tknzr.tell()), uint32_t(reach) });
+    }
+
+    _scanned = true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_compiler_t::compilation_t::rescan(
+    expr_tknzr_t& tknzr, size_t pos, size_t erased, size_t inserted)
+{
+    if (!_scanned || tknzr.get_exp_pos() != _exp_pos || pos > _size
+        || erased > _size - pos
+        || tknzr.size() != _size - erased + inserted) {
+        return false;
+    }
+
+    merge_subtrees();
+
+    // Tokens whose scan read no symbol from pos onwards are unchanged
+    const size_t first = size_t(std::partition_point(_extents.begin(),
+                                    _extents.end(),
+                                    [pos](const extent_t& e) {
+                                        return e.reach < pos;
+                                    })
+        - _extents.begin());
+
+    // Scan the edited text until a token ends where an old one ended
+    // past the edit: the text which follows has not changed, so the old
+    // tokens which follow are only moved by the edit
+    const auto& tbl = _tl.get_tbl();
+    const size_t edit_end = pos + inserted;
+
+    size_t cptr = first ? _extents[first - 1].end : 0;
+    size_t reach = first ? _extents[first - 1].reach : 0;
+    size_t resync = _extents.size();
+
+    std::vector<token_t> tokens;
+    std::vector<extent_t> extents;
+
+    while (cptr < tknzr.size()) {
+        tknzr.seek(cptr);
+        token_t t = tknzr.next();
+
+        cptr = tknzr.tell();
+        reach = std::max(reach, tknzr.reach());
+
+        t.set_id(tbl->intern(tknzr.identifier(t)));
+        tokens.push_back(t);
+        extents.push_back(extent_t{ uint32_t(cptr), uint32_t(reach) });
+
+        if (cptr < edit_end)
+            continue;
+
+        const size_t old_end = cptr - inserted + erased;
+
+        auto i = std::lower_bound(_extents.begin() + first, _extents.end(),
+            old_end,
+            [](const extent_t& e, size_t end) { return e.end < end; });
+
+        if (i != _extents.end() && i->end == old_end) {
+            resync = size_t(i - _extents.begin()) + 1;
+            break;
+        }
+    }
+
+    const size_t removed = resync - first;
+    const size_t added = tokens.size();
+
+    auto& data = _tl.data();
+
+    splice(data, first, removed, tokens);
+    splice(_extents, first, removed, extents);
+
+    for (size_t i = first + added; i < data.size(); ++i) {
+        data[i].set_position(data[i].position() - erased + inserted);
+
+        auto& e = _extents[i];
+        e.end = uint32_t(e.end - erased + inserted);
+
+        reach = std::max(reach, size_t(e.reach) - erased + inserted);
+        e.reach = uint32_t(reach);
+    }
+
+    tbl->set_expression(tknzr.get_tbl()->expression_ptr());
+    _size = tknzr.size();
+
+    // Subtrees and states depending on the tokens replaced are dropped
+    size_t kept = 0;
+
+    for (size_t i = 0; i < _subtrees.size(); ++i) {
+        auto& subtree = _subtrees[i];
+
+        if (subtree.first >= resync) {
+            subtree.first = subtree.first - removed + added;
+            subtree.last = subtree.last - removed + added;
+        } else if (subtree.last >= first) {
+            continue;
+        }
+
+        if (kept != i)
+            _subtrees[kept] = std::move(subtree);
+
+        ++kept;
+    }
+
+    _subtrees.erase(_subtrees.begin() + kept, _subtrees.end());
+
+    _checkpoints.erase(
+        std::partition_point(_checkpoints.begin(), _checkpoints.end(),
+            [first](const std::shared_ptr<const checkpoint_t>& cp) {
+                return cp->index < first;
+            }),
+        _checkpoints.end());
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const expr_compiler_t::compilation_t::subtree_t*
+expr_compiler_t::compilation_t::find_subtree(size_t first) const noexcept
+{
+    auto i = std::lower_bound(_subtrees.begin(), _subtrees.end(), first,
+        [](const subtree_t& s, size_t first) { return s.first < first; });
+
+    return i != _subtrees.end() && i->first == first ? &*i : nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_compiler_t::compilation_t::merge_subtrees()
+{
+    auto by_first = [](const subtree_t& a, const subtree_t& b) {
+        return a.first < b.first;
+    };
+
+    const size_t middle = _subtrees.size();
+
+    std::sort(_new_subtrees.begin(), _new_subtrees.end(), by_first);
+
+    _subtrees.insert(_subtrees.end(),
+        std::make_move_iterator(_new_subtrees.begin()),
+        std::make_move_iterator(_new_subtrees.end()));
+
+    _new_subtrees.clear();
+
+    std::inplace_merge(_subtrees.begin(), _subtrees.begin() + middle,
+        _subtrees.end(), by_first);
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 } // namespace
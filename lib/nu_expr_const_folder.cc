@@ -0,0 +1,114 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_const_folder.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_var.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_const_folder_t::is_pure(const expr_any_t::handle_t& expr)
+{
+    if (!expr || expr->empty()
+        || dynamic_cast<const expr_literal_t*>(expr.get())
+        || dynamic_cast<const expr_var_t*>(expr.get())) {
+        return true;
+    }
+
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin) {
+        return bin->opcode() != bin_opcode_t::CUSTOM && is_pure(bin->left())
+            && is_pure(bin->right());
+    }
+
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (!fn)
+        return false;
+
+    // Array subscriptions just read the variable
+    if (!dynamic_cast<const expr_subscrop_t*>(fn)) {
+        if (fn->is_builtin()
+            && !global_function_tbl_t::get_instance().is_pure(fn->name())) {
+            return false;
+        }
+    }
+
+    for (const auto& arg : fn->get_args())
+        if (!is_pure(arg))
+            return false;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_const_folder_t::rewrite(
+    const expr_any_t::handle_t& expr)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (bin) {
+        if (bin->opcode() == bin_opcode_t::CUSTOM)
+            return expr;
+
+        // Logical operators are not short-circuited ("false and e"
+        // still evaluates e), so they are folded like the others
+        if (!dynamic_cast<const expr_literal_t*>(bin->left().get())
+            || !dynamic_cast<const expr_literal_t*>(bin->right().get())) {
+            return expr;
+        }
+    } else if (fn && !dynamic_cast<const expr_subscrop_t*>(fn)) {
+        if (!fn->is_builtin()
+            || !global_function_tbl_t::get_instance().is_pure(fn->name())) {
+            return expr;
+        }
+
+        for (const auto& arg : fn->get_args()) {
+            if (arg && !arg->empty()
+                && !dynamic_cast<const expr_literal_t*>(arg.get())) {
+                return expr;
+            }
+        }
+    } else {
+        return expr;
+    }
+
+    // Literals do not refer any variable, so an empty context is enough
+    ctx_t ctx;
+
+    try {
+        return std::make_shared<expr_literal_t>(expr->eval(ctx));
+    } catch (...) {
+        // Keep the expression: the error will be raised evaluating it
+    }
+
+    return expr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
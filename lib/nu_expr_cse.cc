@@ -0,0 +1,185 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_cse.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_const_folder.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_rewriter.h"
+#include "nu_expr_var.h"
+
+#include <sstream>
+#include <typeinfo>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_cse_t::operator()(const expr_any_t::handle_t& expr)
+{
+    if (!expr || !expr_const_folder_t::is_pure(expr))
+        return expr;
+
+    _ids.clear();
+    _nodes.clear();
+    _cached = false;
+
+    const auto root = intern(expr);
+
+    auto epoch = std::make_shared<std::uint64_t>(0);
+    auto ret = build(root, epoch);
+
+    if (_cached)
+        ret = std::make_shared<expr_cse_root_t>(ret, epoch);
+
+    _ids.clear();
+    _nodes.clear();
+
+    return ret;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string expr_cse_t::key(const expr_any_t::handle_t& expr) const
+{
+    std::stringstream ss;
+
+    if (!expr)
+        return ss.str();
+
+    const auto* node = expr.get();
+    ss << typeid(*node).name() << "|";
+
+    auto literal = dynamic_cast<const expr_literal_t*>(node);
+
+    if (literal) {
+        const auto& value = literal->value();
+        ss << int(value.get_type()) << ":";
+
+        if (value.is_vector())
+            ss << "@" << node;
+        else if (value.is_float())
+            ss << std::hexfloat << value.to_double();
+        else if (value.is_integral())
+            ss << value.to_long64();
+        else if (value.get_type() == variant_t::type_t::STRING)
+            ss << value.to_str().size() << ":" << value.to_str();
+
+        return ss.str();
+    }
+
+    auto bin = dynamic_cast<const expr_bin_t*>(node);
+
+    if (bin) {
+        ss << int(bin->opcode());
+        return ss.str();
+    }
+
+    if (dynamic_cast<const expr_var_t*>(node)
+        || dynamic_cast<const expr_function_t*>(node)) {
+        ss << expr->name();
+        return ss.str();
+    }
+
+    if (expr->empty())
+        return ss.str();
+
+    // Any other node is never merged
+    ss << "@" << node;
+    return ss.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_cse_t::id_t expr_cse_t::intern(const expr_any_t::handle_t& expr)
+{
+    std::vector<id_t> children;
+
+    if (expr) {
+        for (const auto& child : expr_rewriter_t::children(expr))
+            children.push_back(intern(child));
+    }
+
+    std::string k = key(expr) + "(";
+
+    for (auto id : children)
+        k += std::to_string(id) + ",";
+
+    k += ")";
+
+    auto i = _ids.find(k);
+
+    if (i != _ids.end())
+        return i->second;
+
+    for (auto id : children)
+        ++_nodes[id].parents;
+
+    node_t node;
+    node.expr = expr;
+    node.children = std::move(children);
+
+    const id_t id = _nodes.size();
+    _nodes.push_back(std::move(node));
+    _ids.insert(std::make_pair(k, id));
+
+    return id;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_cse_t::build(id_t id, const eval_epoch_t& epoch)
+{
+    if (_nodes[id].shared || !_nodes[id].expr)
+        return _nodes[id].shared;
+
+    const auto expr = _nodes[id].expr;
+    const auto children = _nodes[id].children;
+
+    auto args = expr_rewriter_t::children(expr);
+    bool changed = false;
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        auto arg = build(children[i], epoch);
+
+        if (arg != args[i]) {
+            args[i] = arg;
+            changed = true;
+        }
+    }
+
+    auto ret = changed ? expr_rewriter_t::rebuild(expr, args) : expr;
+
+    // Leaves are cheaper to evaluate than to cache
+    if (_nodes[id].parents > 1 && !children.empty()) {
+        ret = std::make_shared<expr_cached_t>(ret, epoch);
+        _cached = true;
+    }
+
+    _nodes[id].shared = ret;
+
+    return ret;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,659 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_egraph.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_const_folder.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_var.h"
+
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <unordered_set>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+using type_t = variant_t::type_t;
+using handle_t = expr_any_t::handle_t;
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_egraph_t::node_cost(bin_opcode_t op) const
+{
+    switch (op) {
+    case bin_opcode_t::DIV:
+    case bin_opcode_t::INT_DIV:
+    case bin_opcode_t::INT_MOD:
+        return 4;
+
+    case bin_opcode_t::POW:
+        return 20;
+
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_egraph_t::node_cost(const std::string& name) const
+{
+    if (name == "abs" || name == "sign" || name == "min" || name == "max"
+        || name == "int") {
+        return 2;
+    }
+
+    return 20;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_egraph_t::leaf_cost(const handle_t&) const
+{
+    return 1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_egraph_t::clear()
+{
+    _parent.clear();
+    _classes.clear();
+    _memo.clear();
+    _leaves.clear();
+    _node_count = 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::find(size_t id) const
+{
+    while (_parent[id] != id) {
+        _parent[id] = _parent[_parent[id]];
+        id = _parent[id];
+    }
+
+    return id;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_egraph_t::merge(size_t a, size_t b)
+{
+    a = find(a);
+    b = find(b);
+
+    if (a == b)
+        return false;
+
+    _parent[b] = a;
+
+    auto& ca = _classes[a];
+    auto& cb = _classes[b];
+
+    ca.nodes.insert(ca.nodes.end(), cb.nodes.begin(), cb.nodes.end());
+    cb.nodes.clear();
+
+    if (ca.type == type_t::UNDEFINED)
+        ca.type = cb.type;
+
+    if (!ca.has_value && cb.has_value) {
+        ca.has_value = true;
+        ca.value = cb.value;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Restores the invariant that equal nodes (same operator and operand
+// classes) belong to the same class
+void expr_egraph_t::rebuild()
+{
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        _memo.clear();
+
+        std::vector<std::pair<size_t, size_t>> equal;
+
+        for (size_t id = 0; id < _classes.size(); ++id) {
+            if (find(id) != id)
+                continue;
+
+            std::unordered_set<std::string> seen;
+            std::vector<enode_t> nodes;
+
+            for (auto node : _classes[id].nodes) {
+                for (auto& arg : node.args)
+                    arg = find(arg);
+
+                const auto key = key_of(node);
+
+                if (!seen.insert(key).second)
+                    continue;
+
+                nodes.push_back(node);
+
+                auto i = _memo.emplace(key, id);
+
+                if (!i.second)
+                    equal.emplace_back(i.first->second, id);
+            }
+
+            _classes[id].nodes.swap(nodes);
+        }
+
+        for (const auto& e : equal)
+            changed = merge(e.first, e.second) || changed;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string expr_egraph_t::key_of(const enode_t& node) const
+{
+    std::stringstream ss;
+
+    switch (node.kind) {
+    case enode_t::kind_t::LEAF: {
+        const auto& expr = _leaves[node.leaf];
+        auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+        if (literal && !literal->value().is_vector()) {
+            const auto& value = literal->value();
+            ss << "#" << int(value.get_type()) << ":";
+
+            if (value.is_float())
+                ss << std::hexfloat << value.to_double();
+            else if (value.is_integral())
+                ss << value.to_long64();
+            else
+                ss << value.to_str();
+        } else if (dynamic_cast<const expr_var_t*>(expr.get())) {
+            ss << "$" << expr->name();
+        } else {
+            // Opaque expressions are never merged
+            ss << "@" << node.leaf;
+        }
+
+        break;
+    }
+
+    case enode_t::kind_t::BIN:
+        ss << "b" << int(node.op);
+        break;
+
+    case enode_t::kind_t::CALL:
+        ss << "f" << node.name;
+        break;
+    }
+
+    for (const auto& arg : node.args)
+        ss << "," << find(arg);
+
+    return ss.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::add(enode_t node)
+{
+    for (auto& arg : node.args)
+        arg = find(arg);
+
+    const auto key = key_of(node);
+    auto i = _memo.find(key);
+
+    if (i != _memo.end())
+        return find(i->second);
+
+    const size_t id = _classes.size();
+
+    eclass_t c;
+
+    switch (node.kind) {
+    case enode_t::kind_t::LEAF: {
+        const auto& expr = _leaves[node.leaf];
+        auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+        if (literal && !literal->value().is_vector()) {
+            c.has_value = true;
+            c.value = literal->value();
+        }
+
+        c.type = _types.type_of(expr);
+        break;
+    }
+
+    case enode_t::kind_t::BIN: {
+        const auto& a = _classes[node.args[0]];
+        const auto& b = _classes[node.args[1]];
+
+        c.type = expr_type_inference_t::result_type(node.op, a.type, b.type);
+
+        // Constant operands are folded, unless the operator has no
+        // defined result for them (e.g. true - false), which cannot be
+        // represented by a literal
+        if (a.has_value && b.has_value) {
+            try {
+                c.value = global_operator_tbl_t::apply(node.op, a.value, b.value);
+                c.has_value = c.value.get_type() != type_t::UNDEFINED;
+            } catch (...) {
+            }
+        }
+
+        break;
+    }
+
+    case enode_t::kind_t::CALL: {
+        auto info = global_function_tbl_t::get_instance().get_info(node.name);
+
+        if (info)
+            c.type = info->ret_type;
+
+        break;
+    }
+    }
+
+    node.seq = _node_count++;
+    c.nodes.push_back(node);
+
+    _classes.push_back(c);
+    _parent.push_back(id);
+    _memo[key] = id;
+
+    if (_classes[id].has_value && node.kind != enode_t::kind_t::LEAF) {
+        const auto value = _classes[id].value;
+        merge(id, add_leaf(std::make_shared<expr_literal_t>(value)));
+    }
+
+    return find(id);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::add_leaf(const handle_t& expr)
+{
+    enode_t node;
+    node.kind = enode_t::kind_t::LEAF;
+    node.leaf = _leaves.size();
+
+    _leaves.push_back(expr);
+
+    const auto classes = _classes.size();
+    const auto id = add(node);
+
+    // Already known
+    if (_classes.size() == classes)
+        _leaves.pop_back();
+
+    return id;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::add_bin(bin_opcode_t op, size_t a, size_t b)
+{
+    enode_t node;
+    node.kind = enode_t::kind_t::BIN;
+    node.op = op;
+    node.args = { a, b };
+
+    return add(node);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::add_call(const std::string& name, size_t arg)
+{
+    enode_t node;
+    node.kind = enode_t::kind_t::CALL;
+    node.name = name;
+    node.args = { arg };
+
+    return add(node);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t expr_egraph_t::load(const handle_t& expr)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin && bin->opcode() != bin_opcode_t::CUSTOM) {
+        const auto a = load(bin->left());
+        const auto b = load(bin->right());
+
+        return add_bin(bin->opcode(), a, b);
+    }
+
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (fn && fn->is_builtin() && !dynamic_cast<const expr_subscrop_t*>(fn)) {
+        const auto args = fn->get_args();
+        bool valid = !args.empty();
+
+        for (const auto& arg : args)
+            valid = valid && arg && !arg->empty();
+
+        if (valid) {
+            enode_t node;
+            node.kind = enode_t::kind_t::CALL;
+            node.name = fn->name();
+
+            for (const auto& arg : args)
+                node.args.push_back(load(arg));
+
+            return add(node);
+        }
+    }
+
+    return add_leaf(expr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_egraph_t::is_integral(size_t id) const
+{
+    return variable_t::is_integral(_classes[find(id)].type);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_egraph_t::is_number(size_t id) const
+{
+    return variable_t::is_number(_classes[find(id)].type);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_egraph_t::apply_rules(size_t id, const enode_t& node)
+{
+    bool changed = false;
+
+    auto unify = [&](size_t other) { changed = merge(id, other) || changed; };
+
+    // Reassociation and distribution are exact for (wrapping) integers
+    auto can_reorder = [&](std::initializer_list<size_t> ids) {
+        for (auto i : ids)
+            if (!is_integral(i) && !(_fast_math && is_number(i)))
+                return false;
+
+        return true;
+    };
+
+    auto nodes_of = [&](size_t c) { return _classes[find(c)].nodes; };
+
+    if (node.kind == enode_t::kind_t::BIN
+        && (node.op == bin_opcode_t::ADD || node.op == bin_opcode_t::MUL)) {
+        const auto a = find(node.args[0]);
+        const auto b = find(node.args[1]);
+
+        // a+b = b+a, a*b = b*a
+        if (is_number(a) && is_number(b))
+            unify(add_bin(node.op, b, a));
+
+        // (x+y)+b = x+(y+b), (x*y)*b = x*(y*b)
+        for (const auto& l : nodes_of(a)) {
+            if (l.kind != enode_t::kind_t::BIN || l.op != node.op)
+                continue;
+
+            const auto x = l.args[0];
+            const auto y = l.args[1];
+
+            if (can_reorder({ x, y, b }))
+                unify(add_bin(node.op, x, add_bin(node.op, y, b)));
+        }
+
+        // x*y+x*z = x*(y+z)
+        if (node.op == bin_opcode_t::ADD) {
+            for (const auto& l : nodes_of(a)) {
+                if (l.kind != enode_t::kind_t::BIN || l.op != bin_opcode_t::MUL)
+                    continue;
+
+                for (const auto& r : nodes_of(b)) {
+                    if (r.kind != enode_t::kind_t::BIN
+                        || r.op != bin_opcode_t::MUL
+                        || find(l.args[0]) != find(r.args[0])) {
+                        continue;
+                    }
+
+                    const auto x = l.args[0];
+                    const auto y = l.args[1];
+                    const auto z = r.args[1];
+
+                    if (can_reorder({ x, y, z }))
+                        unify(add_bin(bin_opcode_t::MUL, x,
+                            add_bin(bin_opcode_t::ADD, y, z)));
+                }
+            }
+        }
+
+        // exp(x)*exp(y) = exp(x+y)
+        if (_fast_math && node.op == bin_opcode_t::MUL) {
+            for (const auto& l : nodes_of(a)) {
+                if (l.kind != enode_t::kind_t::CALL || l.name != "exp"
+                    || l.args.size() != 1) {
+                    continue;
+                }
+
+                for (const auto& r : nodes_of(b)) {
+                    if (r.kind == enode_t::kind_t::CALL && r.name == "exp"
+                        && r.args.size() == 1 && is_number(l.args[0])
+                        && is_number(r.args[0])) {
+                        unify(add_call("exp",
+                            add_bin(bin_opcode_t::ADD, l.args[0], r.args[0])));
+                    }
+                }
+            }
+        }
+    }
+
+    // log(exp(x)) = x, exp(log(x)) = x
+    if (_fast_math && node.kind == enode_t::kind_t::CALL
+        && node.args.size() == 1
+        && (node.name == "log" || node.name == "exp")) {
+        const char* inverse = node.name == "log" ? "exp" : "log";
+
+        for (const auto& n : nodes_of(node.args[0])) {
+            if (n.kind == enode_t::kind_t::CALL && n.name == inverse
+                && n.args.size() == 1
+                && _classes[find(n.args[0])].type == type_t::DOUBLE) {
+                unify(n.args[0]);
+            }
+        }
+    }
+
+    return changed;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_egraph_t::extract(size_t root)
+{
+    const auto inf = std::numeric_limits<double_t>::infinity();
+
+    std::vector<double_t> cost(_classes.size(), inf);
+    std::vector<size_t> best(_classes.size());
+
+    auto cost_of = [&](const enode_t& node) {
+        double_t c = 0;
+
+        switch (node.kind) {
+        case enode_t::kind_t::LEAF:
+            c = leaf_cost(_leaves[node.leaf]);
+            break;
+
+        case enode_t::kind_t::BIN:
+            c = node_cost(node.op);
+            break;
+
+        case enode_t::kind_t::CALL:
+            c = node_cost(node.name);
+            break;
+        }
+
+        for (const auto& arg : node.args)
+            c += cost[find(arg)];
+
+        return c;
+    };
+
+    // Costs are lowered until a fixed point is reached. On ties the oldest
+    // node, that is the original one, is preferred
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (size_t id = 0; id < _classes.size(); ++id) {
+            if (find(id) != id)
+                continue;
+
+            const auto& nodes = _classes[id].nodes;
+
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                const auto c = cost_of(nodes[i]);
+
+                if (c < cost[id]
+                    || (c == cost[id] && c < inf
+                           && nodes[i].seq < nodes[best[id]].seq)) {
+                    cost[id] = c;
+                    best[id] = i;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::unordered_map<size_t, handle_t> built;
+
+    std::function<handle_t(size_t)> build = [&](size_t id) -> handle_t {
+        id = find(id);
+
+        auto i = built.find(id);
+
+        if (i != built.end())
+            return i->second;
+
+        const auto& node = _classes[id].nodes[best[id]];
+        handle_t expr;
+
+        switch (node.kind) {
+        case enode_t::kind_t::LEAF:
+            expr = _leaves[node.leaf];
+            break;
+
+        case enode_t::kind_t::BIN: {
+            auto a = build(node.args[0]);
+            auto b = build(node.args[1]);
+            expr = std::make_shared<expr_bin_t>(node.op, a, b);
+            break;
+        }
+
+        case enode_t::kind_t::CALL: {
+            func_args_t args;
+
+            for (const auto& arg : node.args)
+                args.push_back(build(arg));
+
+            expr = std::make_shared<expr_function_t>(node.name, args);
+            break;
+        }
+        }
+
+        built[id] = expr;
+
+        return expr;
+    };
+
+    return build(root);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_egraph_t::operator()(const handle_t& expr)
+{
+    if (!expr || expr->empty() || !expr_const_folder_t::is_pure(expr))
+        return expr;
+
+    clear();
+
+    const auto root = load(expr);
+
+    for (size_t i = 0; i < _max_iterations; ++i) {
+        std::vector<std::pair<size_t, enode_t>> matches;
+
+        for (size_t id = 0; id < _classes.size(); ++id)
+            if (find(id) == id)
+                for (const auto& node : _classes[id].nodes)
+                    matches.emplace_back(id, node);
+
+        bool changed = false;
+
+        for (const auto& m : matches) {
+            if (_node_count >= _max_nodes)
+                break;
+
+            changed = apply_rules(find(m.first), m.second) || changed;
+        }
+
+        rebuild();
+
+        if (!changed || _node_count >= _max_nodes)
+            break;
+    }
+
+    auto result = extract(root);
+
+    clear();
+
+    return result;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
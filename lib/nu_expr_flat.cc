@@ -0,0 +1,409 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_flat.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+
+#include <cassert>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_flat_t::expr_flat_t(const expr_any_t::handle_t& expr)
+{
+    assert(expr);
+    flatten(expr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::uint32_t expr_flat_t::add_node(kind_t kind, std::uint32_t aux,
+    std::uint32_t a, std::uint32_t b, std::uint8_t op)
+{
+    node_t node;
+
+    node.kind = kind;
+    node.op = op;
+    node.a = a;
+    node.b = b;
+    node.aux = aux;
+
+    _nodes.push_back(node);
+
+    return std::uint32_t(_nodes.size() - 1);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_flat_t::flatten(const expr_any_t::handle_t& expr)
+{
+    // Operators and math calls whose operands are being flattened.
+    // The operands are flattened one at a time, in evaluation order,
+    // using this stack instead of native recursion
+    struct frame_t {
+        kind_t kind;
+        std::uint8_t op;
+        std::uint32_t aux;
+        expr_any_t::handle_t operands[2];
+        size_t count;
+        size_t next;
+        std::uint32_t idx[2];
+    };
+
+    std::vector<frame_t> frames;
+    std::uint32_t ret = 0;
+
+    auto push_frame = [&](kind_t kind, std::uint8_t op, std::uint32_t aux,
+        expr_any_t::handle_t first, expr_any_t::handle_t second) {
+        const size_t count = second ? 2 : 1;
+
+        frames.push_back(frame_t{ kind, op, aux,
+            { std::move(first), std::move(second) }, count, 0, { 0, 0 } });
+    };
+
+    // Adds the node of a leaf into ret, otherwise pushes the frame of
+    // the node
+    auto enter = [&](const expr_any_t::handle_t& expr) {
+        auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+        if (literal) {
+            _consts.push_back(literal->value());
+            ret = add_node(kind_t::LITERAL, std::uint32_t(_consts.size() - 1));
+            return;
+        }
+
+        auto var = std::dynamic_pointer_cast<const expr_var_t>(expr);
+
+        if (var) {
+            _vars.push_back(var);
+            ret = add_node(kind_t::VAR, std::uint32_t(_vars.size() - 1));
+            return;
+        }
+
+        auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+        if (bin) {
+            // The right operand is evaluated first, as expr_bin_t does
+            if (bin->opcode() != bin_opcode_t::CUSTOM) {
+                push_frame(kind_t::BINARY, std::uint8_t(bin->opcode()), 0,
+                    bin->right(), bin->left());
+            } else {
+                _binops.push_back(bin->func());
+                push_frame(kind_t::BINARY_FN, 0,
+                    std::uint32_t(_binops.size() - 1), bin->right(),
+                    bin->left());
+            }
+
+            return;
+        }
+
+        auto fn = std::dynamic_pointer_cast<const expr_function_t>(expr);
+
+        if (fn && fn->is_builtin()
+            && !dynamic_cast<const expr_subscrop_t*>(fn.get())) {
+            call_t call;
+            call.func = fn;
+            call.args = fn->get_args();
+
+            auto info
+                = global_function_tbl_t::get_instance().get_info(fn->name());
+
+            auto valid = [&](size_t i) {
+                return call.args[i] && !call.args[i]->empty();
+            };
+
+            // Arguments are evaluated left to right, like built-in
+            // functions do
+            if (info && info->math_fn && call.args.size() == 1 && valid(0)) {
+                call.fn = info->math_fn;
+                auto arg = call.args[0];
+                _calls.push_back(std::move(call));
+
+                push_frame(kind_t::MATH, 0, std::uint32_t(_calls.size() - 1),
+                    std::move(arg), nullptr);
+                return;
+            }
+
+            if (info && info->math_fn2 && call.args.size() == 2 && valid(0)
+                && valid(1)) {
+                call.fn2 = info->math_fn2;
+                auto arg0 = call.args[0];
+                auto arg1 = call.args[1];
+                _calls.push_back(std::move(call));
+
+                push_frame(kind_t::MATH2, 0, std::uint32_t(_calls.size() - 1),
+                    std::move(arg0), std::move(arg1));
+                return;
+            }
+
+            _calls.push_back(std::move(call));
+            ret = add_node(kind_t::CALL, std::uint32_t(_calls.size() - 1));
+            return;
+        }
+
+        _trees.push_back(expr);
+        ret = add_node(kind_t::TREE, std::uint32_t(_trees.size() - 1));
+    };
+
+    enter(expr);
+
+    while (!frames.empty()) {
+        auto& frame = frames.back();
+
+        if (frame.next > 0)
+            frame.idx[frame.next - 1] = ret;
+
+        if (frame.next < frame.count) {
+            // frame may be moved by enter()
+            enter(frame.operands[frame.next++]);
+            continue;
+        }
+
+        // The value of a variable evaluated before an operand which may
+        // have side effects is copied, so that it is not modified
+        // before being used
+        if (frame.count == 2 && _nodes[frame.idx[0]].kind == kind_t::VAR) {
+            const auto next_kind = _nodes[frame.idx[1]].kind;
+
+            if (next_kind != kind_t::LITERAL && next_kind != kind_t::VAR)
+                _nodes[frame.idx[0]].op = COPY;
+        }
+
+        switch (frame.kind) {
+        case kind_t::BINARY:
+        case kind_t::BINARY_FN:
+            ret = add_node(
+                frame.kind, frame.aux, frame.idx[1], frame.idx[0], frame.op);
+            break;
+
+        default:
+            ret = add_node(frame.kind, frame.aux, frame.idx[0], frame.idx[1]);
+            break;
+        }
+
+        frames.pop_back();
+    }
+
+    // Size of the value stack
+    size_t size = 0;
+
+    for (const auto& node : _nodes) {
+        switch (node.kind) {
+        case kind_t::BINARY:
+        case kind_t::BINARY_FN:
+        case kind_t::MATH2:
+            --size;
+            break;
+
+        case kind_t::MATH:
+            break;
+
+        default:
+            if (++size > _stack_size)
+                _stack_size = size;
+            break;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t expr_flat_t::call_with(ctx_t& ctx, const call_t& call,
+    const variant_t& x, const variant_t* y) const
+{
+    expr_literal_t values[2] = { x, y ? *y : variant_t() };
+
+    // The arguments do not outlive the call, so they are not owned
+    func_args_t args;
+
+    for (size_t i = 0; i < (y ? 2 : 1); ++i)
+        args.push_back(expr_any_t::handle_t(expr_any_t::handle_t(), &values[i]));
+
+    return call.func->call(ctx, args);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t expr_flat_t::eval(ctx_t& ctx) const
+{
+    // Values of the operands not used yet: literals and variables are
+    // referred to in place, other values are stored into temps at the
+    // same position
+    const variant_t* small_stack[SMALL_STACK_SIZE];
+    variant_t small_temps[SMALL_STACK_SIZE];
+
+    std::vector<const variant_t*> big_stack;
+    std::vector<variant_t> big_temps;
+
+    const variant_t** stack = small_stack;
+    variant_t* temps = small_temps;
+
+    if (_stack_size > SMALL_STACK_SIZE) {
+        big_stack.resize(_stack_size);
+        big_temps.resize(_stack_size);
+        stack = big_stack.data();
+        temps = big_temps.data();
+    }
+
+    size_t sp = 0;
+
+    auto push = [&](variant_t value) {
+        temps[sp] = std::move(value);
+        stack[sp] = &temps[sp];
+        ++sp;
+    };
+
+    // Nodes are stored in evaluation order
+    for (const auto& node : _nodes) {
+        switch (node.kind) {
+        case kind_t::LITERAL:
+            stack[sp++] = &_consts[node.aux];
+            break;
+
+        case kind_t::VAR: {
+            const auto& value = _vars[node.aux]->lookup(ctx);
+
+            if (node.op == COPY)
+                push(value);
+            else
+                stack[sp++] = &value;
+
+            break;
+        }
+
+        case kind_t::BINARY:
+        case kind_t::BINARY_FN: {
+            // The left operand has been evaluated last
+            const auto& a = *stack[sp - 1];
+            const auto& b = *stack[sp - 2];
+            sp -= 2;
+
+            if (node.kind == kind_t::BINARY)
+                push(global_operator_tbl_t::apply(bin_opcode_t(node.op), a, b));
+            else
+                push(_binops[node.aux](a, b));
+
+            break;
+        }
+
+        case kind_t::MATH: {
+            const auto& call = _calls[node.aux];
+            const auto& x = *stack[--sp];
+
+            if (!x.is_number())
+                push(call_with(ctx, call, x));
+            else
+                push(variant_t(call.fn(x.to_double())));
+
+            break;
+        }
+
+        case kind_t::MATH2: {
+            const auto& call = _calls[node.aux];
+            const auto& x = *stack[sp - 2];
+            const auto& y = *stack[sp - 1];
+            sp -= 2;
+
+            if (!x.is_number() || !y.is_number())
+                push(call_with(ctx, call, x, &y));
+            else
+                push(variant_t(call.fn2(x.to_double(), y.to_double())));
+
+            break;
+        }
+
+        case kind_t::CALL: {
+            const auto& call = _calls[node.aux];
+            push(call.func->call(ctx, call.args));
+            break;
+        }
+
+        case kind_t::TREE:
+            push(_trees[node.aux]->eval(ctx));
+            break;
+        }
+    }
+
+    assert(sp == 1);
+
+    return *stack[0];
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_flat_t::dump(std::ostream& os) const
+{
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        const auto& node = _nodes[i];
+
+        os << i << "\t";
+
+        switch (node.kind) {
+        case kind_t::LITERAL:
+            os << "LITERAL\t" << _consts[node.aux];
+            break;
+
+        case kind_t::VAR:
+            os << (node.op == COPY ? "VAR_COPY\t" : "VAR\t")
+               << _vars[node.aux]->name();
+            break;
+
+        case kind_t::BINARY:
+            os << "BINARY\t#" << node.a << ", #" << node.b << ", op"
+               << int(node.op);
+            break;
+
+        case kind_t::BINARY_FN:
+            os << "BINARY_FN\t#" << node.a << ", #" << node.b;
+            break;
+
+        case kind_t::MATH:
+            os << "MATH\t" << _calls[node.aux].func->name() << "(#" << node.a
+               << ")";
+            break;
+
+        case kind_t::MATH2:
+            os << "MATH2\t" << _calls[node.aux].func->name() << "(#" << node.a
+               << ", #" << node.b << ")";
+            break;
+
+        case kind_t::CALL:
+            os << "CALL\t" << _calls[node.aux].func->name() << "/"
+               << _calls[node.aux].args.size();
+            break;
+
+        case kind_t::TREE:
+            os << "TREE\t" << node.aux;
+            break;
+        }
+
+        os << std::endl;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -19,23 +19,44 @@ namespace nu {
 
 /* -------------------------------------------------------------------------- */
 
-variant_t expr_function_t::eval(ctx_t& ctx) const
+expr_function_t::expr_function_t(const atom_t& name, func_args_t var)
+    : _name(name)
+    , _var(var)
+    , _fptr(nullptr)
+    , _func(global_function_tbl_t::get_instance().find(name))
 {
-    if (!global_function_tbl_t::get_instance().is_defined(_name)) {
-        variant_t* var = nullptr;
+    // Plain functions are called directly, skipping std::function
+    if (_func) {
+        auto fptr = _func->target<func_ptr_t>();
+
+        if (fptr)
+            _fptr = *fptr;
+    }
+}
 
-        if (!var && ctx.is_defined(_name)) {
-            var = &(ctx[_name]);
-        }
 
-        if (!var)
-            throw exception_t(
-                std::string("Error: \"" + _name + "\" undefined symbol"));
+/* -------------------------------------------------------------------------- */
 
-        return (*var)[_var[0]->eval(ctx).to_int()];
+variant_t expr_function_t::eval(ctx_t& ctx) const
+{
+    if (is_builtin())
+        return call(ctx, _var);
+
+    variant_t* var = nullptr;
+
+    if (!var && ctx.is_defined(_name)) {
+        var = &(ctx[_name]);
     }
 
-    return global_function_tbl_t::get_instance()[_name](ctx, _name, _var);
+    if (!var)
+        throw exception_t(
+            std::string("Error: \"" + _name.str() + "\" undefined symbol"));
+
+    if (_var.empty() || _var[0]->empty())
+        throw exception_t(
+            std::string("Error: \"" + _name.str() + "\" missing subscript"));
+
+    return (*var)[_var[0]->eval(ctx).to_int()];
 }
 
 
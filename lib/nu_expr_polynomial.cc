@@ -0,0 +1,376 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_polynomial.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_var.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+using type_t = variant_t::type_t;
+using handle_t = expr_any_t::handle_t;
+using typed_handle_t = expr_typed_t::typed_handle_t;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the variable read by expr (a generic or typed variable),
+// or nullptr
+static const expr_any_t* get_var(const handle_t& expr)
+{
+    if (dynamic_cast<const expr_var_t*>(expr.get())
+        || dynamic_cast<const expr_typed_var_t*>(expr.get())) {
+        return expr.get();
+    }
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Collects the variables expr refers to, including the ones of
+// polynomials and squares already built
+static void collect_vars(const handle_t& expr, std::vector<handle_t>& vars)
+{
+    if (!expr)
+        return;
+
+    if (get_var(expr)) {
+        vars.push_back(expr);
+        return;
+    }
+
+    auto poly = dynamic_cast<const expr_double_poly_t*>(expr.get());
+
+    if (poly) {
+        vars.push_back(poly->var());
+        return;
+    }
+
+    auto square = dynamic_cast<const expr_double_square_t*>(expr.get());
+
+    if (square) {
+        collect_vars(square->arg(), vars);
+        return;
+    }
+
+    for (const auto& child : expr_rewriter_t::children(expr))
+        collect_vars(child, vars);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns true if expr is pure and does not refer to variable x,
+// so it can be used as a coefficient
+static bool is_invariant(const handle_t& expr, const std::string& x)
+{
+    if (!expr || expr->empty()
+        || dynamic_cast<const expr_literal_t*>(expr.get())
+        || dynamic_cast<const expr_typed_const_t*>(expr.get())) {
+        return true;
+    }
+
+    if (get_var(expr))
+        return expr->name() != x;
+
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin) {
+        return bin->opcode() != bin_opcode_t::CUSTOM
+            && is_invariant(bin->left(), x) && is_invariant(bin->right(), x);
+    }
+
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (!fn)
+        return false;
+
+    if (!dynamic_cast<const expr_subscrop_t*>(fn)
+        && (!fn->is_builtin()
+               || !global_function_tbl_t::get_instance().is_pure(fn->name()))) {
+        return false;
+    }
+
+    for (const auto& arg : fn->get_args())
+        if (!is_invariant(arg, x))
+            return false;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the exponent k of e^k, where k is a non-negative integral
+// literal
+static bool get_exponent(const expr_bin_t* bin, size_t& exponent)
+{
+    if (bin->opcode() != bin_opcode_t::POW)
+        return false;
+
+    auto literal = dynamic_cast<const expr_literal_t*>(bin->right().get());
+
+    if (!literal || literal->value().is_vector()
+        || !literal->value().is_number()) {
+        return false;
+    }
+
+    const auto k = literal->value().to_double();
+
+    if (k < 0 || k > expr_double_poly_t::MAX_DEGREE || k != std::floor(k))
+        return false;
+
+    exponent = size_t(k);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns true if expr is x^2 rewritten by expr_simplifier_t
+static bool is_square_of(const handle_t& expr, const std::string& x)
+{
+    auto square = dynamic_cast<const expr_double_square_t*>(expr.get());
+    return square && get_var(square->arg()) && square->arg()->name() == x;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_polynomial_t::parse_term(
+    const handle_t& expr, const std::string& x, term_t& term) const
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin && bin->opcode() == bin_opcode_t::MUL)
+        return parse_term(bin->left(), x, term)
+            && parse_term(bin->right(), x, term);
+
+    // e/c, c non-zero numeric literal
+    if (bin && bin->opcode() == bin_opcode_t::DIV) {
+        auto literal = dynamic_cast<const expr_literal_t*>(bin->right().get());
+
+        if (!literal || literal->value().is_vector()
+            || !literal->value().is_number()
+            || literal->value().to_double() == 0) {
+            return false;
+        }
+
+        term.k /= literal->value().to_double();
+
+        return parse_term(bin->left(), x, term);
+    }
+
+    size_t exponent = 0;
+
+    // '^' and '*' have the same precedence, so "a*x^2" is "(a*x)^2",
+    // that is a^2*x^2
+    if (bin && get_exponent(bin, exponent)) {
+        term_t base;
+
+        if (!parse_term(bin->left(), x, base))
+            return false;
+
+        term.k *= std::pow(base.k, double_t(exponent));
+        term.degree += base.degree * exponent;
+
+        for (const auto& factor : base.factors) {
+            term.factors.push_back(exponent == 1
+                    ? factor
+                    : std::make_shared<expr_double_bin_t>(bin_opcode_t::POW,
+                          type_t::DOUBLE, factor,
+                          std::make_shared<expr_typed_const_t>(
+                              type_t::DOUBLE, variant_t(double_t(exponent)))));
+        }
+    } else if (get_var(expr) && expr->name() == x) {
+        ++term.degree;
+    } else if (is_square_of(expr, x)) {
+        term.degree += 2;
+    } else {
+        auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+        if (literal && !literal->value().is_vector()
+            && literal->value().is_number()) {
+            term.k *= literal->value().to_double();
+            return true;
+        }
+
+        if (!is_invariant(expr, x)
+            || !variable_t::is_number(_types.type_of(expr))) {
+            return false;
+        }
+
+        term.factors.push_back(_types.as_typed(expr, type_t::DOUBLE));
+    }
+
+    return term.degree <= expr_double_poly_t::MAX_DEGREE;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_polynomial_t::parse_sum(const handle_t& expr, const std::string& x,
+    double_t sign, std::vector<term_t>& terms) const
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin && bin->opcode() == bin_opcode_t::ADD)
+        return parse_sum(bin->left(), x, sign, terms)
+            && parse_sum(bin->right(), x, sign, terms);
+
+    if (bin && bin->opcode() == bin_opcode_t::SUB)
+        return parse_sum(bin->left(), x, sign, terms)
+            && parse_sum(bin->right(), x, -sign, terms);
+
+    auto poly = dynamic_cast<const expr_double_poly_t*>(expr.get());
+
+    if (poly && poly->var()->name() == x) {
+        const auto& c = poly->coefficients();
+
+        for (size_t i = 0; i < c.size(); ++i) {
+            if (c[i]) {
+                term_t term;
+                term.k = sign;
+                term.degree = i;
+                term.factors.push_back(c[i]);
+                terms.push_back(term);
+            }
+        }
+
+        return true;
+    }
+
+    term_t term;
+    term.k = sign;
+
+    if (!parse_term(expr, x, term))
+        return false;
+
+    terms.push_back(term);
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_polynomial_t::rewrite(const handle_t& expr)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (!bin
+        || (bin->opcode() != bin_opcode_t::ADD
+               && bin->opcode() != bin_opcode_t::SUB)
+        || _types.type_of(expr) != type_t::DOUBLE) {
+        return expr;
+    }
+
+    std::vector<handle_t> vars;
+    collect_vars(expr, vars);
+
+    std::vector<std::string> tried;
+
+    for (const auto& var : vars) {
+        const auto x = var->name();
+
+        if (_types.type_of(var) != type_t::DOUBLE
+            || std::find(tried.begin(), tried.end(), x) != tried.end()) {
+            continue;
+        }
+
+        tried.push_back(x);
+
+        std::vector<term_t> terms;
+
+        if (!parse_sum(expr, x, 1, terms) || terms.size() < 2)
+            continue;
+
+        size_t degree = 0;
+
+        for (const auto& term : terms)
+            degree = std::max(degree, term.degree);
+
+        if (degree < 2)
+            continue;
+
+        // Constant parts of the coefficients are summed at compile time
+        std::vector<typed_handle_t> c(degree + 1);
+        std::vector<double_t> k(degree + 1);
+        std::vector<bool> has_k(degree + 1);
+
+        for (const auto& term : terms) {
+            if (term.factors.empty()) {
+                k[term.degree] += term.k;
+                has_k[term.degree] = true;
+                continue;
+            }
+
+            auto product = term.factors[0];
+
+            for (size_t i = 1; i < term.factors.size(); ++i) {
+                product = std::make_shared<expr_double_bin_t>(bin_opcode_t::MUL,
+                    type_t::DOUBLE, product, term.factors[i]);
+            }
+
+            if (term.k != 1) {
+                product = std::make_shared<expr_double_bin_t>(bin_opcode_t::MUL,
+                    type_t::DOUBLE,
+                    std::make_shared<expr_typed_const_t>(
+                        type_t::DOUBLE, variant_t(term.k)),
+                    product);
+            }
+
+            c[term.degree] = c[term.degree]
+                ? std::make_shared<expr_double_bin_t>(bin_opcode_t::ADD,
+                      type_t::DOUBLE, c[term.degree], product)
+                : product;
+        }
+
+        for (size_t i = 0; i <= degree; ++i) {
+            if (!has_k[i] || k[i] == 0)
+                continue;
+
+            typed_handle_t value = std::make_shared<expr_typed_const_t>(
+                type_t::DOUBLE, variant_t(k[i]));
+
+            c[i] = c[i] ? std::make_shared<expr_double_bin_t>(bin_opcode_t::ADD,
+                              type_t::DOUBLE, c[i], value)
+                        : value;
+        }
+
+        return std::make_shared<expr_double_poly_t>(
+            _types.as_typed(var, type_t::DOUBLE), c, degree >= _estrin_degree);
+    }
+
+    return expr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,457 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_program.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_global_function_tbl.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_var.h"
+
+#include <cassert>
+#include <ostream>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+//! Built-in function argument bound to a register of a program.
+//! It lets built-in functions, which evaluate their own arguments,
+//! read values already computed by the bytecode
+class expr_register_t : public expr_any_t {
+public:
+    expr_register_t(const std::vector<variant_t>* regs, std::uint32_t idx)
+        : _regs(regs)
+        , _idx(idx)
+    {
+    }
+
+    variant_t eval(ctx_t&) const override {
+        return (*_regs)[_idx];
+    }
+
+    const variant_t& eval_ref(ctx_t&, variant_t&) const override {
+        return (*_regs)[_idx];
+    }
+
+    bool empty() const noexcept override {
+        return false;
+    }
+
+    std::string name() const noexcept override {
+        return "";
+    }
+
+    func_args_t get_args() const noexcept override {
+        func_args_t dummy;
+        return dummy;
+    }
+
+private:
+    const std::vector<variant_t>* _regs;
+    std::uint32_t _idx;
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_program_t::expr_program_t(const expr_any_t::handle_t& expr)
+{
+    assert(expr);
+
+    std::uint32_t top = 0;
+    auto result = lower(expr, top);
+
+    emit(opcode_t::RET, 0, result);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::uint32_t expr_program_t::alloc_reg(std::uint32_t& top)
+{
+    auto reg = top++;
+
+    if (_regs.size() < top)
+        _regs.resize(top);
+
+    return reg;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_program_t::emit(opcode_t op, std::uint32_t dst, operand_t a,
+    operand_t b, std::uint32_t aux)
+{
+    instr_t instr;
+
+    instr.op = op;
+    instr.dst = dst;
+    instr.a = a;
+    instr.b = b;
+    instr.aux = aux;
+
+    _code.push_back(instr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_program_t::operand_t expr_program_t::lower(
+    const expr_any_t::handle_t& expr, std::uint32_t& top)
+{
+    // Binary operators and calls whose operands are being lowered.
+    // The operands are lowered one at a time using this stack instead
+    // of recursion, so deep trees do not consume native stack
+    struct frame_t {
+        const expr_bin_t* bin;
+        call_t call;
+        func_args_t args;
+        size_t next;
+        std::uint32_t base;
+
+        // Right operand of a binary operator, lowered before the left one
+        operand_t b;
+
+        // Arguments of a call preceding the last one to be lowered
+        size_t lowered;
+    };
+
+    std::vector<frame_t> frames;
+    operand_t ret;
+
+    // A node is read in place (i.e. when the instruction using it is
+    // executed) if it is a literal or a variable
+    auto in_place = [](const expr_any_t::handle_t& node) {
+        return !node || node->empty()
+            || dynamic_cast<const expr_literal_t*>(node.get())
+            || dynamic_cast<const expr_var_t*>(node.get());
+    };
+
+    // A variable read after some code has been executed would see the
+    // side effects of that code, unlike the tree interpreter, which
+    // reads it in order: copy it into a register in advance
+    auto load = [&](operand_t var) {
+        ret = operand_t();
+        ret.idx = alloc_reg(top);
+        emit(opcode_t::LOAD, ret.idx, var);
+    };
+
+    // Lowers a literal, a variable or a node evaluated by the tree
+    // interpreter into ret, otherwise pushes the frame of the node
+    auto enter = [&](const expr_any_t::handle_t& node) {
+        ret = operand_t();
+
+        // Literals and variables are read in place
+        auto literal = dynamic_cast<const expr_literal_t*>(node.get());
+
+        if (literal) {
+            ret.kind = operand_t::kind_t::CONST;
+            ret.idx = std::uint32_t(_consts.size());
+            _consts.push_back(literal->value());
+            return;
+        }
+
+        auto var = std::dynamic_pointer_cast<const expr_var_t>(node);
+
+        if (var) {
+            ret.kind = operand_t::kind_t::VAR;
+            ret.idx = std::uint32_t(_vars.size());
+            _vars.push_back(var);
+            return;
+        }
+
+        auto bin = dynamic_cast<const expr_bin_t*>(node.get());
+
+        if (bin) {
+            frames.push_back(frame_t{ bin, call_t(), {}, 0, top, {}, 0 });
+            return;
+        }
+
+        auto fn = std::dynamic_pointer_cast<const expr_function_t>(node);
+
+        if (fn && !dynamic_cast<const expr_subscrop_t*>(fn.get())
+            && fn->is_builtin())
+        {
+            auto args = fn->get_args();
+            auto lowered = args.size();
+
+            while (lowered > 0 && in_place(args[lowered - 1]))
+                --lowered;
+
+            // The function checks the number of its arguments before
+            // evaluating any of them: the arguments are lowered only
+            // when they are known to pass the check
+            auto info = global_function_tbl_t::get_instance().get_info(
+                fn->name());
+
+            if (lowered == 0
+                || (info
+                    && global_function_tbl_t::is_valid_arg_num(
+                        args, info->arg_num)))
+            {
+                frames.push_back(frame_t{
+                    nullptr, call_t(), std::move(args), 0, top, {}, lowered });
+
+                frames.back().call.func = fn;
+                return;
+            }
+        }
+
+        // Fallback to the tree interpreter
+        ret.idx = alloc_reg(top);
+        _trees.push_back(node);
+
+        emit(opcode_t::EVAL_TREE, ret.idx, operand_t(), operand_t(),
+            std::uint32_t(_trees.size() - 1));
+    };
+
+    enter(expr);
+
+    while (!frames.empty()) {
+        auto& frame = frames.back();
+
+        if (frame.bin) {
+            const auto bin = frame.bin;
+
+            // The right operand is evaluated first, as expr_bin_t does
+            switch (frame.next++) {
+            case 0:
+                enter(bin->right());
+                continue;
+
+            case 1:
+                if (ret.kind == operand_t::kind_t::VAR
+                    && !in_place(bin->left())) {
+                    load(ret);
+                }
+
+                frame.b = ret;
+                enter(bin->left());
+                continue;
+
+            default:
+                break;
+            }
+
+            const auto a = ret;
+            const auto b = frame.b;
+
+            // Operand registers can be reused for the result
+            top = frame.base;
+            frames.pop_back();
+
+            ret = operand_t();
+            ret.idx = alloc_reg(top);
+
+            if (bin->opcode() != bin_opcode_t::CUSTOM) {
+                emit(opcode_t::BINARY, ret.idx, a, b,
+                    std::uint32_t(bin->opcode()));
+
+                continue;
+            }
+
+            _binops.push_back(bin->func());
+
+            emit(opcode_t::BINARY_FN, ret.idx, a, b,
+                std::uint32_t(_binops.size() - 1));
+
+            continue;
+        }
+
+        // Each argument keeps its own register until the call
+        if (frame.next > 0 && frame.call.args.size() < frame.next) {
+            assert(ret.kind == operand_t::kind_t::REG);
+
+            frame.call.args.push_back(
+                std::make_shared<expr_register_t>(&_regs, ret.idx));
+        }
+
+        // Arguments are evaluated in order by built-in functions
+        if (frame.next < frame.args.size()) {
+            auto arg = frame.args[frame.next++];
+            auto var = std::dynamic_pointer_cast<const expr_var_t>(arg);
+
+            if (var && frame.next < frame.lowered) {
+                _vars.push_back(var);
+                load(operand_t(
+                    operand_t::kind_t::VAR, std::uint32_t(_vars.size() - 1)));
+
+                continue;
+            }
+
+            if (in_place(arg)) {
+                frame.call.args.push_back(arg);
+                continue;
+            }
+
+            enter(arg);
+            continue;
+        }
+
+        top = frame.base;
+
+        _calls.push_back(std::move(frame.call));
+        frames.pop_back();
+
+        ret = operand_t();
+        ret.idx = alloc_reg(top);
+
+        emit(opcode_t::CALL, ret.idx, operand_t(), operand_t(),
+            std::uint32_t(_calls.size() - 1));
+    }
+
+    return ret;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const variant_t& expr_program_t::fetch(ctx_t& ctx, const operand_t& o) const
+{
+    switch (o.kind) {
+    case operand_t::kind_t::REG:
+        return _regs[o.idx];
+
+    case operand_t::kind_t::CONST:
+        return _consts[o.idx];
+
+    case operand_t::kind_t::VAR:
+    default:
+        break;
+    }
+
+    return _vars[o.idx]->lookup(ctx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t expr_program_t::run(ctx_t& ctx)
+{
+    for (const auto& instr : _code) {
+        switch (instr.op) {
+        // The right operand is fetched first, as expr_bin_t evaluates it
+        case opcode_t::BINARY: {
+            const auto& b = fetch(ctx, instr.b);
+            _regs[instr.dst] = global_operator_tbl_t::apply(
+                bin_opcode_t(instr.aux), fetch(ctx, instr.a), b);
+            break;
+        }
+
+        case opcode_t::BINARY_FN: {
+            const auto& b = fetch(ctx, instr.b);
+            _regs[instr.dst] = _binops[instr.aux](fetch(ctx, instr.a), b);
+            break;
+        }
+
+        case opcode_t::LOAD:
+            _regs[instr.dst] = fetch(ctx, instr.a);
+            break;
+
+        case opcode_t::CALL: {
+            const auto& call = _calls[instr.aux];
+            _regs[instr.dst] = call.func->call(ctx, call.args);
+            break;
+        }
+
+        case opcode_t::EVAL_TREE:
+            _trees[instr.aux]->eval_into(ctx, _regs[instr.dst]);
+            break;
+
+        case opcode_t::RET:
+            if (instr.a.kind == operand_t::kind_t::REG)
+                return std::move(_regs[instr.a.idx]);
+
+            return fetch(ctx, instr.a);
+        }
+    }
+
+    return variant_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_program_t::dump(std::ostream& os) const
+{
+    auto operand = [&](const operand_t& o) {
+        switch (o.kind) {
+        case operand_t::kind_t::REG:
+            os << "r" << o.idx;
+            break;
+
+        case operand_t::kind_t::CONST:
+            os << "k" << o.idx << "(" << _consts[o.idx] << ")";
+            break;
+
+        case operand_t::kind_t::VAR:
+            os << "$" << _vars[o.idx]->name();
+            break;
+        }
+    };
+
+    size_t pc = 0;
+
+    for (const auto& instr : _code) {
+        os << pc++ << "\t";
+
+        switch (instr.op) {
+        case opcode_t::BINARY:
+        case opcode_t::BINARY_FN:
+            os << (instr.op == opcode_t::BINARY ? "BINARY" : "BINARY_FN")
+               << "\tr" << instr.dst << ", ";
+            operand(instr.a);
+            os << ", ";
+            operand(instr.b);
+
+            if (instr.op == opcode_t::BINARY)
+                os << ", op" << instr.aux;
+
+            break;
+
+        case opcode_t::CALL:
+            os << "CALL\tr" << instr.dst << ", "
+               << _calls[instr.aux].func->name()
+               << "/" << _calls[instr.aux].args.size();
+            break;
+
+        case opcode_t::LOAD:
+            os << "LOAD\tr" << instr.dst << ", ";
+            operand(instr.a);
+            break;
+
+        case opcode_t::EVAL_TREE:
+            os << "EVAL\tr" << instr.dst << ", tree" << instr.aux;
+            break;
+
+        case opcode_t::RET:
+            os << "RET\t";
+            operand(instr.a);
+            break;
+        }
+
+        os << std::endl;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
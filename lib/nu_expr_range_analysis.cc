@@ -0,0 +1,349 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_range_analysis.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_var.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+using type_t = variant_t::type_t;
+using handle_t = expr_any_t::handle_t;
+using range_t = expr_range_analysis_t::range_t;
+
+static const double_t inf = std::numeric_limits<double_t>::infinity();
+
+// Integral values beyond this limit may be inexact as double
+static const double_t max_exact_integral = 9007199254740992.0; // 2^53
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the smallest range including the non-NaN values
+static range_t hull(std::initializer_list<double_t> values)
+{
+    range_t r(inf, -inf);
+
+    for (auto v : values) {
+        if (!std::isnan(v)) {
+            r.lo = std::min(r.lo, v);
+            r.hi = std::max(r.hi, v);
+        }
+    }
+
+    return r.lo > r.hi ? range_t() : r;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns a range whose NaN bounds are replaced by infinities
+static range_t bounds(double_t lo, double_t hi)
+{
+    return range_t(std::isnan(lo) ? -inf : lo, std::isnan(hi) ? inf : hi);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Range of x^k, k non-negative integer, computed by f(x^k) where f
+// is monotonic
+template <class F>
+static range_t power_range(const range_t& x, double_t k, F f)
+{
+    if (k == 0)
+        return range_t(f(1), f(1));
+
+    const bool even = std::fmod(k, 2) == 0;
+    const auto lo = ::pow(x.lo, k);
+    const auto hi = ::pow(x.hi, k);
+
+    if (x.lo >= 0 || !even)
+        return bounds(f(lo), f(hi));
+
+    if (x.hi <= 0)
+        return bounds(f(hi), f(lo));
+
+    return bounds(f(0), f(std::max(lo, hi)));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static range_t bin_range(
+    bin_opcode_t op, const range_t& a, const range_t& b, bool integral)
+{
+    switch (op) {
+    case bin_opcode_t::ADD:
+        return bounds(a.lo + b.lo, a.hi + b.hi);
+
+    case bin_opcode_t::SUB:
+        return bounds(a.lo - b.hi, a.hi - b.lo);
+
+    case bin_opcode_t::MUL:
+        return hull({ a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi });
+
+    case bin_opcode_t::DIV:
+        if (!b.excludes_zero())
+            break;
+
+        return hull({ a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi });
+
+    case bin_opcode_t::INT_DIV:
+        if (!b.excludes_zero())
+            break;
+
+        return hull({ std::trunc(a.lo / b.lo), std::trunc(a.lo / b.hi),
+            std::trunc(a.hi / b.lo), std::trunc(a.hi / b.hi) });
+
+    case bin_opcode_t::INT_MOD: {
+        // The result has the sign of the dividend and |result| < |divisor|
+        const auto m = std::max(std::fabs(b.lo), std::fabs(b.hi)) - 1;
+        return range_t(a.lo >= 0 ? 0 : -m, a.hi <= 0 ? 0 : m);
+    }
+
+    case bin_opcode_t::POW: {
+        // Integral powers are rounded adding 0.5 and truncating
+        auto round = [integral](double_t v) {
+            return integral ? std::trunc(0.5F + v) : v;
+        };
+
+        if (b.lo == b.hi && b.lo >= 0 && b.lo == std::floor(b.lo))
+            return power_range(a, b.lo, round);
+
+        if (a.lo >= 0)
+            return range_t(round(0), inf);
+
+        break;
+    }
+
+    case bin_opcode_t::EQ:
+    case bin_opcode_t::NE:
+    case bin_opcode_t::LT:
+    case bin_opcode_t::LE:
+    case bin_opcode_t::GT:
+    case bin_opcode_t::GE:
+    case bin_opcode_t::AND:
+    case bin_opcode_t::OR:
+    case bin_opcode_t::XOR:
+        return range_t(0, 1);
+
+    default:
+        break;
+    }
+
+    return range_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static range_t function_range(
+    const std::string& name, const std::vector<range_t>& args)
+{
+    if (name == "sin" || name == "cos" || name == "tanh" || name == "sign")
+        return range_t(-1, 1);
+
+    if (name == "atan")
+        return range_t(-std::atan(inf), std::atan(inf));
+
+    if (name == "len" || name == "size")
+        return range_t(0, inf);
+
+    if (args.size() == 1) {
+        const auto& x = args[0];
+
+        if (name == "exp")
+            return bounds(::exp(x.lo), ::exp(x.hi));
+
+        if (name == "cosh")
+            return range_t(1, inf);
+
+        if (name == "sqrt" || name == "sqr")
+            return bounds(::sqrt(std::max(x.lo, 0.0)), ::sqrt(x.hi));
+
+        if (name == "abs") {
+            if (x.lo >= 0)
+                return x;
+
+            if (x.hi <= 0)
+                return range_t(-x.hi, -x.lo);
+
+            return range_t(0, std::max(-x.lo, x.hi));
+        }
+    }
+
+    if (args.size() == 2) {
+        const auto& x = args[0];
+        const auto& y = args[1];
+
+        if (name == "min")
+            return range_t(std::min(x.lo, y.lo), std::min(x.hi, y.hi));
+
+        if (name == "max")
+            return range_t(std::max(x.lo, y.lo), std::max(x.hi, y.hi));
+    }
+
+    return range_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+range_t expr_range_analysis_t::range_of(const handle_t& expr) const
+{
+    auto i = _cache.find(expr);
+
+    if (i != _cache.end())
+        return i->second;
+
+    const auto r = compute_range(expr);
+    _cache[expr] = r;
+
+    return r;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+range_t expr_range_analysis_t::compute_range(const handle_t& expr) const
+{
+    const auto t = _types.type_of(expr);
+
+    // Float arithmetic is rounded to single precision, which is not
+    // tracked
+    if (!variable_t::is_number(t) || t == type_t::FLOAT)
+        return range_t();
+
+    range_t r;
+
+    auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+    auto typed_const = dynamic_cast<const expr_typed_const_t*>(expr.get());
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (literal) {
+        const auto v = literal->value().to_double();
+        r = range_t(v, v);
+    } else if (typed_const) {
+        ctx_t ctx;
+        const auto v = t == type_t::DOUBLE
+            ? typed_const->eval_double(ctx)
+            : double_t(typed_const->eval_long64(ctx));
+
+        r = range_t(v, v);
+    } else if (dynamic_cast<const expr_var_t*>(expr.get())
+        || dynamic_cast<const expr_typed_var_t*>(expr.get())) {
+        auto i = _ranges.find(expr->name());
+
+        if (i != _ranges.end())
+            r = i->second;
+    } else if (dynamic_cast<const expr_double_square_t*>(expr.get())) {
+        r = range_t(0, inf);
+    } else if (bin) {
+        r = bin_range(bin->opcode(), range_of(bin->left()),
+            range_of(bin->right()), variable_t::is_integral(t));
+    } else if (fn && fn->is_builtin()
+        && !dynamic_cast<const expr_subscrop_t*>(fn)) {
+        std::vector<range_t> args;
+
+        for (const auto& arg : fn->get_args())
+            args.push_back(range_of(arg));
+
+        r = function_range(fn->name(), args);
+    }
+
+    // Integral values are exact and do not overflow within these limits
+    switch (t) {
+    case type_t::BOOLEAN:
+        return range_t(0, 1);
+
+    case type_t::INTEGER:
+        if (r.lo < INT_MIN || r.hi > INT_MAX)
+            return range_t(INT_MIN, INT_MAX);
+
+        break;
+
+    case type_t::LONG64:
+        if (r.lo < -max_exact_integral || r.hi > max_exact_integral)
+            return range_t();
+
+        break;
+
+    default:
+        break;
+    }
+
+    return r;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_range_analysis_t::rewrite(const handle_t& expr)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (!bin
+        || (bin->opcode() != bin_opcode_t::DIV
+               && bin->opcode() != bin_opcode_t::INT_DIV
+               && bin->opcode() != bin_opcode_t::INT_MOD)) {
+        return expr;
+    }
+
+    if (!variable_t::is_number(_types.type_of(bin->left()))
+        || !variable_t::is_number(_types.type_of(bin->right()))
+        || !range_of(bin->right()).excludes_zero()) {
+        return expr;
+    }
+
+    handle_t result;
+
+    if (bin->opcode() == bin_opcode_t::DIV) {
+        result = std::make_shared<expr_double_div_t>(
+            _types.as_typed(bin->left(), type_t::DOUBLE),
+            _types.as_typed(bin->right(), type_t::DOUBLE));
+    } else {
+        const auto t = _types.type_of(expr);
+
+        if (t != type_t::LONG64 && t != type_t::INTEGER)
+            return expr;
+
+        result = std::make_shared<expr_long64_div_t>(bin->opcode(), t,
+            _types.as_typed(bin->left(), type_t::LONG64),
+            _types.as_typed(bin->right(), type_t::LONG64));
+    }
+
+    // The range of the new node is the one of the original expression
+    _cache[result] = range_of(expr);
+
+    return result;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,122 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_rewriter.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_unary_op.h"
+
+#include <cassert>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+func_args_t expr_rewriter_t::children(const expr_any_t::handle_t& expr)
+{
+    func_args_t ret;
+
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin) {
+        ret.push_back(bin->left());
+        ret.push_back(bin->right());
+        return ret;
+    }
+
+    auto unary = dynamic_cast<const expr_unary_op_t*>(expr.get());
+
+    if (unary) {
+        ret.push_back(unary->operand());
+        return ret;
+    }
+
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (fn)
+        ret = fn->get_args();
+
+    return ret;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_rewriter_t::rebuild(
+    const expr_any_t::handle_t& expr, const func_args_t& children)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin) {
+        assert(children.size() == 2);
+
+        if (bin->opcode() == bin_opcode_t::CUSTOM) {
+            return std::make_shared<expr_bin_t>(
+                bin->func(), children[0], children[1]);
+        }
+
+        return std::make_shared<expr_bin_t>(
+            bin->opcode(), children[0], children[1]);
+    }
+
+    auto unary = dynamic_cast<const expr_unary_op_t*>(expr.get());
+
+    if (unary) {
+        assert(children.size() == 1);
+
+        return std::make_shared<expr_unary_op_t>(
+            unary->op_name(), children[0]);
+    }
+
+    if (dynamic_cast<const expr_subscrop_t*>(expr.get()))
+        return std::make_shared<expr_subscrop_t>(expr->name(), children);
+
+    if (dynamic_cast<const expr_function_t*>(expr.get()))
+        return std::make_shared<expr_function_t>(expr->name(), children);
+
+    return expr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_rewriter_t::operator()(
+    const expr_any_t::handle_t& expr)
+{
+    if (!expr)
+        return expr;
+
+    auto args = children(expr);
+    bool changed = false;
+
+    for (auto& arg : args) {
+        auto new_arg = (*this)(arg);
+
+        if (new_arg != arg) {
+            arg = new_arg;
+            changed = true;
+        }
+    }
+
+    return rewrite(changed ? rebuild(expr, args) : expr);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,417 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_simplifier.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_const_folder.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_var.h"
+
+#include <cmath>
+#include <typeinfo>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+using type_t = variant_t::type_t;
+using handle_t = expr_any_t::handle_t;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Maximum number of rules applied to a single node
+static const size_t max_rewrite_steps = 16;
+
+
+/* -------------------------------------------------------------------------- */
+
+static const expr_bin_t* get_bin(const handle_t& expr, bin_opcode_t op)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+    return bin && bin->opcode() == op ? bin : nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static bool is_number_equal_to(const handle_t& expr, double_t value)
+{
+    double_t v = 0;
+    return expr_simplifier_t::is_number(expr, v) && v == value;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e*1, 1*e -> e
+static handle_t rule_mul_one(const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::MUL);
+
+    if (!bin)
+        return nullptr;
+
+    const auto t = s.type_of(expr);
+
+    if (t != type_t::DOUBLE && t != type_t::LONG64)
+        return nullptr;
+
+    if (is_number_equal_to(bin->right(), 1) && s.type_of(bin->left()) == t)
+        return s.as_scalar(bin->left(), t);
+
+    if (is_number_equal_to(bin->left(), 1) && s.type_of(bin->right()) == t)
+        return s.as_scalar(bin->right(), t);
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e+0, 0+e, e-0 -> e
+// For doubles e+0 is +0 if e is -0, so it is replaced in fast_math only
+static handle_t rule_add_zero(const expr_simplifier_t& s, const handle_t& expr)
+{
+    const auto t = s.type_of(expr);
+
+    if (t != type_t::DOUBLE && t != type_t::LONG64)
+        return nullptr;
+
+    auto is_zero = [](const handle_t& e) {
+        double_t v = 0;
+        return expr_simplifier_t::is_number(e, v) && v == 0 && !std::signbit(v);
+    };
+
+    auto sub = get_bin(expr, bin_opcode_t::SUB);
+
+    if (sub) {
+        if (is_zero(sub->right()) && s.type_of(sub->left()) == t)
+            return s.as_scalar(sub->left(), t);
+
+        return nullptr;
+    }
+
+    auto add = get_bin(expr, bin_opcode_t::ADD);
+
+    if (!add || (t == type_t::DOUBLE && !s.fast_math()))
+        return nullptr;
+
+    if (is_zero(add->right()) && s.type_of(add->left()) == t)
+        return s.as_scalar(add->left(), t);
+
+    if (is_zero(add->left()) && s.type_of(add->right()) == t)
+        return s.as_scalar(add->right(), t);
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e^1 -> e
+// The integral power rounds negative results (see expr_long64_pow_t),
+// so only doubles are simplified. pow() does not preserve the sign
+// of NaN, so e^1 is replaced in fast_math only
+static handle_t rule_pow_one(const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::POW);
+
+    if (!bin || !s.fast_math() || !is_number_equal_to(bin->right(), 1))
+        return nullptr;
+
+    if (s.type_of(expr) != type_t::DOUBLE
+        || s.type_of(bin->left()) != type_t::DOUBLE) {
+        return nullptr;
+    }
+
+    return s.as_scalar(bin->left(), type_t::DOUBLE);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e-e -> 0
+// For doubles the result is NaN if e is infinite or NaN, so it is
+// replaced in fast_math only
+static handle_t rule_sub_self(const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::SUB);
+
+    if (!bin || !expr_simplifier_t::is_same(bin->left(), bin->right())
+        || !expr_const_folder_t::is_pure(bin->left())) {
+        return nullptr;
+    }
+
+    switch (s.type_of(expr)) {
+    case type_t::LONG64:
+        return std::make_shared<expr_literal_t>(variant_t(long64_t(0)));
+
+    case type_t::INTEGER:
+        return std::make_shared<expr_literal_t>(variant_t(integer_t(0)));
+
+    case type_t::DOUBLE:
+        if (s.fast_math())
+            return std::make_shared<expr_literal_t>(variant_t(double_t(0)));
+
+        break;
+
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e^2 -> e*e
+static handle_t rule_pow_square(
+    const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::POW);
+
+    if (!bin || !is_number_equal_to(bin->right(), 2)
+        || s.type_of(expr) != type_t::DOUBLE) {
+        return nullptr;
+    }
+
+    return std::make_shared<expr_double_square_t>(
+        s.as_typed(bin->left(), type_t::DOUBLE));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Integral a^b -> exponentiation by squaring
+static handle_t rule_pow_int(const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::POW);
+
+    if (!bin)
+        return nullptr;
+
+    const auto t = s.type_of(expr);
+
+    if (t != type_t::LONG64 && t != type_t::INTEGER)
+        return nullptr;
+
+    return std::make_shared<expr_long64_pow_t>(t,
+        s.as_typed(bin->left(), type_t::LONG64),
+        s.as_typed(bin->right(), type_t::LONG64));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// e/c -> e*(1/c)
+// The result is the same only if c is a power of two whose reciprocal
+// is a normal number. Any other c is replaced in fast_math only
+static handle_t rule_div_const(
+    const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto bin = get_bin(expr, bin_opcode_t::DIV);
+    double_t c = 0;
+
+    if (!bin || !expr_simplifier_t::is_number(bin->right(), c)
+        || !variable_t::is_number(s.type_of(bin->left()))) {
+        return nullptr;
+    }
+
+    const double_t reciprocal = 1 / c;
+
+    if (c == 0 || !std::isfinite(c) || !std::isnormal(reciprocal))
+        return nullptr;
+
+    int exp = 0;
+
+    if (!s.fast_math() && std::fabs(std::frexp(c, &exp)) != 0.5)
+        return nullptr;
+
+    return std::make_shared<expr_bin_t>(bin_opcode_t::MUL, bin->left(),
+        std::make_shared<expr_literal_t>(variant_t(reciprocal)));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// a*b+c, c+a*b -> fma(a,b,c)
+static handle_t rule_fma(const expr_simplifier_t& s, const handle_t& expr)
+{
+    auto add = get_bin(expr, bin_opcode_t::ADD);
+
+    if (!add || !s.fast_math() || s.type_of(expr) != type_t::DOUBLE
+        || !expr_const_folder_t::is_pure(expr)) {
+        return nullptr;
+    }
+
+    auto fuse = [&](const handle_t& product, const handle_t& addend) {
+        auto mul = get_bin(product, bin_opcode_t::MUL);
+
+        if (!mul || s.type_of(product) != type_t::DOUBLE
+            || !variable_t::is_number(s.type_of(addend))) {
+            return handle_t();
+        }
+
+        return handle_t(std::make_shared<expr_double_fma_t>(
+            s.as_typed(mul->left(), type_t::DOUBLE),
+            s.as_typed(mul->right(), type_t::DOUBLE),
+            s.as_typed(addend, type_t::DOUBLE)));
+    };
+
+    auto result = fuse(add->left(), add->right());
+
+    return result ? result : fuse(add->right(), add->left());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_simplifier_t::expr_simplifier_t(bool fast_math)
+    : _fast_math(fast_math)
+{
+    _rules = {
+        { "mul-one", rule_mul_one },
+        { "add-zero", rule_add_zero },
+        { "pow-one", rule_pow_one },
+        { "sub-self", rule_sub_self },
+        { "pow-square", rule_pow_square },
+        { "pow-int", rule_pow_int },
+        { "div-const", rule_div_const },
+        { "fma", rule_fma },
+    };
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_simplifier_t::as_scalar(const handle_t& expr, type_t t) const
+{
+    if (dynamic_cast<const expr_var_t*>(expr.get()))
+        return as_typed(expr, t);
+
+    return expr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_simplifier_t::is_number(const handle_t& expr, double_t& value)
+{
+    auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+    if (!literal || literal->value().is_vector()
+        || !literal->value().is_number()) {
+        return false;
+    }
+
+    value = literal->value().to_double();
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool expr_simplifier_t::is_same(const handle_t& a, const handle_t& b)
+{
+    if (a == b)
+        return true;
+
+    if (!a || !b || typeid(*a) != typeid(*b))
+        return false;
+
+    auto la = dynamic_cast<const expr_literal_t*>(a.get());
+
+    if (la) {
+        const auto& va = la->value();
+        const auto& vb = static_cast<const expr_literal_t*>(b.get())->value();
+
+        if (va.get_type() != vb.get_type() || va.is_vector() || vb.is_vector())
+            return false;
+
+        if (variable_t::is_float(va.get_type()))
+            return va.to_double() == vb.to_double();
+
+        if (variable_t::is_integral(va.get_type()))
+            return va.to_long64() == vb.to_long64();
+
+        return va.to_str() == vb.to_str();
+    }
+
+    if (dynamic_cast<const expr_var_t*>(a.get()))
+        return a->name() == b->name();
+
+    auto ba = dynamic_cast<const expr_bin_t*>(a.get());
+
+    if (ba) {
+        auto bb = static_cast<const expr_bin_t*>(b.get());
+
+        return ba->opcode() != bin_opcode_t::CUSTOM
+            && ba->opcode() == bb->opcode() && is_same(ba->left(), bb->left())
+            && is_same(ba->right(), bb->right());
+    }
+
+    if (dynamic_cast<const expr_function_t*>(a.get())) {
+        const auto args_a = a->get_args();
+        const auto args_b = b->get_args();
+
+        if (a->name() != b->name() || args_a.size() != args_b.size())
+            return false;
+
+        for (size_t i = 0; i < args_a.size(); ++i)
+            if (!is_same(args_a[i], args_b[i]))
+                return false;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+handle_t expr_simplifier_t::rewrite(const handle_t& expr)
+{
+    auto result = expr;
+
+    for (size_t step = 0; step < max_rewrite_steps; ++step) {
+        handle_t next;
+
+        for (const auto& rule : _rules) {
+            next = rule.apply(*this, result);
+
+            if (next)
+                break;
+        }
+
+        if (!next || next == result)
+            break;
+
+        result = next;
+    }
+
+    return result;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
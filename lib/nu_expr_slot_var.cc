@@ -0,0 +1,40 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_slot_var.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_slot_binder_t::rewrite(
+    const expr_any_t::handle_t& expr)
+{
+    auto var = dynamic_cast<const expr_var_t*>(expr.get());
+
+    if (!var)
+        return expr;
+
+    const auto& name = var->atom();
+
+    return std::make_shared<expr_slot_var_t>(name, _tbl, _tbl->bind(name));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -22,12 +22,12 @@ variant_t expr_subscrop_t::eval(ctx_t& ctx) const
 {
     if (!ctx.is_defined(_name))
         throw exception_t(
-            std::string("Error: \"" + _name + "\" undefined symbol"));
+            std::string("Error: \"" + _name.str() + "\" undefined symbol"));
 
     const variant_t& var_value = ctx[_name];
     (void)var_value; // TODO
 
-    throw exception_t(std::string("Cannot evaluate \"" + _name + "\""));
+    throw exception_t(std::string("Cannot evaluate \"" + _name.str() + "\""));
 }
 
 
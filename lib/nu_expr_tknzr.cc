@@ -12,7 +12,7 @@
 #include "nu_lxa.h"
 #include "nu_variant.h"
 
-#include <algorithm>
+#include <cstdint>
 
 
 /* -------------------------------------------------------------------------- */
@@ -32,39 +32,107 @@ expr_tknzr_t::expr_tknzr_t(const std::string& data, size_t pos,
 )
     : base_tknzr_t(data)
     , _pos(pos)
-    , _str_op(str_op)
     , _strtk(string_bsymb, string_esymb, string_escape)
-    , _line_comment(line_comment)
+    , _tbl(std::make_shared<token_tbl_t>(base_tknzr_t::data()))
+    , _trie(1)
 {
     _subexp_begin_symb.push_back(subexp_bsymb);
     _subexp_end_symb.push_back(subexp_esymb);
 
+    for (int c = 0; c < 256; ++c) {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
+            || (c >= 'A' && c <= 'Z') || c == '_') {
+            _class[c] |= CL_IDENT;
+        }
+
+        // Without a begin marker any symbol may start a string
+        if (string_bsymb.empty())
+            _class[c] |= CL_QUOTE;
+    }
+
+    if (!string_bsymb.empty())
+        _class[uint8_t(string_bsymb[0])] |= CL_QUOTE;
+
     for (auto e : blanks)
-        _blank.register_pattern(e);
+        _class[uint8_t(e)] |= CL_BLANK;
 
     for (auto e : newlines)
-        _newl.register_pattern(e);
+        _class[uint8_t(e)] |= CL_NEWLINE;
 
     for (auto e : operators)
-        _op.register_pattern(e);
+        _class[uint8_t(e)] |= CL_OPERATOR;
 
-    for (auto e : str_op)
-        _word_op.register_pattern(e);
+    for (const auto& e : str_op)
+        _add_word(e, TN_STR_OP);
 
-    if (!_line_comment.empty()) {
-        for (const auto & comment_word : line_comment) {
-            if (comment_word.size()==1) { 
-                _op.register_pattern(comment_word[0]);
-            }
-            else {
-                _word_op.register_pattern(comment_word);
-            }
+    for (const auto& comment_word : line_comment) {
+        if (comment_word.size() == 1) {
+            _class[uint8_t(comment_word[0])] |= CL_OPERATOR | CL_COMMENT;
+        } else {
+            _add_word(comment_word, TN_COMMENT);
+        }
+    }
+
+    _class[uint8_t(subexp_bsymb)] |= CL_OPERATOR;
+    _class[uint8_t(subexp_esymb)] |= CL_OPERATOR;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void expr_tknzr_t::_add_word(const std::string& word, unsigned char flags)
+{
+    if (word.empty())
+        return;
+
+    unsigned node = 0;
+
+    for (auto c : word) {
+        unsigned child = _child(node, c);
+
+        if (!child) {
+            child = unsigned(_trie.size());
+
+            trie_node_t new_node;
+            new_node.sibling = _trie[node].child;
+            new_node.symbol = c;
+
+            _trie.push_back(new_node);
+            _trie[node].child = child;
         }
+
+        _class[uint8_t(c)] |= CL_WORD;
+        node = child;
+    }
+
+    if (!(_trie[node].flags & TN_WORD)) {
+        _trie[node].word = unsigned(_words.size());
+        _trie[node].length = (unsigned short)(word.size());
+        _words += word;
+    }
+
+    _trie[node].flags |= TN_WORD | flags;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+unsigned expr_tknzr_t::_child(unsigned node, char symbol) const noexcept
+{
+    for (unsigned i = _trie[node].child; i; i = _trie[i].sibling) {
+        if (_trie[i].symbol == symbol)
+            return i;
     }
 
-    _op.register_pattern(subexp_bsymb);
-    _op.register_pattern(subexp_esymb);
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
 
+token_t::id_t expr_tknzr_t::_word_id(unsigned node)
+{
+    return _tbl->intern(_words.data() + _trie[node].word, _trie[node].length);
 }
 
 
@@ -73,6 +141,7 @@ expr_tknzr_t::expr_tknzr_t(const std::string& data, size_t pos,
 void expr_tknzr_t::get_tknlst(token_list_t& tl, bool strip_comment)
 {
     tl.clear();
+    tl.set_tbl(_tbl);
 
     if (eol())
         return;
@@ -84,19 +153,6 @@ void expr_tknzr_t::get_tknlst(token_list_t& tl, bool strip_comment)
 }
 
 
-/* -------------------------------------------------------------------------- */
-
-static inline bool identifier_char(char c)
-{
-    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')
-        || (c >= 'A' && c <= 'Z') || c == '_') {
-        return true;
-    }
-
-    return false;
-}
-
-
 /* -------------------------------------------------------------------------- */
 
 token_t expr_tknzr_t::next()
@@ -106,23 +162,27 @@ token_t expr_tknzr_t::next()
     auto pointer = tell();
     auto tkn = _next();
 
-    if (!(tkn.type() == tkncl_t::INTEGRAL
-            || (tkn.identifier() == "." && tkn.type() == tkncl_t::OPERATOR))) {
+    auto is_dot = [this](const token_t& t) {
+        return t.type() == tkncl_t::OPERATOR && identifier(t) == ".";
+    };
+
+    if (!(tkn.type() == tkncl_t::INTEGRAL || is_dot(tkn)))
         return tkn;
-    }
 
     auto position = tkn.position();
-    std::string id = tkn.identifier();
+    auto length = tkn.length();
+    std::string id = identifier(tkn);
 
     if (tkn.type() == tkncl_t::INTEGRAL) {
         tkn = _next();
 
-        if (tkn.type() != tkncl_t::OPERATOR || tkn.identifier() != ".") {
+        if (!is_dot(tkn)) {
             set_cptr(pointer);
             return _next();
         }
 
-        id += tkn.identifier();
+        id += identifier(tkn);
+        length += tkn.length();
 
         tkn = _next();
 
@@ -131,8 +191,9 @@ token_t expr_tknzr_t::next()
             return _next();
         }
 
-        id += tkn.identifier();
-    } else if (tkn.identifier() == "." && tkn.type() == tkncl_t::OPERATOR) {
+        id += identifier(tkn);
+        length += tkn.length();
+    } else {
         tkn = _next();
 
         if (tkn.type() != tkncl_t::INTEGRAL) {
@@ -140,18 +201,46 @@ token_t expr_tknzr_t::next()
             return _next();
         }
 
-        id = "0." + tkn.identifier();
-    } else {
-        set_cptr(pointer);
-        return _next();
+        id = "0." + identifier(tkn);
+        length += tkn.length();
     }
 
-    tkn.set_identifier(id);
+    return token_t(_tbl->intern(id), tkncl_t::REAL, position, length);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Case folding of ASCII letters (the "C" locale ::tolower)
+static inline char fold(char c) noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+tkncl_t expr_tknzr_t::_classify(size_t offset, size_t length) const noexcept
+{
+    const char* tk = text().data() + offset;
+
+    if (variant_t::is_integer(tk, length))
+        return tkncl_t::INTEGRAL;
+    else if (variant_t::is_real(tk, length))
+        return tkncl_t::REAL;
 
-    tkn.set_position(position);
-    tkn.set_type(tkncl_t::REAL);
+    // Resolve operator like "mod", "div", ...
+    unsigned node = 0;
 
-    return tkn;
+    for (size_t i = 0; i < length; ++i) {
+        node = _child(node, fold(tk[i]));
+
+        if (!node)
+            return tkncl_t::IDENTIFIER;
+    }
+
+    return (_trie[node].flags & TN_STR_OP) ? tkncl_t::OPERATOR
+                                           : tkncl_t::IDENTIFIER;
 }
 
 
@@ -159,64 +248,126 @@ token_t expr_tknzr_t::next()
 
 token_t expr_tknzr_t::_next()
 {
-    std::string other;
+    const span_t span = _scan();
+    const std::string& text = this->text();
+
+    token_t::id_t id = token_tbl_t::empty_id;
+
+    switch (span.type) {
+    case tkncl_t::UNDEFINED:
+    case tkncl_t::STRING_LITERAL:
+        id = _tbl->intern(_strtk.data());
+        break;
+
+    case tkncl_t::LINE_COMMENT:
+        // A comment prefix matched as a word is not part of the span
+        if (_word_found) {
+            const auto& node = _trie[_word_found];
+
+            std::string comment(_words, node.word, node.length);
+            comment.append(text, span.offset, span.length);
+
+            return token_t(_tbl->intern(comment), span.type,
+                span.position + get_exp_pos(), node.length + span.length);
+        }
+
+        id = _tbl->intern(text.data() + span.offset, span.length);
+        break;
+
+    default:
+        if (_word_found)
+            id = _word_id(_word_found);
+        else
+            id = _tbl->intern(text.data() + span.offset, span.length);
+        break;
+    }
+
+    return token_t(
+        id, span.type, span.position + get_exp_pos(), span.length);
+}
 
-    auto token_class = [&](const std::string& tk) -> tkncl_t {
-        if (variant_t::is_integer(tk))
-            return tkncl_t::INTEGRAL;
-        else if (variant_t::is_real(tk))
-            return tkncl_t::REAL;
 
-        // Resolve operator like "mod", "div", ...
-        std::string tklowercase = tk;
+/* -------------------------------------------------------------------------- */
 
-        std::transform(tklowercase.begin(), tklowercase.end(),
-            tklowercase.begin(), tolower);
+expr_tknzr_t::span_t expr_tknzr_t::_scan()
+{
+    // Symbols not yet classified: [other, other + other_len)
+    size_t other = 0;
+    size_t other_len = 0;
+
+    // The string literal begins at string_begin once in_string is set
+    bool in_string = false;
+    size_t string_begin = 0;
+
+    auto make_span = [](size_t position, size_t offset, size_t length,
+                         tkncl_t type) {
+        span_t span;
+        span.position = position;
+        span.offset = offset;
+        span.length = length;
+        span.type = type;
+        return span;
+    };
 
-        return _str_op.find(tklowercase) != _str_op.end() ? tkncl_t::OPERATOR
-                                                          : tkncl_t::IDENTIFIER;
+    auto identifier_char = [this](char c) {
+        return (_class[uint8_t(c)] & CL_IDENT) != 0;
     };
 
-    auto extract_comment = [&](token_t & token, std::string& comment) {
+    // Detect a word operator symbol by symbol; as for the symbols of a
+    // string, the state is kept until a word operator is found or given up
+    auto accept_word = [this](char c) {
+        if (!(_class[uint8_t(c)] & CL_WORD))
+            return false;
 
-        while (!eol()) {
-            auto symbol = get_symbol();
+        const unsigned node = _child(_word_node, c);
 
-            if (_newl.accept(symbol))
-                break;
+        if (!node)
+            return false;
+
+        _word_node = node;
+        return true;
+    };
 
-            comment += get_symbol();
+    // The comment extends from offset up to the end of line
+    auto extract_comment = [&](size_t position, size_t offset) {
+        while (!eol() && !(_class[uint8_t(get_symbol())] & CL_NEWLINE))
             seek_next();
-        }
 
-        token.set_identifier(comment);
-        token.set_type(tkncl_t::LINE_COMMENT);
+        return make_span(
+            position, offset, tell() - offset, tkncl_t::LINE_COMMENT);
     };
 
     _strtk.reset();
-    _word_op.reset();
+    _word_node = 0;
+    _word_found = 0;
 
     char last_symbol = 0;
 
     while (!eol()) {
-        token_t token = make_token(tell() + get_exp_pos(), data());
+        const size_t position = tell();
         const char symbol = get_symbol();
-
-        _blank.reset();
-        _newl.reset();
-        _op.reset();
+        const unsigned char cl = _class[uint8_t(symbol)];
 
         // Detect strings...
-        if (_strtk.accept(symbol) && other.empty()) {
+        bool string_symbol = false;
+
+        if (in_string || (cl & CL_QUOTE)) {
+            string_symbol = _strtk.accept(symbol);
+
+            if (string_symbol && !in_string) {
+                in_string = true;
+                string_begin = position;
+            }
+        }
+
+        if (string_symbol && !other_len) {
             seek_next();
 
             if (eol()) {
-                token.set_identifier(_strtk.data());
-
-                token.set_type(_strtk.string_complete()
-                        ? tkncl_t::STRING_LITERAL
-                        : tkncl_t::UNDEFINED);
-                return token;
+                return make_span(position, string_begin,
+                    tell() - string_begin,
+                    _strtk.string_complete() ? tkncl_t::STRING_LITERAL
+                                             : tkncl_t::UNDEFINED);
             }
 
             continue;
@@ -225,7 +376,7 @@ token_t expr_tknzr_t::_next()
         // Detect "word" operators <=, >=, <>, ...
         // They must be analyzed before "1-character" operators
         // like <,>,=, ...
-        else if (_word_op.accept(symbol)
+        else if (accept_word(symbol)
             && (!identifier_char(last_symbol) && /*->NOTE1*/
                      !identifier_char(symbol))) /*->NOTE1*/
         {
@@ -240,10 +391,10 @@ token_t expr_tknzr_t::_next()
             seek_next();
             char symbol = get_symbol();
 
-            while (!eol() && _word_op.accept(symbol)) {
+            while (!eol() && accept_word(symbol)) {
 
-                if (_word_op.keyword_matches) {
-                    if (other.empty()) {
+                if (_trie[_word_node].flags & TN_WORD) {
+                    if (!other_len) {
                         seek_next();
 
                         if (identifier_char(symbol)
@@ -252,27 +403,21 @@ token_t expr_tknzr_t::_next()
                             break;
                         }
 
-                        token.set_identifier(_word_op.data());
+                        _word_found = _word_node;
+                        _word_node = 0;
 
-						// If we detect line comment prefix
+                        // If we detect line comment prefix
                         // include left part of line into the comment
-                        if (_line_comment.find(_word_op.data()) != _line_comment.end()) {
-                            std::string comment = _word_op.data();
-                            extract_comment(token, comment);
-                            return token;
-                        }
-
-                        token.set_identifier(_word_op.data());
-                        token.set_type(tkncl_t::OPERATOR);
-                        return token;
-
+                        if (_trie[_word_found].flags & TN_COMMENT)
+                            return extract_comment(position, tell());
 
+                        return make_span(position, set_point,
+                            tell() - set_point, tkncl_t::OPERATOR);
                     } else {
-                        _word_op.reset();
+                        _word_node = 0;
                         set_cptr(set_point);
-                        token.set_identifier(other);
-                        token.set_type(token_class(other));
-                        return token;
+                        return make_span(position, other, other_len,
+                            _classify(other, other_len));
                     }
                 }
 
@@ -280,70 +425,54 @@ token_t expr_tknzr_t::_next()
                 symbol = get_symbol();
             }
 
-            _word_op.reset();
+            _word_node = 0;
             set_cptr(set_point);
         }
 
         if (_strtk.string_complete()) {
-            token.set_identifier(_strtk.data());
-            token.set_type(tkncl_t::STRING_LITERAL);
-            return token;
+            return make_span(position, string_begin, tell() - string_begin,
+                tkncl_t::STRING_LITERAL);
         }
 
-        bool is_operator = _op.accept(symbol);
+        if (cl & CL_COMMENT)
+            return extract_comment(position, tell());
 
-        if (is_operator) {
-            char ssymb[2] = { symbol };
-            if (_line_comment.find(ssymb) != _line_comment.end()) {
-                std::string comment;
-                extract_comment(token, comment);
-                return token;
+        if (cl & (CL_BLANK | CL_NEWLINE | CL_OPERATOR)) {
+            if (other_len) {
+                return make_span(
+                    position, other, other_len, _classify(other, other_len));
             }
-        }
-        
-        if (_blank.accept(symbol) || _newl.accept(symbol) || is_operator) {
-            if (other.empty()) {
-                std::string s_symbol;
-                s_symbol.push_back(symbol);
-                token.set_identifier(s_symbol);
-
-                if (!_blank.data().empty()) {
-                    token.set_type(tkncl_t::BLANK);
-                } else if (!_newl.data().empty()) {
-                    token.set_type(tkncl_t::NEWLINE);
-                } else {
-                    if (token.identifier() == subexp_begin_symbol())
-                        token.set_type(tkncl_t::SUBEXP_BEGIN);
-                    else if (token.identifier() == subexp_end_symbol())
-                        token.set_type(tkncl_t::SUBEXP_END);
-                    else
-                        token.set_type(tkncl_t::OPERATOR);
-                }
 
-                seek_next();
-            } else {
-                token.set_identifier(other);
-                token.set_type(token_class(other));
+            tkncl_t type = tkncl_t::OPERATOR;
 
-                other.clear();
-            }
+            if (cl & CL_BLANK)
+                type = tkncl_t::BLANK;
+            else if (cl & CL_NEWLINE)
+                type = tkncl_t::NEWLINE;
+            else if (symbol == _subexp_begin_symb[0])
+                type = tkncl_t::SUBEXP_BEGIN;
+            else if (symbol == _subexp_end_symb[0])
+                type = tkncl_t::SUBEXP_END;
+
+            seek_next();
 
-            return token;
+            return make_span(position, position, 1, type);
         }
 
-        other += symbol;
+        if (!other_len)
+            other = tell();
+
+        ++other_len;
         seek_next();
 
-        if (eol() && !other.empty()) {
-            token.set_identifier(other);
-            token.set_type(token_class(other));
-            return token;
-        }
+        if (eol())
+            return make_span(
+                position, other, other_len, _classify(other, other_len));
 
         last_symbol = symbol;
     }
 
-    return make_token(tell() + get_exp_pos(), data()); // empty token
+    return make_span(tell(), tell(), 0, tkncl_t::UNDEFINED); // empty token
 }
 
 
@@ -0,0 +1,338 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_type_inference.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_unary_op.h"
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+using type_t = variant_t::type_t;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Selects the typed implementation of a binary operator following the
+// rules variant_t applies at run-time.
+// Returns false if the generic operator must be kept; in this case
+// result is its type, if known
+static bool select_binop(
+    bin_opcode_t op, type_t ta, type_t tb, type_t& result, type_t& operands)
+{
+    const bool num = variable_t::is_number(ta) && variable_t::is_number(tb);
+    const bool integral
+        = variable_t::is_integral(ta) && variable_t::is_integral(tb);
+    const bool str = ta == type_t::STRING && tb == type_t::STRING;
+
+    auto any = [&](type_t t) { return ta == t || tb == t; };
+
+    result = type_t::UNDEFINED;
+
+    switch (op) {
+    case bin_opcode_t::ADD:
+    case bin_opcode_t::MUL:
+        if (str && op == bin_opcode_t::ADD) {
+            result = operands = type_t::STRING;
+            return true;
+        }
+
+        if (!num)
+            return false;
+
+        result = operands = (variable_t::is_float(ta)
+                                || variable_t::is_float(tb))
+            ? type_t::DOUBLE
+            : type_t::LONG64;
+
+        return true;
+
+    case bin_opcode_t::DIV:
+        if (!num)
+            return false;
+
+        result = operands = type_t::DOUBLE;
+        return true;
+
+    case bin_opcode_t::SUB:
+    case bin_opcode_t::POW:
+        if (!num)
+            return false;
+
+        if (any(type_t::DOUBLE)) {
+            result = operands = type_t::DOUBLE;
+            return true;
+        }
+
+        if (any(type_t::FLOAT)) {
+            result = type_t::FLOAT;
+            return false;
+        }
+
+        operands = type_t::LONG64;
+
+        if (any(type_t::LONG64))
+            result = type_t::LONG64;
+        else if (op == bin_opcode_t::SUB ? any(type_t::INTEGER)
+                                         : ta == type_t::INTEGER)
+            result = type_t::INTEGER;
+
+        return result != type_t::UNDEFINED;
+
+    case bin_opcode_t::INT_DIV:
+    case bin_opcode_t::INT_MOD:
+        if (!integral)
+            return false;
+
+        operands = type_t::LONG64;
+
+        if (any(type_t::LONG64))
+            result = type_t::LONG64;
+        else if (any(type_t::INTEGER))
+            result = type_t::INTEGER;
+
+        return result != type_t::UNDEFINED;
+
+    case bin_opcode_t::EQ:
+    case bin_opcode_t::NE:
+    case bin_opcode_t::XOR:
+        // Booleans are compared by their truth value
+        if (any(type_t::BOOLEAN)) {
+            result = type_t::BOOLEAN;
+            operands = type_t::BOOLEAN;
+            return num;
+        }
+
+    // fall through
+    case bin_opcode_t::LT:
+    case bin_opcode_t::LE:
+    case bin_opcode_t::GT:
+    case bin_opcode_t::GE:
+        result = type_t::BOOLEAN;
+
+        if (str) {
+            operands = type_t::STRING;
+            return true;
+        }
+
+        if (!num || (!any(type_t::DOUBLE) && any(type_t::FLOAT)))
+            return false;
+
+        if (any(type_t::DOUBLE)) {
+            operands = type_t::DOUBLE;
+            return true;
+        }
+
+        operands = type_t::LONG64;
+        return any(type_t::LONG64) || any(type_t::INTEGER);
+
+    case bin_opcode_t::AND:
+    case bin_opcode_t::OR:
+        result = type_t::BOOLEAN;
+        operands = type_t::LONG64;
+        return num;
+
+    case bin_opcode_t::BOR:
+    case bin_opcode_t::BAND:
+    case bin_opcode_t::BXOR:
+    case bin_opcode_t::BSHR:
+    case bin_opcode_t::BSHL:
+        result = type_t::INTEGER;
+        operands = type_t::LONG64;
+        return num;
+
+    case bin_opcode_t::CUSTOM:
+    default:
+        break;
+    }
+
+    return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+type_t expr_type_inference_t::result_type(bin_opcode_t op, type_t ta, type_t tb)
+{
+    type_t result = type_t::UNDEFINED;
+    type_t operands = type_t::UNDEFINED;
+
+    select_binop(op, ta, tb, result, operands);
+
+    return result;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+type_t expr_type_inference_t::type_of(const expr_any_t::handle_t& expr) const
+{
+    auto typed = dynamic_cast<const expr_typed_t*>(expr.get());
+
+    if (typed)
+        return typed->type();
+
+    auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+    if (literal && !literal->value().is_vector())
+        return literal->value().get_type();
+
+    if (dynamic_cast<const expr_var_t*>(expr.get())) {
+        auto i = _bindings.find(expr->name());
+        return i == _bindings.end() ? type_t::UNDEFINED : i->second;
+    }
+
+    auto i = _types.find(expr);
+
+    if (i != _types.end())
+        return i->second;
+
+    // Generic node not yet visited by the pass
+    type_t t = type_t::UNDEFINED;
+
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+    auto unary = dynamic_cast<const expr_unary_op_t*>(expr.get());
+
+    if (bin) {
+        t = result_type(bin->opcode(), type_of(bin->left()),
+            type_of(bin->right()));
+    } else if (fn && fn->is_builtin()
+        && !dynamic_cast<const expr_subscrop_t*>(fn)) {
+        auto info = global_function_tbl_t::get_instance().get_info(fn->name());
+
+        if (info)
+            t = info->ret_type;
+    } else if (unary) {
+        t = type_of(unary->operand());
+    }
+
+    _types[expr] = t;
+
+    return t;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_typed_t::typed_handle_t expr_type_inference_t::as_typed(
+    const expr_any_t::handle_t& expr, type_t kind) const
+{
+    auto typed = std::dynamic_pointer_cast<expr_typed_t>(expr);
+
+    if (!typed) {
+        auto literal = dynamic_cast<const expr_literal_t*>(expr.get());
+
+        if (literal)
+            return std::make_shared<expr_typed_const_t>(kind, literal->value());
+
+        auto var = std::dynamic_pointer_cast<const expr_var_t>(expr);
+        const auto t = type_of(expr);
+
+        if (!var || (t != type_t::DOUBLE && t != type_t::STRING
+                        && !expr_typed_t::is_long64_kind(t))) {
+            return std::make_shared<expr_typed_unbox_t>(kind, expr);
+        }
+
+        typed = std::make_shared<expr_typed_var_t>(t, var);
+    }
+
+    const auto t = typed->type();
+
+    if (t == kind
+        || (kind == type_t::LONG64 && expr_typed_t::is_long64_kind(t))) {
+        return typed;
+    }
+
+    return std::make_shared<expr_typed_conv_t>(kind, typed);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_any_t::handle_t expr_type_inference_t::rewrite(
+    const expr_any_t::handle_t& expr)
+{
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    if (bin) {
+        type_t result = type_t::UNDEFINED;
+        type_t operands = type_t::UNDEFINED;
+
+        if (!select_binop(bin->opcode(), type_of(bin->left()),
+                type_of(bin->right()), result, operands)) {
+            return expr;
+        }
+
+        auto a = as_typed(bin->left(), operands);
+        auto b = as_typed(bin->right(), operands);
+
+        if (operands == type_t::DOUBLE) {
+            return std::make_shared<expr_double_bin_t>(
+                bin->opcode(), result, a, b);
+        }
+
+        if (operands == type_t::STRING) {
+            return std::make_shared<expr_str_bin_t>(
+                bin->opcode(), result, a, b);
+        }
+
+        return std::make_shared<expr_long64_bin_t>(
+            bin->opcode(), result, a, b);
+    }
+
+    auto fn = dynamic_cast<const expr_function_t*>(expr.get());
+
+    if (fn && fn->is_builtin() && !dynamic_cast<const expr_subscrop_t*>(fn)) {
+        auto info = global_function_tbl_t::get_instance().get_info(fn->name());
+
+        if (!info)
+            return expr;
+
+        const auto args = fn->get_args();
+
+        auto numeric_arg = [&](size_t i) {
+            return args[i] && !args[i]->empty()
+                && variable_t::is_number(type_of(args[i]));
+        };
+
+        if (info->math_fn && args.size() == 1 && numeric_arg(0)) {
+            return std::make_shared<expr_double_call_t>(
+                info->math_fn, as_typed(args[0], type_t::DOUBLE));
+        }
+
+        if (info->math_fn2 && args.size() == 2 && numeric_arg(0)
+            && numeric_arg(1)) {
+            return std::make_shared<expr_double_call_t>(info->math_fn2,
+                as_typed(args[0], type_t::DOUBLE),
+                as_typed(args[1], type_t::DOUBLE));
+        }
+
+        return expr;
+    }
+
+    return expr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,410 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_expr_typed.h"
+
+#include <cmath>
+#include <cstdlib>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+static void typed_internal_error()
+{
+    throw exception_t("Internal error: invalid typed expression access");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_typed_t::eval_double(ctx_t&) const
+{
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long64_t expr_typed_t::eval_long64(ctx_t&) const
+{
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+string_t expr_typed_t::eval_str(ctx_t&) const
+{
+    typed_internal_error();
+    return string_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t expr_typed_t::eval(ctx_t& ctx) const
+{
+    switch (_type) {
+    case type_t::DOUBLE:
+        return variant_t(eval_double(ctx));
+
+    case type_t::LONG64:
+        return variant_t(eval_long64(ctx));
+
+    case type_t::INTEGER:
+        return variant_t(integer_t(eval_long64(ctx)));
+
+    case type_t::BOOLEAN:
+        return variant_t(bool_t(eval_long64(ctx) != 0));
+
+    case type_t::STRING:
+        return variant_t(eval_str(ctx));
+
+    default:
+        break;
+    }
+
+    typed_internal_error();
+    return variant_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+expr_typed_const_t::expr_typed_const_t(type_t t, const variant_t& value)
+    : expr_typed_t(t)
+{
+    if (t == type_t::DOUBLE)
+        _d = value.to_double();
+    else if (is_long64_kind(t))
+        _i = t == type_t::BOOLEAN ? value.to_bool() : value.to_long64();
+    else
+        _s = value.to_str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_double_bin_t::eval_double(ctx_t& ctx) const
+{
+    // The right operand is evaluated first, as expr_bin_t does
+    const auto b = _b->eval_double(ctx);
+    const auto a = _a->eval_double(ctx);
+
+    switch (_op) {
+    case bin_opcode_t::ADD:
+        return a + b;
+
+    case bin_opcode_t::SUB:
+        return a - b;
+
+    case bin_opcode_t::MUL:
+        return a * b;
+
+    case bin_opcode_t::DIV:
+        rt_error_code_t::get_instance().throw_if(
+            b == 0.0, rt_error_code_t::E_DIV_BY_ZERO);
+        return a / b;
+
+    case bin_opcode_t::POW:
+        return ::pow(a, b);
+
+    default:
+        break;
+    }
+
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long64_t expr_double_bin_t::eval_long64(ctx_t& ctx) const
+{
+    const auto b = _b->eval_double(ctx);
+    const auto a = _a->eval_double(ctx);
+
+    switch (_op) {
+    case bin_opcode_t::EQ:
+        return a == b;
+
+    case bin_opcode_t::NE:
+    case bin_opcode_t::XOR:
+        return a != b;
+
+    case bin_opcode_t::LT:
+        return a < b;
+
+    case bin_opcode_t::LE:
+        return a <= b;
+
+    case bin_opcode_t::GT:
+        return a > b;
+
+    case bin_opcode_t::GE:
+        return a >= b;
+
+    default:
+        break;
+    }
+
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long64_t expr_long64_bin_t::eval_long64(ctx_t& ctx) const
+{
+    const auto b = _b->eval_long64(ctx);
+    const auto a = _a->eval_long64(ctx);
+
+    // INTEGER results are computed on values truncated to integer_t,
+    // as variant_t::to_int() does
+    const bool is_int = type() == type_t::INTEGER;
+
+    switch (_op) {
+    case bin_opcode_t::ADD:
+        return a + b;
+
+    case bin_opcode_t::SUB:
+        return is_int ? integer_t(integer_t(a) - integer_t(b)) : a - b;
+
+    case bin_opcode_t::MUL:
+        return a * b;
+
+    case bin_opcode_t::POW:
+        return is_int ? integer_t(0.5F + ::pow(double_t(a), double_t(b)))
+                      : long64_t(0.5F + ::pow(double_t(a), double_t(b)));
+
+    case bin_opcode_t::INT_DIV:
+        if (is_int) {
+            rt_error_code_t::get_instance().throw_if(
+                integer_t(b) == 0, rt_error_code_t::E_DIV_BY_ZERO);
+
+            return integer_t(a) / integer_t(b);
+        }
+
+        rt_error_code_t::get_instance().throw_if(
+            b == 0, rt_error_code_t::E_DIV_BY_ZERO);
+
+        return a / b;
+
+    case bin_opcode_t::INT_MOD:
+        rt_error_code_t::get_instance().throw_if(
+            b == 0, rt_error_code_t::E_DIV_BY_ZERO);
+
+        return is_int ? integer_t(a) % integer_t(b) : a % b;
+
+    case bin_opcode_t::EQ:
+        return a == b;
+
+    case bin_opcode_t::NE:
+    case bin_opcode_t::XOR:
+        return a != b;
+
+    case bin_opcode_t::LT:
+        return a < b;
+
+    case bin_opcode_t::LE:
+        return a <= b;
+
+    case bin_opcode_t::GT:
+        return a > b;
+
+    case bin_opcode_t::GE:
+        return a >= b;
+
+    case bin_opcode_t::AND:
+        return integer_t(a) != 0 && integer_t(b) != 0;
+
+    case bin_opcode_t::OR:
+        return integer_t(a) != 0 || integer_t(b) != 0;
+
+    case bin_opcode_t::BOR:
+        return integer_t(a) | integer_t(b);
+
+    case bin_opcode_t::BAND:
+        return integer_t(a) & integer_t(b);
+
+    case bin_opcode_t::BXOR:
+        return integer_t(a) ^ integer_t(b);
+
+    case bin_opcode_t::BSHR:
+        return integer_t(a) >> integer_t(b);
+
+    case bin_opcode_t::BSHL:
+        return integer_t(a) << integer_t(b);
+
+    default:
+        break;
+    }
+
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long64_t expr_str_bin_t::eval_long64(ctx_t& ctx) const
+{
+    const auto b = _b->eval_str(ctx);
+    const auto a = _a->eval_str(ctx);
+
+    switch (_op) {
+    case bin_opcode_t::EQ:
+        return a == b;
+
+    case bin_opcode_t::NE:
+    case bin_opcode_t::XOR:
+        return a != b;
+
+    case bin_opcode_t::LT:
+        return a < b;
+
+    case bin_opcode_t::LE:
+        return a <= b;
+
+    case bin_opcode_t::GT:
+        return a > b;
+
+    case bin_opcode_t::GE:
+        return a >= b;
+
+    default:
+        break;
+    }
+
+    typed_internal_error();
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+string_t expr_str_bin_t::eval_str(ctx_t& ctx) const
+{
+    if (_op != bin_opcode_t::ADD)
+        typed_internal_error();
+
+    const auto b = _b->eval_str(ctx);
+    return _a->eval_str(ctx) + b;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_double_fma_t::eval_double(ctx_t& ctx) const
+{
+    const auto c = _c->eval_double(ctx);
+    const auto b = _b->eval_double(ctx);
+
+    return ::fma(_a->eval_double(ctx), b, c);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long64_t expr_long64_pow_t::eval_long64(ctx_t& ctx) const
+{
+    const auto b = _b->eval_long64(ctx);
+    const auto a = _a->eval_long64(ctx);
+
+    // Powers exactly representable as double are computed by squaring,
+    // any other one falls back to pow()
+    const long64_t max_exact = long64_t(1) << 53;
+
+    bool exact = b >= 0 && a >= -max_exact && a <= max_exact;
+    long64_t result = 1;
+    long64_t base = a;
+
+    for (auto e = b; exact && e > 0; e >>= 1) {
+        if (e & 1) {
+            exact = base == 0 || (result <= max_exact / std::abs(base)
+                                     && result >= -max_exact / std::abs(base));
+            result *= base;
+        }
+
+        if (exact && e > 1) {
+            exact = std::abs(base) <= (long64_t(1) << 26);
+            base *= base;
+        }
+    }
+
+    // p is exact, so 0.5 + p is computed exactly too
+    const double_t value = exact ? 0.5F + double_t(result)
+                                 : 0.5F + ::pow(double_t(a), double_t(b));
+
+    return type() == type_t::INTEGER ? integer_t(value) : long64_t(value);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double_t expr_double_poly_t::eval_double(ctx_t& ctx) const
+{
+    const auto x = _x->eval_double(ctx);
+    const auto n = _coefficients.size();
+
+    auto coefficient = [&](size_t i) {
+        return _coefficients[i] ? _coefficients[i]->eval_double(ctx) : 0.0;
+    };
+
+    if (n == 0)
+        return 0;
+
+    if (!_estrin || n < 4) {
+        double_t result = coefficient(n - 1);
+
+        for (size_t i = n - 1; i-- > 0;)
+            result = ::fma(result, x, coefficient(i));
+
+        return result;
+    }
+
+    // Estrin: terms are paired as c[2i] + c[2i+1]*x, then the results
+    // are paired again in x^2, x^4, ...
+    double_t c[MAX_DEGREE + 1];
+
+    for (size_t i = 0; i < n; ++i)
+        c[i] = coefficient(i);
+
+    double_t p = x;
+
+    for (size_t m = n; m > 1; m = (m + 1) / 2) {
+        for (size_t i = 0; i < m / 2; ++i)
+            c[i] = ::fma(c[2 * i + 1], p, c[2 * i]);
+
+        if (m & 1)
+            c[m / 2] = c[m - 1];
+
+        p *= p;
+    }
+
+    return c[0];
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
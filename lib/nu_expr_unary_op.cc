@@ -23,7 +23,19 @@ expr_unary_op_t::expr_unary_op_t(
     const std::string& op_name, expr_any_t::handle_t var)
     : _op_name(op_name)
     , _var(var)
+    , _args(1, var)
+    , _fptr(nullptr)
+    , _func(global_function_tbl_t::get_instance().find(op_name))
 {
+    if (!_func) {
+        throw exception_t(
+            std::string("Error: \"" + _op_name + "\" undefined symbol"));
+    }
+
+    auto fptr = _func->target<func_ptr_t>();
+
+    if (fptr)
+        _fptr = *fptr;
 }
 
 
@@ -31,15 +43,8 @@ expr_unary_op_t::expr_unary_op_t(
 
 variant_t expr_unary_op_t::eval(ctx_t& ctx) const
 {
-    if (!global_function_tbl_t::get_instance().is_defined(_op_name)) {
-        throw exception_t(
-            std::string("Error: \"" + _op_name + "\" undefined symbol"));
-    }
-
-    func_args_t args;
-    args.push_back(_var);
-
-    return global_function_tbl_t::get_instance()[_op_name](ctx, _op_name, args);
+    return _fptr ? _fptr(ctx, _op_name, _args)
+                 : (*_func)(ctx, _op_name, _args);
 }
 
 
@@ -20,12 +20,23 @@ namespace nu {
 
 variant_t expr_var_t::eval(ctx_t& ctx) const
 {
-    if (!ctx.is_defined(_name)) {
+    return lookup(ctx);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+const variant_t& expr_var_t::lookup(ctx_t& ctx) const
+{
+    const ctx_t& cctx = ctx;
+    auto it = cctx.map().find(_name);
+
+    if (it == cctx.map().end()) {
         rt_error_code_t::get_instance().throw_exc(
             rt_error_code_t::E_VAR_UNDEF, _name);
     }
-    
-    return ctx[_name];
+
+    return it->second;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -10,15 +10,20 @@
 
 #include "nu_global_function_tbl.h"
 #include "nu_basic_defs.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_literal.h"
 #include "nu_expr_var.h"
+#include "nu_str_view.h"
 #include "nu_variant.h"
 #include "nu_expr_eval.h"
 
+#include <climits>
 #include <cstdlib>
 #include <ctime>
 #include <functional>
 #include <stdlib.h>
 #include <string>
+#include <unordered_map>
 #include <math.h>
 
 
@@ -51,26 +56,59 @@ inline static void check_arg_num(
         break;
     }
 
-    bool valid_args = (expected_arg_num == 0 && args.size() == 0)
-        || (expected_arg_num == 0 && args.size() == 1 && args[0]->empty())
-        || (expected_arg_num == 1 && args.size() == 1 && !args[0]->empty())
-        || (expected_arg_num > 1 && int(args.size()) == expected_arg_num);
+    syntax_error_if(
+        !global_function_tbl_t::is_valid_arg_num(args, expected_arg_num),
+        error);
+}
+
 
-    syntax_error_if(!valid_args, error);
+/* -------------------------------------------------------------------------- */
+
+// Returns true if evaluating expr cannot change the value of any variable
+static bool is_read_only(const expr_any_t::handle_t& expr)
+{
+    if (dynamic_cast<const expr_literal_t*>(expr.get())
+        || dynamic_cast<const expr_var_t*>(expr.get())) {
+        return true;
+    }
+
+    auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+
+    return bin && bin->opcode() != bin_opcode_t::CUSTOM
+        && is_read_only(bin->left()) && is_read_only(bin->right());
 }
 
 
 /* -------------------------------------------------------------------------- */
 
+// Evaluates args, setting argv[i] to the value of argument i.
+// Literals and variables are read in place (so a large string is not
+// copied to extract a part of it) unless evaluating the arguments which
+// follow may change them; other values are stored into vargs
 void get_functor_vargs(ctx_t& ctx, const std::string& name,
     const nu::func_args_t& args,
     const std::vector<variant_t::type_t>& check_vect,
-    std::vector<variant_t>& vargs)
+    std::vector<variant_t>& vargs, std::vector<const variant_t*>& argv)
 {
     check_arg_num(args, int(check_vect.size()), name);
 
-    for (auto& arg : args)
-        vargs.push_back(arg->eval(ctx));
+    vargs.resize(args.size());
+    argv.resize(args.size());
+
+    // Arguments following the last one which may have side effects
+    size_t read_only = args.size();
+
+    while (read_only > 0 && is_read_only(args[read_only - 1]))
+        --read_only;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i + 1 >= read_only) {
+            argv[i] = &args[i]->eval_ref(ctx, vargs[i]);
+        } else {
+            args[i]->eval_into(ctx, vargs[i]);
+            argv[i] = &vargs[i];
+        }
+    }
 
     int i = 0;
 
@@ -84,10 +122,10 @@ void get_functor_vargs(ctx_t& ctx, const std::string& name,
 
         // Accept implicit conversion from/to types double/float/int
         if (variable_t::is_number(vargt)
-            && variable_t::is_number(vargs[i].get_type())) {
+            && variable_t::is_number(argv[i]->get_type())) {
             invalid_check = false;
         } else {
-            invalid_check = vargs[i].get_type() != vargt;
+            invalid_check = argv[i]->get_type() != vargt;
         }
 
         syntax_error_if(invalid_check, "'" + name
@@ -99,6 +137,22 @@ void get_functor_vargs(ctx_t& ctx, const std::string& name,
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+// Converts a functor argument to T. Strings are passed by reference
+template <typename T> struct functor_arg_t {
+    static T get(const variant_t& v) {
+        return static_cast<T>(v);
+    }
+};
+
+template <> struct functor_arg_t<std::string> {
+    static const std::string& get(const variant_t& v) {
+        return v.to_str();
+    }
+};
+
+
 /* -------------------------------------------------------------------------- */
 
 // RT F()(T arg)
@@ -108,9 +162,10 @@ variant_t functor_RT_T(ctx_t& ctx, const std::string& name,
 {
     std::vector<variant_t::type_t> check_vect = { argt };
     std::vector<variant_t> vargs;
-    get_functor_vargs(ctx, name, args, check_vect, vargs);
+    std::vector<const variant_t*> argv;
+    get_functor_vargs(ctx, name, args, check_vect, vargs, argv);
 
-    auto arg = static_cast<T>(vargs[0]);
+    const auto& arg = functor_arg_t<T>::get(*argv[0]);
 
     return nu::variant_t(RT(F()(arg)));
 }
@@ -126,10 +181,11 @@ variant_t functor_RT_T1_T2(ctx_t& ctx, const std::string& name,
 {
     std::vector<variant_t::type_t> check_vect = { argt1, argt2 };
     std::vector<variant_t> vargs;
-    get_functor_vargs(ctx, name, args, check_vect, vargs);
+    std::vector<const variant_t*> argv;
+    get_functor_vargs(ctx, name, args, check_vect, vargs, argv);
 
-    auto arg1 = static_cast<T1>(vargs[0]);
-    auto arg2 = static_cast<T2>(vargs[1]);
+    const auto& arg1 = functor_arg_t<T1>::get(*argv[0]);
+    const auto& arg2 = functor_arg_t<T2>::get(*argv[1]);
 
     return nu::variant_t(RT(F()(arg1, arg2)));
 }
@@ -145,11 +201,12 @@ variant_t functor_RT_T1_T2_T3(ctx_t& ctx, const std::string& name,
 {
     std::vector<variant_t::type_t> check_vect = { argt1, argt2, argt3 };
     std::vector<variant_t> vargs;
-    get_functor_vargs(ctx, name, args, check_vect, vargs);
+    std::vector<const variant_t*> argv;
+    get_functor_vargs(ctx, name, args, check_vect, vargs, argv);
 
-    auto arg1 = static_cast<T1>(vargs[0]);
-    auto arg2 = static_cast<T2>(vargs[1]);
-    auto arg3 = static_cast<T3>(vargs[2]);
+    const auto& arg1 = functor_arg_t<T1>::get(*argv[0]);
+    const auto& arg2 = functor_arg_t<T2>::get(*argv[1]);
+    const auto& arg3 = functor_arg_t<T3>::get(*argv[2]);
 
     return nu::variant_t(RT(F()(arg1, arg2, arg3)));
 }
@@ -166,12 +223,13 @@ variant_t functor_RT_T1_T2_T3_T4(ctx_t& ctx, const std::string& name,
 {
     std::vector<variant_t::type_t> check_vect = { argt1, argt2, argt3, argt4 };
     std::vector<variant_t> vargs;
-    get_functor_vargs(ctx, name, args, check_vect, vargs);
+    std::vector<const variant_t*> argv;
+    get_functor_vargs(ctx, name, args, check_vect, vargs, argv);
 
-    auto arg1 = static_cast<T1>(vargs[0]);
-    auto arg2 = static_cast<T2>(vargs[1]);
-    auto arg3 = static_cast<T3>(vargs[2]);
-    auto arg4 = static_cast<T3>(vargs[3]);
+    const auto& arg1 = functor_arg_t<T1>::get(*argv[0]);
+    const auto& arg2 = functor_arg_t<T2>::get(*argv[1]);
+    const auto& arg3 = functor_arg_t<T3>::get(*argv[2]);
+    const auto& arg4 = functor_arg_t<T4>::get(*argv[3]);
 
     return nu::variant_t(RT(F()(arg1, arg2, arg3, arg4)));
 }
@@ -424,7 +482,7 @@ static variant_t process_operator(ctx_t& ctx,
     rt_error_code_t::get_instance().throw_if(
         var_ptr == nullptr, rt_error_code_t::E_INVALID_ARGS);
 
-    const auto variable_name = var_ptr->name();
+    const auto& variable_name = var_ptr->atom();
 
     rt_error_code_t::get_instance().throw_if(!
         ctx.is_defined(variable_name),
@@ -490,7 +548,8 @@ fmap["sin"] = functor<float, _sin>;
     struct _##_FNC_ {                                                          \
         double operator()(double x) noexcept { return _FNC_(x); }              \
     };                                                                         \
-    fmap[#_FNC_] = math_functor<double, _##_FNC_>;
+    fmap[#_FNC_] = math_functor<double, _##_FNC_>;                          \
+    fmap.set_math_fn(#_FNC_, [](double x) { return _##_FNC_()(x); });
 
         __DOUBLE_FUNCTOR_BUILDER(sin);
         __DOUBLE_FUNCTOR_BUILDER(cos);
@@ -516,6 +575,7 @@ fmap["sin"] = functor<float, _sin>;
 
 
         fmap["sign"] = math_functor<double, _sign>;
+        fmap.set_math_fn("sign", [](double x) { return _sign()(x); });
 
 
         struct _min {
@@ -526,6 +586,8 @@ fmap["sin"] = functor<float, _sin>;
 
 
         fmap["min"] = math_functor2<double, _min>;
+        fmap.set_math_fn(
+            "min", [](double x, double y) { return _min()(x, y); });
 
 
         struct _max {
@@ -536,6 +598,8 @@ fmap["sin"] = functor<float, _sin>;
 
 
         fmap["max"] = math_functor2<double, _max>;
+        fmap.set_math_fn(
+            "max", [](double x, double y) { return _max()(x, y); });
 
 
         struct _pow {
@@ -546,6 +610,8 @@ fmap["sin"] = functor<float, _sin>;
 
 
         fmap["pow"] = math_functor2<double, _pow>;
+        fmap.set_math_fn(
+            "pow", [](double x, double y) { return _pow()(x, y); });
 
 
         struct _int_truncate {
@@ -568,6 +634,7 @@ fmap["sin"] = functor<float, _sin>;
 
         // sqr is an alias of sqrt
         fmap["sqr"] = math_functor<double, _sqrt>;
+        fmap.set_math_fn("sqr", [](double x) { return _sqrt()(x); });
 
 
         struct _rnd {
@@ -615,7 +682,7 @@ fmap["sin"] = functor<float, _sin>;
 
 
         struct _len_str {
-            int operator()(const std::string x) noexcept
+            int operator()(const std::string& x) noexcept
             {
                 return int(x.size());
             }
@@ -625,7 +692,7 @@ fmap["sin"] = functor<float, _sin>;
 
 
         struct _asc_str {
-            int operator()(const std::string x) noexcept
+            int operator()(const std::string& x) noexcept
             {
                 return (x.empty() ? 0 : x.c_str()[0]) & 0xff;
             }
@@ -728,40 +795,19 @@ fmap["sin"] = functor<float, _sin>;
         struct _instrcs {
             int operator()(
                 const std::string& s, const std::string& search_str) noexcept  {
-                if (search_str.empty())
-                    return 0;
-                else if (s.empty() || search_str.size() > s.size())
-                    return -1;
-                else if (search_str.size() == s.size() && s == search_str)
-                    return 0;
-
-                std::string mystr = s;
-                int pos = 0;
-
-                while (search_str.size() <= mystr.size()) {
-                    if (mystr.substr(0, search_str.size()) == search_str)
-                        return pos;
-
-                    ++pos;
-                    mystr = mystr.substr(1, mystr.size() - 1);
-                }
-
-                return -1;
+                const auto pos = str_view_t(s).find(search_str);
+                return pos == str_view_t::npos ? -1 : int(pos);
             }
         };
 
         fmap["instrcs"] = functor_int_string_string<_instrcs>;
 
 
-        struct _instr : public _instrcs {
+        struct _instr {
             int operator()(
                 const std::string& s, const std::string& search_str) noexcept {
-                std::string mys = s;
-                std::string ss = search_str;
-                std::transform(mys.begin(), mys.end(), mys.begin(), toupper);
-                std::transform(ss.begin(), ss.end(), ss.begin(), toupper);
-
-                return _instrcs::operator()(mys, ss);
+                const auto pos = str_view_t(s).ifind(search_str);
+                return pos == str_view_t::npos ? -1 : int(pos);
             }
         };
 
@@ -877,10 +923,10 @@ fmap["sin"] = functor<float, _sin>;
             std::string operator()(double x) noexcept
             {
                 if (::floor(x) == x) {
-                    return to_string(int(x));
+                    return format_integer(int(x));
                 }
 
-                return to_string(x);
+                return format_fixed(x);
             }
         };
 
@@ -891,11 +937,9 @@ fmap["sin"] = functor<float, _sin>;
         struct _to_str_precision {
             std::string operator()(double x, int digits) noexcept
             {
-                char buffer[1024] = { 0 };
-                std::string format = "%." + std::to_string(abs(digits)) + "f";
-                snprintf(buffer, sizeof(buffer) - 1, format.c_str(), x);
-
-                return buffer;
+                // -INT_MIN is not an int, format_fixed() bounds the rest
+                return format_fixed(
+                    x, digits == INT_MIN ? INT_MAX : std::abs(digits));
             }
         };
 
@@ -905,16 +949,14 @@ fmap["sin"] = functor<float, _sin>;
         struct _to_hex_str {
             std::string operator()(double x) noexcept
             {
-                std::stringstream ss;
-                ss << std::hex << int(x);
-                return ss.str();
+                return format_hex(unsigned(int(x)));
             }
         };
 
         fmap["hex"] = functor_string_double<_to_hex_str>;
 
 
-        auto functor_pi = [](ctx_t& ctx, const std::string& name,
+        func_ptr_t functor_pi = [](ctx_t& ctx, const std::string& name,
             const nu::func_args_t& args) {
             check_arg_num(args, 0, name);
             return nu::variant_t(3.1415926535897F);
@@ -923,17 +965,73 @@ fmap["sin"] = functor<float, _sin>;
         fmap["pi"] = functor_pi;
 
 
-        auto functor_sizeof = [](ctx_t& ctx, const std::string& name,
+        func_ptr_t functor_sizeof = [](ctx_t& ctx, const std::string& name,
             const nu::func_args_t& args) {
-            std::vector<variant_t> vargs;
-            get_functor_vargs(
-                ctx, name, args, { variant_t::type_t::UNDEFINED }, vargs);
+            check_arg_num(args, 1, name);
 
-            return nu::variant_t(integer_t(vargs[0].vector_size()));
+            // The argument is not copied, it may be a large vector
+            variant_t tmp;
+            const auto& value = args[0]->eval_ref(ctx, tmp);
+
+            return nu::variant_t(integer_t(value.vector_size()));
         };
 
 
         fmap["size"] = functor_sizeof;
+
+
+        // Types of the values returned by built-in functions
+
+        using type_t = variant_t::type_t;
+
+        for (auto name : { "truncf", "pi" })
+            fmap.set_return_type(name, type_t::FLOAT);
+
+        for (auto name : { "sin", "cos", "tan", "log", "log10", "exp", "abs",
+                 "asin", "acos", "atan", "sinh", "cosh", "tanh", "sqrt",
+                 "sign", "min", "max", "pow", "sqr", "rnd", "val" }) {
+            fmap.set_return_type(name, type_t::DOUBLE);
+        }
+
+        for (auto name : { "int", "not", "b_not", "len", "asc", "instrcs",
+                 "instr", "size" }) {
+            fmap.set_return_type(name, type_t::INTEGER);
+        }
+
+        for (auto name : { "spc", "chr", "left", "lcase", "ucase", "right",
+                 "substr", "mid", "pstr", "str", "strp", "hex" }) {
+            fmap.set_return_type(name, type_t::STRING);
+        }
+
+
+        // Numbers of arguments, checked before evaluating any of them
+
+        fmap.set_arg_num("pi", 0);
+
+        for (auto name : { "truncf", "sin", "cos", "tan", "log", "log10",
+                 "exp", "abs", "asin", "acos", "atan", "sinh", "cosh", "tanh",
+                 "sqrt", "sign", "int", "sqr", "rnd", "not", "b_not", "len",
+                 "asc", "spc", "chr", "lcase", "ucase", "val", "str", "hex",
+                 "size" }) {
+            fmap.set_arg_num(name, 1);
+        }
+
+        for (auto name : { "min", "max", "pow", "left", "right", "instrcs",
+                 "instr", "strp" }) {
+            fmap.set_arg_num(name, 2);
+        }
+
+        for (auto name : { "substr", "mid", "pstr" })
+            fmap.set_arg_num(name, 3);
+
+
+        // Every built-in function is pure but rnd() and the unary operators
+        for (const auto& f : fmap.map())
+            fmap.set_pure(f.first, true);
+
+        fmap.set_pure("rnd", false);
+        fmap.set_pure(NU_EXPREVAL_OP_INC, false);
+        fmap.set_pure(NU_EXPREVAL_OP_DEC, false);
     }
 
 
@@ -941,6 +1039,75 @@ fmap["sin"] = functor<float, _sin>;
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+using builtin_operators_t = std::unordered_map<std::string, bin_opcode_t>;
+
+static const builtin_operators_t& builtin_operators()
+{
+    static const builtin_operators_t ops = {
+        { "mod", bin_opcode_t::INT_MOD },
+        { "div", bin_opcode_t::INT_DIV },
+        { "<=", bin_opcode_t::LE },
+        { ">=", bin_opcode_t::GE },
+        { "=", bin_opcode_t::EQ },
+        { "<>", bin_opcode_t::NE },
+        { "<", bin_opcode_t::LT },
+        { ">", bin_opcode_t::GT },
+        { "+", bin_opcode_t::ADD },
+        { "-", bin_opcode_t::SUB },
+        { "/", bin_opcode_t::DIV },
+        { "*", bin_opcode_t::MUL },
+        { "^", bin_opcode_t::POW },
+        { "\\", bin_opcode_t::INT_DIV },
+        { "and", bin_opcode_t::AND },
+        { "or", bin_opcode_t::OR },
+        { "xor", bin_opcode_t::XOR },
+        { "bor", bin_opcode_t::BOR },
+        { "band", bin_opcode_t::BAND },
+        { "bxor", bin_opcode_t::BXOR },
+        { "bshr", bin_opcode_t::BSHR },
+        { "bshl", bin_opcode_t::BSHL },
+    };
+
+    return ops;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Implementation of the built-in operators stored in the table, which
+// tells an entry still holding it from one an application replaced
+struct builtin_binop_t {
+    bin_opcode_t code;
+
+    variant_t operator()(const variant_t& a, const variant_t& b) const {
+        return global_operator_tbl_t::apply(code, a, b);
+    }
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+bool global_operator_tbl_t::get_opcode(
+    const std::string& name, bin_opcode_t& code)
+{
+    const auto& tbl = get_instance().map();
+    auto i = tbl.find(name);
+
+    if (i == tbl.end())
+        return false;
+
+    auto builtin = i->second.target<builtin_binop_t>();
+
+    if (!builtin)
+        return false;
+
+    code = builtin->code;
+    return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 global_operator_tbl_t& global_operator_tbl_t::get_instance()
@@ -950,35 +1117,11 @@ global_operator_tbl_t& global_operator_tbl_t::get_instance()
         assert(_instance);
 
         global_operator_tbl_t& opmap = *_instance;
-        using arg_t = const variant_t&;
-
-        opmap["mod"] = [](arg_t a, arg_t b) { return a.int_mod(b); };
-        opmap["div"] = [](arg_t a, arg_t b) { return a.int_div(b); };
-        opmap["<="] = [](arg_t a, arg_t b) { return a <= b; };
-        opmap[">="] = [](arg_t a, arg_t b) { return a >= b; };
-        opmap["="] = [](arg_t a, arg_t b) { return a == b; };
-        opmap["<>"] = [](arg_t a, arg_t b) { return a != b; };
-        opmap["<"] = [](arg_t a, arg_t b) { return a < b; };
-        opmap[">"] = [](arg_t a, arg_t b) { return a > b; };
-        opmap["+"] = [](arg_t a, arg_t b) { return a + b; };
-        opmap["-"] = [](arg_t a, arg_t b) { return a - b; };
-        opmap["/"] = [](arg_t a, arg_t b) { return a / b; };
-        opmap["*"] = [](arg_t a, arg_t b) { return a * b; };
-        opmap["^"] = [](arg_t a, arg_t b) { return a.power(b); };
-        opmap["\\"] = [](arg_t a, arg_t b) { return a.int_div(b); };
-        opmap["and"] = [](arg_t a, arg_t b) { return a && b; };
-        opmap["or"] = [](arg_t a, arg_t b) { return a || b; };
-        opmap["xor"] = [](arg_t a, arg_t b) { return a != b; };
-
-        opmap["bor"] = [](arg_t a, arg_t b) { return a.to_int() | b.to_int(); };
-        opmap["band"]
-            = [](arg_t a, arg_t b) { return a.to_int() & b.to_int(); };
-        opmap["bxor"]
-            = [](arg_t a, arg_t b) { return a.to_int() ^ b.to_int(); };
-        opmap["bshr"]
-            = [](arg_t a, arg_t b) { return a.to_int() >> b.to_int(); };
-        opmap["bshl"]
-            = [](arg_t a, arg_t b) { return a.to_int() << b.to_int(); };
+
+        // Built-in operators are also exposed as binop_t, backed by the
+        // same implementation the compiler binds to
+        for (const auto& op : builtin_operators())
+            opmap[op.first] = builtin_binop_t{ op.second };
     }
 
     return *_instance;
@@ -0,0 +1,135 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_slot_ctx.h"
+
+#include <cassert>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t slot_tbl_t::bind(const atom_t& name)
+{
+    auto it = _index.find(name);
+
+    if (it != _index.end())
+        return it->second;
+
+    const size_t idx = _names.size();
+
+    _names.push_back(name);
+    _index.insert(std::make_pair(name, idx));
+
+    return idx;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool slot_tbl_t::find(const atom_t& name, size_t& idx) const noexcept
+{
+    auto it = _index.find(name);
+
+    if (it == _index.end())
+        return false;
+
+    idx = it->second;
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+slot_ctx_t::slot_ctx_t(slot_tbl_t::handle_t tbl)
+    : _tbl(tbl)
+{
+    assert(_tbl);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+slot_ctx_t::slot_ctx_t(const slot_ctx_t& other)
+    : ctx_t(other)
+    , _tbl(other._tbl)
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+variant_t* slot_ctx_t::resolve(size_t idx)
+{
+    if (idx >= _tbl->size())
+        return nullptr;
+
+    auto it = map().find(_tbl->name(idx));
+
+    if (it == map().end())
+        return nullptr;
+
+    if (_cache.size() <= idx)
+        _cache.resize(_tbl->size(), nullptr);
+
+    // Elements of unordered_map are not moved by rehashing,
+    // so the address remains valid until the variable is erased
+    _cache[idx] = &it->second;
+
+    return _cache[idx];
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void slot_ctx_t::set(size_t idx, const variant_t& value)
+{
+    auto var = slot(_tbl.get(), idx);
+
+    if (var)
+        *var = value;
+    else
+        define(_tbl->name(idx), value);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void slot_ctx_t::erase(const atom_t& name)
+{
+    size_t idx = 0;
+
+    if (_tbl->find(name, idx) && idx < _cache.size())
+        _cache[idx] = nullptr;
+
+    ctx_t::erase(name);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void slot_ctx_t::clear()
+{
+    _cache.clear();
+    ctx_t::clear();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,138 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_str_view.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NU_STR_VIEW_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+const size_t str_view_t::npos;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Case folding of ASCII letters (the "C" locale ::toupper)
+static inline unsigned char fold(unsigned char c) noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static inline bool is_alpha(unsigned char c) noexcept
+{
+    return fold(c) >= 'a' && fold(c) <= 'z';
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static bool equal(
+    const char* a, const char* b, size_t n, bool icase) noexcept
+{
+    if (!icase)
+        return memcmp(a, b, n) == 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        if (fold(a[i]) != fold(b[i]))
+            return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t str_view_t::search(str_view_t s, bool icase) const noexcept
+{
+    if (s.empty())
+        return 0;
+
+    if (s.size() > _size)
+        return npos;
+
+    const size_t last = _size - s.size();
+    size_t pos = 0;
+
+#ifdef NU_STR_VIEW_SSE2
+    // Candidates are found 16 positions at a time comparing the first
+    // and the last character of s; the others are compared only where
+    // both match. Setting bit 0x20 maps the two cases of a letter to
+    // the same value, so it is done only for letters
+    const unsigned char first = s[0];
+    const unsigned char tail = s[s.size() - 1];
+
+    const bool fold_first = icase && is_alpha(first);
+    const bool fold_tail = icase && is_alpha(tail);
+
+    const __m128i first_v = _mm_set1_epi8(char(fold_first ? first | 0x20 : first));
+    const __m128i first_m = _mm_set1_epi8(char(fold_first ? 0x20 : 0));
+    const __m128i tail_v = _mm_set1_epi8(char(fold_tail ? tail | 0x20 : tail));
+    const __m128i tail_m = _mm_set1_epi8(char(fold_tail ? 0x20 : 0));
+
+    for (; pos + 16 <= last + 1; pos += 16) {
+        const __m128i a = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(_data + pos));
+        const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(_data + pos + s.size() - 1));
+
+        const __m128i eq = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_or_si128(a, first_m), first_v),
+            _mm_cmpeq_epi8(_mm_or_si128(b, tail_m), tail_v));
+
+        unsigned mask = unsigned(_mm_movemask_epi8(eq));
+
+        while (mask) {
+            unsigned bit = 0;
+
+            while (!(mask & (1u << bit)))
+                ++bit;
+
+            if (s.size() <= 2
+                || equal(_data + pos + bit + 1, s.data() + 1, s.size() - 2,
+                       icase)) {
+                return pos + bit;
+            }
+
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; pos <= last; ++pos) {
+        if (equal(_data + pos, s.data(), s.size(), icase))
+            return pos;
+    }
+
+    return npos;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
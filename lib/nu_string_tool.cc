@@ -10,6 +10,12 @@
 
 #include "nu_string_tool.h"
 
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -21,4 +27,310 @@
 #endif
 
 
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+// Parses [+-]digits[.digits][(e|E)[+-]digits], which must span the whole
+// string, into a decimal mantissa of at most 19 digits and an exponent.
+// Returns false for any other form
+static bool parse_decimal(const char* p, bool& neg, std::uint64_t& mantissa,
+    int& exp10, bool& has_point)
+{
+    neg = *p == '-';
+
+    if (*p == '-' || *p == '+')
+        ++p;
+
+    mantissa = 0;
+    exp10 = 0;
+    has_point = false;
+
+    int digits = 0;
+    int significant = 0;
+
+    for (;; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            ++digits;
+
+            if (mantissa == 0 && *p == '0') {
+                if (has_point)
+                    --exp10;
+
+                continue;
+            }
+
+            if (++significant > 19)
+                return false;
+
+            mantissa = mantissa * 10 + unsigned(*p - '0');
+
+            if (has_point)
+                --exp10;
+        } else if (*p == '.' && !has_point) {
+            has_point = true;
+        } else {
+            break;
+        }
+    }
+
+    if (digits == 0)
+        return false;
+
+    if (*p == 'e' || *p == 'E') {
+        ++p;
+
+        const bool neg_exp = *p == '-';
+
+        if (*p == '-' || *p == '+')
+            ++p;
+
+        if (*p < '0' || *p > '9')
+            return false;
+
+        int e = 0;
+
+        for (; *p >= '0' && *p <= '9'; ++p) {
+            if (e < 10000)
+                e = e * 10 + (*p - '0');
+        }
+
+        exp10 += neg_exp ? -e : e;
+        has_point = true;
+    }
+
+    return *p == '\0';
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+double stod(const std::string& s)
+{
+#if FLT_EVAL_METHOD == 0
+    // Clinger's fast path: a mantissa and a power of ten which are both
+    // exact doubles give the correctly rounded result with one operation
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+        1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+        1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    bool neg = false;
+    bool has_point = false;
+    std::uint64_t mantissa = 0;
+    int exp10 = 0;
+
+    if (parse_decimal(s.c_str(), neg, mantissa, exp10, has_point)
+        && mantissa <= (std::uint64_t(1) << 53) && exp10 >= -22
+        && exp10 <= 22) {
+        double x = double(mantissa);
+
+        if (exp10 < 0)
+            x /= pow10[-exp10];
+        else
+            x *= pow10[exp10];
+
+        return neg ? -x : x;
+    }
+#endif
+
+    return std::stod(s);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+long long stoll(const std::string& s)
+{
+    bool neg = false;
+    bool has_point = false;
+    std::uint64_t mantissa = 0;
+    int exp10 = 0;
+
+    // At most 18 digits cannot overflow
+    if (parse_decimal(s.c_str(), neg, mantissa, exp10, has_point)
+        && !has_point && mantissa < 1000000000000000000ULL) {
+        return neg ? -(long long)(mantissa) : (long long)(mantissa);
+    }
+
+    return std::stoll(s);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Writes the decimal digits of n backwards, ending at end.
+// Digits are produced two at a time
+static char* format_digits(std::uint64_t n, char* end)
+{
+    static const char pairs[] = "00010203040506070809"
+                                "10111213141516171819"
+                                "20212223242526272829"
+                                "30313233343536373839"
+                                "40414243444546474849"
+                                "50515253545556575859"
+                                "60616263646566676869"
+                                "70717273747576777879"
+                                "80818283848586878889"
+                                "90919293949596979899";
+
+    while (n >= 100) {
+        const unsigned i = unsigned(n % 100) * 2;
+        n /= 100;
+        *--end = pairs[i + 1];
+        *--end = pairs[i];
+    }
+
+    if (n >= 10) {
+        const unsigned i = unsigned(n) * 2;
+        *--end = pairs[i + 1];
+        *--end = pairs[i];
+    } else {
+        *--end = char('0' + n);
+    }
+
+    return end;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string format_integer(long long n)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+
+    const std::uint64_t u
+        = n < 0 ? std::uint64_t(0) - std::uint64_t(n) : std::uint64_t(n);
+
+    char* p = format_digits(u, end);
+
+    if (n < 0)
+        *--p = '-';
+
+    return std::string(p, end);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string format_hex(unsigned long long n)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+
+    do {
+        *--p = "0123456789abcdef"[n & 0xf];
+        n >>= 4;
+    } while (n);
+
+    return std::string(p, end);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+std::string format_fixed(double x, int prec)
+{
+    if (prec > FORMAT_FIXED_MAX_PREC)
+        prec = FORMAT_FIXED_MAX_PREC;
+
+#ifdef __SIZEOF_INT128__
+    using uint128_t = unsigned __int128;
+
+    static const std::uint64_t pow10[] = { 1, 10, 100, 1000, 10000, 100000,
+        1000000, 10000000, 100000000, 1000000000 };
+
+    std::uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    const int biased_exp = int((bits >> 52) & 0x7ff);
+    std::uint64_t m = bits & ((std::uint64_t(1) << 52) - 1);
+
+    // x = m * 2^e exactly
+    int e = -1074;
+
+    if (biased_exp) {
+        m |= std::uint64_t(1) << 52;
+        e = biased_exp - 1075;
+    }
+
+    // Values up to 2^64 with up to 9 decimals are converted exactly, with
+    // ties rounded to even as printf() does; the scaled value fits 128 bits
+    if (biased_exp != 0x7ff && prec >= 0 && prec <= 9 && e <= 11) {
+        uint128_t n = uint128_t(m) * pow10[prec];
+
+        if (e >= 0) {
+            n <<= e;
+        } else if (e > -128) {
+            const int k = -e;
+            const uint128_t rem = n & ((uint128_t(1) << k) - 1);
+            const uint128_t half = uint128_t(1) << (k - 1);
+
+            n >>= k;
+
+            if (rem > half || (rem == half && (n & 1)))
+                ++n;
+        } else {
+            // Less than 2^-74: the scaled value rounds to 0
+            n = 0;
+        }
+
+        // Digits of the integer and fractional parts, with the leading zero
+        char buf[64];
+        char* end = buf + sizeof(buf);
+        char* p;
+
+        const std::uint64_t ten19 = 10000000000000000000ULL;
+
+        if (n >> 64) {
+            p = format_digits(std::uint64_t(n % ten19), end);
+
+            while (p > end - 19)
+                *--p = '0';
+
+            p = format_digits(std::uint64_t(n / ten19), p);
+        } else {
+            p = format_digits(std::uint64_t(n), end);
+        }
+
+        while (end - p <= prec)
+            *--p = '0';
+
+        std::string ret;
+        ret.reserve(size_t(end - p) + 2);
+
+        if (bits >> 63)
+            ret += '-';
+
+        ret.append(p, size_t(end - p - prec));
+
+        if (prec > 0) {
+            ret += '.';
+            ret.append(end - prec, size_t(prec));
+        }
+
+        return ret;
+    }
+#endif
+
+    // Sign, 309 integer digits, point and FORMAT_FIXED_MAX_PREC decimals
+    char buf[1400];
+    const int len = snprintf(buf, sizeof(buf), "%.*f", prec, x);
+
+    if (len < 0 || size_t(len) >= sizeof(buf))
+        return std::string();
+
+    return std::string(buf, size_t(len));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
 /* -------------------------------------------------------------------------- */
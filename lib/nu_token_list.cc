@@ -19,6 +19,28 @@
 namespace nu {
 
 
+/* -------------------------------------------------------------------------- */
+
+const std::string& token_list_t::expression() const noexcept
+{
+    static const std::string empty;
+    return _tbl ? _tbl->expression() : empty;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+token_list_t::btfunc_t token_list_t::match(const tkp_t& tkp) const
+{
+    const auto id = find_id(tkp.first);
+    const auto type = tkp.second;
+
+    return [id, type](const token_t& t) {
+        return t.id() == id && t.type() == type;
+    };
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 // prefix
@@ -51,11 +73,8 @@ token_list_t token_list_t::sublist(size_t pos, size_t items)
 {
     assert(!((pos + items) > size()));
 
-    token_list_t ret;
-
-    for (size_t i = pos; i < (items + pos); ++i) {
-        ret += (*this)[i];
-    }
+    token_list_t ret(empty_list());
+    ret.data().insert(ret.end(), begin() + pos, begin() + pos + items);
 
     return ret;
 }
@@ -85,8 +104,7 @@ size_t token_list_t::find(
 size_t token_list_t::find(const token_t& t, size_t pos, size_t items)
 {
     auto test = [&](size_t i) {
-        return (*this)[i].identifier() == t.identifier()
-            && (*this)[i].type() == t.type();
+        return _data[i].id() == t.id() && _data[i].type() == t.type();
     };
 
     return find(test, pos, items);
@@ -98,7 +116,19 @@ size_t token_list_t::find(const token_t& t, size_t pos, size_t items)
 size_t token_list_t::find(
     const std::string& identifier, size_t pos, size_t items)
 {
-    auto test = [&](size_t i) { return (*this)[i].identifier() == identifier; };
+    const auto id = find_id(identifier);
+    auto test = [&](size_t i) { return _data[i].id() == id; };
+
+    return find(test, pos, items);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t token_list_t::find(const tkp_t& tkp, size_t pos, size_t items)
+{
+    const auto test_tkp = match(tkp);
+    auto test = [&](size_t i) { return test_tkp(_data[i]); };
 
     return find(test, pos, items);
 }
@@ -121,7 +151,7 @@ std::list<token_list_t> token_list_t::get_parameters(btfunc_t test_begin,
 {
     assert(search_from < size());
 
-    token_list_t ret;
+    token_list_t ret(empty_list());
     int level = 0;
     size_t end_pos = 0;
     size_t begin_pos = 0;
@@ -157,8 +187,8 @@ std::list<token_list_t> token_list_t::get_parameters(btfunc_t test_begin,
     }
 
     if (level > 0) {
-        const token_t& t = (*this)[end_pos];
-        syntax_error(t.expression(), t.position(), "Missing token, error");
+        const token_t& t = _data[end_pos];
+        syntax_error(expression(), t.position(), "Missing token, error");
     }
 
     return ret_list;
@@ -170,20 +200,7 @@ std::list<token_list_t> token_list_t::get_parameters(btfunc_t test_begin,
 std::list<token_list_t> token_list_t::get_parameters(
     const tkp_t& tbegin, const tkp_t& tend, const tkp_t& tseparator)
 {
-    auto fb = [&](const token_t& t) {
-        return t.identifier() == tbegin.first && t.type() == tbegin.second;
-    };
-
-    auto fe = [&](const token_t& t) {
-        return t.identifier() == tend.first && t.type() == tend.second;
-    };
-
-    auto fs = [&](const token_t& t) {
-        return t.identifier() == tseparator.first
-            && t.type() == tseparator.second;
-    };
-
-    return get_parameters(fb, fe, fs, 0);
+    return get_parameters(match(tbegin), match(tend), match(tseparator), 0);
 }
 
 
@@ -196,7 +213,7 @@ token_list_t token_list_t::sublist(
 {
     assert(search_from < size());
 
-    token_list_t ret;
+    token_list_t ret(empty_list());
     int level = 0;
     size_t end_pos = 0;
     size_t begin_pos = 0;
@@ -224,9 +241,9 @@ token_list_t token_list_t::sublist(
     }
 
     if (level > 0) {
-        const token_t& t = (*this)[end_pos];
+        const token_t& t = _data[end_pos];
 
-        syntax_error(t.expression(), t.position(), "Missing token, error");
+        syntax_error(expression(), t.position(), "Missing token, error");
     }
 
     if (b_erase)
@@ -243,17 +260,14 @@ token_list_t token_list_t::sublist(
 token_list_t token_list_t::sublist(const token_t& first, const token_t& second,
     size_t search_from, bool b_erase)
 {
-
     auto test_begin = [&](const token_t& t) {
-        return t.identifier() == first.identifier() && t.type() == first.type();
+        return t.id() == first.id() && t.type() == first.type();
     };
 
     auto test_end = [&](const token_t& t) {
-        return t.identifier() == second.identifier()
-            && t.type() == second.type();
+        return t.id() == second.id() && t.type() == second.type();
     };
 
-
     return sublist(test_begin, test_end, search_from, b_erase);
 }
 
@@ -263,17 +277,7 @@ token_list_t token_list_t::sublist(const token_t& first, const token_t& second,
 token_list_t token_list_t::sublist(
     const tkp_t& first, const tkp_t& second, size_t search_from, bool b_erase)
 {
-
-    auto test_begin = [&](const token_t& t) {
-        return t.identifier() == first.first && t.type() == first.second;
-    };
-
-    auto test_end = [&](const token_t& t) {
-        return t.identifier() == second.first && t.type() == second.second;
-    };
-
-
-    return sublist(test_begin, test_end, search_from, b_erase);
+    return sublist(match(first), match(second), search_from, b_erase);
 }
 
 
@@ -284,15 +288,18 @@ token_list_t::data_t::iterator token_list_t::skip_right(
 {
     assert(search_from != end());
 
+    const auto first_id = find_id(first.first);
+    const auto second_id = find_id(second.first);
+
     int level = 0;
 
     for (; search_from != end(); ++search_from) {
         const token_t& t = *search_from;
 
-        if (t.identifier() == first.first && t.type() == first.second)
+        if (t.id() == first_id && t.type() == first.second)
             ++level;
 
-        if (t.identifier() == second.first && t.type() == second.second) {
+        if (t.id() == second_id && t.type() == second.second) {
             --level;
 
             if (level < 1) {
@@ -305,7 +312,7 @@ token_list_t::data_t::iterator token_list_t::skip_right(
     if (level > 0) {
         const token_t& t = *(end() - 1);
 
-        syntax_error(t.expression(), t.position(), "Missing token, error");
+        syntax_error(expression(), t.position(), "Missing token, error");
     }
 
     return search_from;
@@ -320,15 +327,18 @@ token_list_t::data_t::reverse_iterator token_list_t::skip_left(
 {
     assert(search_from != rend());
 
+    const auto first_id = find_id(first.first);
+    const auto second_id = find_id(second.first);
+
     int level = 0;
 
     for (; search_from != rend(); ++search_from) {
         const token_t& t = *search_from;
 
-        if (t.identifier() == second.first && t.type() == second.second)
+        if (t.id() == second_id && t.type() == second.second)
             ++level;
 
-        if (t.identifier() == first.first && t.type() == first.second) {
+        if (t.id() == first_id && t.type() == first.second) {
             --level;
 
             if (level < 1) {
@@ -340,7 +350,7 @@ token_list_t::data_t::reverse_iterator token_list_t::skip_left(
 
     if (level > 0) {
         const token_t& t = *(rend() - 1);
-        syntax_error(t.expression(), t.position(), "Missing token, error");
+        syntax_error(expression(), t.position(), "Missing token, error");
     }
 
     return search_from;
@@ -356,12 +366,16 @@ token_list_t token_list_t::replace_sublist(
 {
     assert(search_from < size());
 
-    token_list_t sub_list = sublist(test_begin, test_end, search_from, false);
-    token_list_t head_list = sublist(0, search_from);
-    token_list_t tail_list = sublist(
-        search_from + sub_list.size(), size() - search_from - sub_list.size());
+    const auto items
+        = sublist(test_begin, test_end, search_from, false).size();
+
+    token_list_t ret(empty_list());
 
-    return head_list + replist + tail_list;
+    ret.data().insert(ret.end(), begin(), begin() + search_from);
+    ret += replist;
+    ret.data().insert(ret.end(), begin() + search_from + items, end());
+
+    return ret;
 }
 
 
@@ -372,11 +386,14 @@ token_list_t token_list_t::replace_sublist(
 {
     assert(!(end_pos < begin_pos || end_pos >= size()));
 
-    token_list_t sub_list = sublist(begin_pos, end_pos - begin_pos + 1);
-    token_list_t head_list = sublist(0, begin_pos);
-    token_list_t tail_list = sublist(end_pos + 1, size() - end_pos - 1);
+    // Head and tail are copied straight into the result
+    token_list_t ret(empty_list());
 
-    return head_list + replist + tail_list;
+    ret.data().insert(ret.end(), begin(), begin() + begin_pos);
+    ret += replist;
+    ret.data().insert(ret.end(), begin() + end_pos + 1, end());
+
+    return ret;
 }
 
 
@@ -385,16 +402,7 @@ token_list_t token_list_t::replace_sublist(
 token_list_t token_list_t::replace_sublist(const tkp_t& first,
     const tkp_t& second, size_t search_from, const token_list_t& replist)
 {
-
-    auto test_begin = [&](const token_t& t) {
-        return t.identifier() == first.first && t.type() == first.second;
-    };
-
-    auto test_end = [&](const token_t& t) {
-        return t.identifier() == second.first && t.type() == second.second;
-    };
-
-    return replace_sublist(test_begin, test_end, search_from, replist);
+    return replace_sublist(match(first), match(second), search_from, replist);
 }
 
 
@@ -406,7 +414,7 @@ token_t token_list_t::operator[](size_t idx) const
 
     if (idx > size()) {
         auto i = (cend() - 1);
-        syntax_error(i->expression(), i->position());
+        syntax_error(expression(), i->position());
     }
 
     return data().operator[](idx);
@@ -421,7 +429,7 @@ token_t& token_list_t::operator[](size_t idx)
 
     if (idx > size()) {
         auto i = (cend() - 1);
-        syntax_error(i->expression(), i->position());
+        syntax_error(expression(), i->position());
     }
 
     return data().operator[](idx);
@@ -446,10 +454,10 @@ void token_list_t::_chekpos(size_t pos, size_t items)
 std::ostream& operator<<(std::ostream& os, const nu::token_list_t& tl)
 {
     for (const auto& e : tl.data()) {
-        if (e.identifier().empty())
+        if (tl.identifier(e).empty())
             os << (e.type() == nu::tkncl_t::SUBEXP_BEGIN ? "{" : "}");
         else
-            os << e.identifier();
+            os << tl.identifier(e);
     }
 
     return os;
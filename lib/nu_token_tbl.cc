@@ -0,0 +1,134 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+#include "nu_token_tbl.h"
+
+#include <cstring>
+
+
+/* -------------------------------------------------------------------------- */
+
+namespace nu {
+
+
+/* -------------------------------------------------------------------------- */
+
+const token_tbl_t::id_t token_tbl_t::npos;
+const token_tbl_t::id_t token_tbl_t::empty_id;
+
+
+/* -------------------------------------------------------------------------- */
+
+token_tbl_t::token_tbl_t(std::shared_ptr<std::string> expression)
+    : _expression(std::move(expression))
+    , _buckets(16, npos)
+{
+    if (!_expression)
+        _expression = std::make_shared<std::string>();
+
+    intern("", 0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t token_tbl_t::hash(const char* s, size_t size) noexcept
+{
+    // FNV-1a
+    size_t h = size_t(14695981039346656037ULL);
+
+    for (size_t i = 0; i < size; ++i) {
+        h ^= uint8_t(s[i]);
+        h *= size_t(1099511628211ULL);
+    }
+
+    return h;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+size_t token_tbl_t::bucket(const char* s, size_t size, size_t h) const noexcept
+{
+    const size_t mask = _buckets.size() - 1;
+
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        const id_t id = _buckets[i];
+
+        if (id == npos)
+            return i;
+
+        if (_hashes[id] == h && _ids[id].size() == size
+            && memcmp(_ids[id].data(), s, size) == 0) {
+            return i;
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+token_tbl_t::id_t token_tbl_t::find(const char* s, size_t size) const noexcept
+{
+    return _buckets[bucket(s, size, hash(s, size))];
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+token_tbl_t::id_t token_tbl_t::intern(const char* s, size_t size)
+{
+    const size_t h = hash(s, size);
+    size_t i = bucket(s, size, h);
+
+    if (_buckets[i] != npos)
+        return _buckets[i];
+
+    const id_t id = id_t(_ids.size());
+
+    _ids.emplace_back(s, size);
+    _hashes.push_back(h);
+
+    // Keep the load factor below 1/2
+    if (2 * _ids.size() > _buckets.size()) {
+        rehash();
+    } else {
+        _buckets[i] = id;
+    }
+
+    return id;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void token_tbl_t::rehash()
+{
+    _buckets.assign(2 * _buckets.size(), npos);
+
+    const size_t mask = _buckets.size() - 1;
+
+    for (id_t id = 0; id < _ids.size(); ++id) {
+        size_t i = _hashes[id] & mask;
+
+        while (_buckets[i] != npos)
+            i = (i + 1) & mask;
+
+        _buckets[i] = id;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace nu
+
+
+/* -------------------------------------------------------------------------- */
@@ -17,6 +17,7 @@
 #include <cmath>
 #include <functional>
 #include <iomanip>
+#include <stdexcept>
 
 
 /* -------------------------------------------------------------------------- */
@@ -27,24 +28,23 @@ namespace nu {
 /* -------------------------------------------------------------------------- */
 
 variant_t::variant_t(const char* s_value, type_t t, size_t vect_size)
-    : _type(t),
-      _vect_size(vect_size),
-      _vector_type(vect_size > 0)
+    : _type(t)
+    , _has_value(true)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
     if (is_number()) {
         if (s_value[0] == '\0')
             s_value = "0";
 
         if (is_integral())
-            _i_data.resize(vect_size, std::stoll(s_value));
+            _i = nu::stoll(s_value);
         else
-            _f_data.resize(vect_size, std::stod(s_value));
+            _f = nu::stod(s_value);
     } else {
-        _s_data.resize(vect_size, s_value);
+        _s = s_value;
     }
+
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -76,13 +76,11 @@ variant_t::variant_t(const char* value, size_t vect_size)
 
 variant_t::variant_t(const real_t& value, size_t vect_size)
     : _type(type_t::FLOAT)
-    , _vect_size(vect_size)
-    , _vector_type(vect_size >= 1)
+    , _has_value(true)
+    , _f(value)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
-    _f_data.resize(vect_size, value);
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -90,13 +88,11 @@ variant_t::variant_t(const real_t& value, size_t vect_size)
 
 variant_t::variant_t(const double_t& value, size_t vect_size)
     : _type(type_t::DOUBLE)
-    , _vect_size(vect_size)
-    , _vector_type(vect_size >= 1)
+    , _has_value(true)
+    , _f(value)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
-    _f_data.resize(vect_size, value);
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -104,13 +100,11 @@ variant_t::variant_t(const double_t& value, size_t vect_size)
 
 variant_t::variant_t(const integer_t& value, size_t vect_size)
     : _type(type_t::INTEGER)
-    , _vect_size(vect_size)
-    , _vector_type(vect_size >= 1)
+    , _has_value(true)
+    , _i(value)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
-    _i_data.resize(vect_size, value);
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -118,13 +112,11 @@ variant_t::variant_t(const integer_t& value, size_t vect_size)
 
 variant_t::variant_t(const bool_t& value, size_t vect_size)
     : _type(type_t::BOOLEAN)
-    , _vect_size(vect_size)
-    , _vector_type(vect_size >= 1)
+    , _has_value(true)
+    , _i(value)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
-    _i_data.resize(vect_size, value);
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -132,13 +124,11 @@ variant_t::variant_t(const bool_t& value, size_t vect_size)
 
 variant_t::variant_t(const long64_t& value, size_t vect_size)
     : _type(type_t::LONG64)
-    , _vect_size(vect_size)
-    , _vector_type(vect_size >= 1)
+    , _has_value(true)
+    , _i(value)
 {
-    if (vect_size < 1)
-        vect_size = 1;
-
-    _i_data.resize(vect_size, value);
+    if (vect_size > 0)
+        _fill(vect_size);
 }
 
 
@@ -184,7 +174,14 @@ const char* variant_t::get_type_desc(const type_t& type) noexcept
 
 variant_t& variant_t::operator+=(const variant_t& b)
 {
-    *this = *this + b;
+    // Strings are appended in place, with no copy of the left operand
+    if (is_scalar_str() && b.is_scalar_str()) {
+        _s += b._s;
+        _invalidate();
+    } else {
+        *this = *this + b;
+    }
+
     return *this;
 }
 
@@ -240,13 +237,13 @@ variant_t variant_t::increment()
     switch (get_type()) {
     case variant_t::type_t::FLOAT:
     case variant_t::type_t::DOUBLE: {
-        ++_f_data[0];
+        ++_at_f(0);
         return *this;
     }
 
     case variant_t::type_t::INTEGER:
     case variant_t::type_t::LONG64: {
-        ++_i_data[0];
+        ++_at_i(0);
         return *this;
     }
 
@@ -275,13 +272,13 @@ variant_t variant_t::decrement()
     switch (get_type()) {
     case variant_t::type_t::FLOAT:
     case variant_t::type_t::DOUBLE: {
-        --_f_data[0];
+        --_at_f(0);
         return *this;
     }
 
     case variant_t::type_t::INTEGER:
     case variant_t::type_t::LONG64: {
-        --_i_data[0];
+        --_at_i(0);
         return *this;
     }
 
@@ -663,21 +660,29 @@ std::ostream& operator<<(std::ostream& os, const variant_t& val)
 
 bool variant_t::is_integer(const std::string& value)
 {
-    if (value.empty())
+    return is_integer(value.data(), value.size());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool variant_t::is_integer(const char* value, size_t size)
+{
+    if (!size)
         return false;
 
     auto is_intexpr = [](char c) { return (c >= '0' && c <= '9'); };
 
-    char first_char = value.c_str()[0];
+    char first_char = value[0];
 
     if (!is_intexpr(first_char) && first_char != '-')
         return false;
 
-    if (value.size() == 1)
+    if (size == 1)
         return first_char != '-';
 
-    for (size_t i = 1; i < value.size(); ++i) {
-        const char c = value.c_str()[i];
+    for (size_t i = 1; i < size; ++i) {
+        const char c = value[i];
 
         if (!is_intexpr(c))
             return false;
@@ -691,26 +696,34 @@ bool variant_t::is_integer(const std::string& value)
 
 bool variant_t::is_real(const std::string& value)
 {
-    if (value.empty())
+    return is_real(value.data(), value.size());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+bool variant_t::is_real(const char* value, size_t size)
+{
+    if (!size)
         return false;
 
     auto is_intexpr = [](char c) { return (c >= '0' && c <= '9'); };
 
-    char first_char = value.c_str()[0];
+    char first_char = value[0];
 
     if (!is_intexpr(first_char) && first_char != '-' && first_char != '.') {
         return false;
     }
 
-    if (value.size() == 1)
+    if (size == 1)
         return first_char != '-' && first_char != '.';
 
     char old_c = 0;
     int point_cnt = 0;
     int E_cnt = 0;
 
-    for (size_t i = 0; i < value.size(); ++i) {
-        const char c = value.c_str()[i];
+    for (size_t i = 0; i < size; ++i) {
+        const char c = value[i];
 
         bool is_valid = (c == '-' && i == 0) || is_intexpr(c)
             || (c == '.' && point_cnt++ < 1)
@@ -734,40 +747,40 @@ bool variant_t::is_real(const std::string& value)
 
 /* -------------------------------------------------------------------------- */
 
-variant_t::variant_t(variant_t&& v)
-    : _type(std::move(v._type))
-    , _vect_size(std::move(v._vect_size))
-    , _vector_type(std::move(v._vector_type))
-    , _s_data(std::move(v._s_data))
-    , _i_data(std::move(v._i_data))
-    , _f_data(std::move(v._f_data))
+variant_t::variant_t(variant_t&& v) noexcept
+    : _type(v._type)
+    , _has_value(v._has_value)
+    , _i(v._i)
+    , _s(std::move(v._s))
+    , _array(std::move(v._array))
+    , _conv(std::move(v._conv))
 {
 }
 
 
 variant_t::variant_t(const variant_t& v)
     : _type(v._type)
-    , _vect_size(v._vect_size)
-    , _vector_type(v._vector_type)
-    , _s_data(v._s_data)
-    , _i_data(v._i_data)
-    , _f_data(v._f_data)
+    , _has_value(v._has_value)
+    , _i(v._i)
+    , _array(v._array)
 {
+    // The string of a number is just a cache of to_str()
+    if (!v.is_number())
+        _s = v._s;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
-variant_t& variant_t::operator=(variant_t&& v)
+variant_t& variant_t::operator=(variant_t&& v) noexcept
 {
     if (this != &v) {
-        _i_data = std::move(v._i_data);
-        _f_data = std::move(v._f_data);
-        _s_data = std::move(v._s_data);
-
-        _vector_type = std::move(v._vector_type);
-        _vect_size = std::move(v._vect_size);
-        _type = std::move(v._type);
+        _type = v._type;
+        _has_value = v._has_value;
+        _i = v._i;
+        _s = std::move(v._s);
+        _array = std::move(v._array);
+        _conv = std::move(v._conv);
     }
 
     return *this;
@@ -779,30 +792,85 @@ variant_t& variant_t::operator=(variant_t&& v)
 variant_t& variant_t::operator=(const variant_t& v)
 {
     if (this != &v) {
-        _i_data = v._i_data;
-        _f_data = v._f_data;
-        _s_data = v._s_data;
-
-        _vector_type = v._vector_type;
-        _vect_size = v._vect_size;
         _type = v._type;
+        _has_value = v._has_value;
+        _i = v._i;
+
+        if (!v.is_number())
+            _s = v._s;
+
+        _array = v._array;
+        _invalidate();
     }
 
     return *this;
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void variant_t::_make_array(size_t size)
+{
+    _invalidate();
+
+    if (_array) {
+        _unshare();
+        return;
+    }
+
+    // A scalar value becomes the first item of the vector
+    _array = std::make_shared<array_t>();
+    _array->size = size;
+
+    if (!_has_value)
+        return;
+
+    if (!is_number())
+        _array->s_data.push_back(std::move(_s));
+    else if (is_integral())
+        _array->i_data.push_back(_i);
+    else
+        _array->f_data.push_back(_f);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+void variant_t::_fill(size_t size)
+{
+    _make_array(size);
+
+    if (!is_number())
+        _array->s_data.resize(size, _array->s_data[0]);
+    else if (is_integral())
+        _array->i_data.resize(size, _array->i_data[0]);
+    else
+        _array->f_data.resize(size, _array->f_data[0]);
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 void variant_t::_resize(size_t size)
 {
+    _invalidate();
+
+    if (size == 0) {
+        _array.reset();
+        _has_value = false;
+        return;
+    }
+
+    _make_array(size);
+    _array->size = size;
+
     if (is_number()) {
         if (is_integral())
-            _i_data.resize(size);
+            _array->i_data.resize(size);
         else
-            _f_data.resize(size);
+            _array->f_data.resize(size);
     } else
-        _s_data.resize(size);
+        _array->s_data.resize(size);
 }
 
 
@@ -823,7 +891,20 @@ double_t variant_t::to_double(size_t idx) const
     if (is_number())
         return is_integral() ? double_t(_at_i(idx)) : _at_f(idx);
 
-    return nu::stod(_at_s(idx));
+    if (_conv && idx < _conv->parsed.size()
+        && (_conv->parsed[idx] & conversions_t::DOUBLE)) {
+        return _conv->f[idx];
+    }
+
+    // A string which is not a number does not convert
+    try {
+        return nu::stod(_at_s(idx));
+    } catch (std::logic_error&) {
+        rt_error_code_t::get_instance().throw_if(
+            true, rt_error_code_t::E_TYPE_MISMATCH);
+    }
+
+    return 0;
 }
 
 
@@ -834,7 +915,19 @@ long64_t variant_t::to_long64(size_t idx) const
     if (is_number())
         return is_integral() ? _at_i(idx) : long64_t(_at_f(idx));
 
-    return nu::stoll(_at_s(idx));
+    if (_conv && idx < _conv->parsed.size()
+        && (_conv->parsed[idx] & conversions_t::LONG64)) {
+        return _conv->i[idx];
+    }
+
+    try {
+        return nu::stoll(_at_s(idx));
+    } catch (std::logic_error&) {
+        rt_error_code_t::get_instance().throw_if(
+            true, rt_error_code_t::E_TYPE_MISMATCH);
+    }
+
+    return 0;
 }
 
 
@@ -843,16 +936,71 @@ long64_t variant_t::to_long64(size_t idx) const
 const string_t& variant_t::to_str(size_t idx) const
 {
     if (is_number()) {
-        _s_data.resize(idx + 1);
+        if (_conv && idx < _conv->s.size())
+            return _conv->s[idx];
+
+        _s = is_integral() ? format_integer(_at_i(idx))
+            : format_fixed(_at_f(idx));
 
-        _s_data[idx] = is_integral() ? std::to_string(_at_i(idx))
-            : std::to_string(_at_f(idx));
+        return _s;
     }
 
     return _at_s(idx);
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+void variant_t::cache_conversions()
+{
+    _invalidate();
+
+    if (!_has_value)
+        return;
+
+    // Reads the value through the const accessors, which neither
+    // unshare the vector storage nor drop the conversions
+    const variant_t& value = *this;
+
+    const size_t size = _array ? _array->size : 1;
+    std::unique_ptr<conversions_t> conv(new conversions_t);
+
+    if (is_number()) {
+        conv->s.reserve(size);
+
+        for (size_t idx = 0; idx < size; ++idx) {
+            conv->s.push_back(is_integral()
+                    ? format_integer(value._at_i(idx))
+                    : format_fixed(value._at_f(idx)));
+        }
+    } else {
+        conv->parsed.resize(size, 0);
+        conv->f.resize(size, 0);
+        conv->i.resize(size, 0);
+
+        // A string which is not a number keeps raising its error
+        // when it is converted
+        for (size_t idx = 0; idx < size; ++idx) {
+            const auto& str = value._at_s(idx);
+
+            try {
+                conv->f[idx] = nu::stod(str);
+                conv->parsed[idx] |= conversions_t::DOUBLE;
+            } catch (...) {
+            }
+
+            try {
+                conv->i[idx] = nu::stoll(str);
+                conv->parsed[idx] |= conversions_t::LONG64;
+            } catch (...) {
+            }
+        }
+    }
+
+    _conv = std::move(conv);
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 variant_t variant_t::operator[](size_t idx) const
@@ -0,0 +1,1138 @@
+//  
+// This file is part of nuExprEval
+// Copyright (c) Antonino Calderone (antonino.calderone@gmail.com)
+// All rights reserved.  
+// Licensed under the MIT License. 
+// See COPYING file in the project root for full license information.
+//
+
+/* -------------------------------------------------------------------------- */
+
+// Differential tests: each backend and optimization pass is run on a
+// corpus of generated expressions, and its results (values, types and
+// errors) are compared with the ones of the tree interpreter, which is
+// the reference implementation. Likewise, incremental recompilation is
+// compared with a full compilation, and the number conversions of
+// nu_string_tool.h with the ones of the C library.
+// The program exits with a non-zero status if any result differs
+
+#include "nu_arena.h"
+#include "nu_atom.h"
+#include "nu_expr_bin.h"
+#include "nu_expr_const_folder.h"
+#include "nu_expr_cse.h"
+#include "nu_expr_egraph.h"
+#include "nu_expr_empty.h"
+#include "nu_expr_eval.h"
+#include "nu_expr_flat.h"
+#include "nu_expr_function.h"
+#include "nu_expr_literal.h"
+#include "nu_expr_polynomial.h"
+#include "nu_expr_range_analysis.h"
+#include "nu_expr_simplifier.h"
+#include "nu_expr_slot_var.h"
+#include "nu_expr_subscrop.h"
+#include "nu_expr_type_inference.h"
+#include "nu_expr_unary_op.h"
+#include "nu_expr_var.h"
+#include "nu_string_tool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+
+/* -------------------------------------------------------------------------- */
+
+using namespace nu;
+
+
+/* -------------------------------------------------------------------------- */
+
+static size_t checks = 0;
+static size_t failures = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Counts a comparison, reporting the first failures of each test
+static void expect_same(const std::string& test, const std::string& expr,
+    const std::string& expected, const std::string& actual)
+{
+    static const size_t max_reported = 10;
+
+    ++checks;
+
+    if (expected == actual)
+        return;
+
+    if (++failures <= max_reported) {
+        std::cout << test << ": " << expr << std::endl
+                  << "  expected: " << expected << std::endl
+                  << "  actual:   " << actual << std::endl;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Values of the variables x and n: the first ones are the default
+// values, the others are corner cases of the rewriting rules
+static const double x_values[]
+    = { 2.5, -0.5, 0.0, -0.0, 1e300, -3.75, INFINITY, NAN };
+
+static const long64_t n_values[]
+    = { 7, -3, 0, 1, -1, 3037000499LL, 94906265LL, -2097152 };
+
+static const size_t x_count = sizeof(x_values) / sizeof(x_values[0]);
+static const size_t n_count = sizeof(n_values) / sizeof(n_values[0]);
+
+//! Number of sets of values of the variables
+static const size_t value_sets = x_count * n_count;
+
+
+/* -------------------------------------------------------------------------- */
+
+// Defines the variables the corpus refers to, with the values of a
+// given set: the variable types do not depend on it
+static void define_vars(ctx_t& ctx, size_t values)
+{
+    const auto x = x_values[values % x_count];
+    const auto n = n_values[(values / x_count) % n_count];
+
+    ctx.define("x", variant_t(x));
+    ctx.define("y", variant_t(x * 3 - 1));
+    ctx.define("n", variant_t(n));
+    ctx.define("m", variant_t(long64_t(n * 7 + 3)));
+    ctx.define("i", variant_t(integer_t(n)));
+    ctx.define("k", variant_t(long64_t((n < 0 ? -(n % 5) : n % 5) + 1)));
+    ctx.define("s", variant_t(values % 2 ? "12" : "abc"));
+    ctx.define("arr", variant_t(n, 10));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Declares the types of the variables defined by define_vars() to a pass
+template <class P> static void bind_vars(P& pass)
+{
+    pass.bind("x", variant_t::type_t::DOUBLE);
+    pass.bind("y", variant_t::type_t::DOUBLE);
+    pass.bind("n", variant_t::type_t::LONG64);
+    pass.bind("m", variant_t::type_t::LONG64);
+    pass.bind("i", variant_t::type_t::INTEGER);
+    pass.bind("k", variant_t::type_t::LONG64);
+    pass.bind("s", variant_t::type_t::STRING);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the value and type of the result of f evaluated in ctx, or
+// the error it raises
+template <class F> static std::string run_in(ctx_t& ctx, F f)
+{
+    std::stringstream ss;
+
+    try {
+        auto value = f(ctx);
+        ss << value << " : " << variant_t::get_type_desc(value.get_type());
+    } catch (runtime_error_t& e) {
+        ss << "runtime error " << e.get_error_code();
+    } catch (std::exception& e) {
+        ss << "error " << e.what();
+    }
+
+    // Side effects on the variables are part of the result.
+    // Reading them must not define them
+    auto value_of = [&ctx](const char* name) {
+        std::stringstream os;
+
+        if (ctx.is_defined(name))
+            os << ctx[name];
+        else
+            os << "undefined";
+
+        return os.str();
+    };
+
+    ss << " (n=" << value_of("n") << ", x=" << value_of("x") << ")";
+
+    return ss.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the value and type of the result of f, or the error it raises
+template <class F> static std::string run(F f, size_t values = 0)
+{
+    ctx_t ctx;
+    define_vars(ctx, values);
+
+    return run_in(ctx, f);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the compiled expression, nullptr if it is not valid
+static expr_any_t::handle_t compile(const std::string& expr)
+{
+    try {
+        tokenizer_t tknzr(expr);
+        expr_compiler_t compiler;
+        return compiler.compile(tknzr);
+    } catch (std::exception&) {
+    }
+
+    return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Binary expressions combining operands with side effects, errors and
+// mixed types, plus the cases of former bugs
+static std::vector<std::string> make_corpus()
+{
+    const std::vector<std::string> operands = { "x", "n", "i", "s", "2",
+        "0", "2.5", "\"q\"", "true", "-n", "pi()", "len(s)", "sin(x)",
+        "max(n, x)", "pstr(s, 1, \"z\")", "(1/0)", "undefvar", "++n", "--x",
+        "arr(1)", "sin(1, 2)", "(n * x - 1)" };
+
+    const std::vector<std::string> operators = { "+", "-", "*", "/", "^",
+        "div", "mod", "=", "<>", "<", ">=", "and", "or", "xor", "band",
+        "bshl" };
+
+    std::vector<std::string> corpus = { "++n + n", "n + ++n", "--x * x",
+        "++n bor n", "max(++n, 1) + n", "pow(n, ++n)", "min(++n, n)",
+        "0 and undefvar", "-1 or 3.5 + 0.5 div t", "1 + 2 * 3 - 4 / 5",
+        "left(s, 2) + right(s, 1) + mid(s, 2, 1)", "x()", "sin()",
+        "substr(s, 1)", "pstr(\"hello\", 2, \"J\")", "max(n, x - 2 - n)",
+        "min(n, 1 + -x * 2)", "max(x, (n * -x) - 1)" };
+
+    for (const auto& a : operands)
+        for (const auto& op : operators)
+            for (const auto& b : operands)
+                corpus.push_back(a + " " + op + " " + b);
+
+    return corpus;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Expressions repeating their subexpressions
+static std::vector<std::string> make_repeated_corpus()
+{
+    const std::vector<std::string> operands = { "x", "n", "s", "2",
+        "(x * n)", "sin(x * n)", "(x * n + 1)", "cos(x * n) ^ 2", "len(s)",
+        "++n", "rnd(1) * 0", "(1 / (x - x))", "max(x, n)" };
+
+    const std::vector<std::string> operators = { "+", "-", "*", "/", "^",
+        "<", "and" };
+
+    std::vector<std::string> corpus;
+
+    for (const auto& a : operands)
+        for (const auto& op : operators)
+            for (const auto& b : operands)
+                for (const auto& op2 : { " + ", " * " })
+                    corpus.push_back(a + " " + op + " " + b + op2 + a);
+
+    return corpus;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Arithmetic on typed variables and on the constants the algebraic
+// rules match
+static std::vector<std::string> make_algebraic_corpus()
+{
+    const std::vector<std::string> operands = { "x", "n", "i", "s", "0",
+        "1", "2", "3", "1.0", "2.0", "0.5", "4", "0.25", "3.0", "(x * x)",
+        "(n + 1)", "sin(x)", "int(x)", "-n", "(x - x)", "true", "pi()" };
+
+    const std::vector<std::string> operators = { "+", "-", "*", "/", "^" };
+
+    std::vector<std::string> corpus;
+
+    for (const auto& a : operands)
+        for (const auto& op : operators)
+            for (const auto& b : operands)
+                corpus.push_back(a + " " + op + " " + b);
+
+    for (const auto& a : operands) {
+        for (const auto& b : operands) {
+            corpus.push_back(a + " * " + b + " + x");
+            corpus.push_back("n + " + a + " * " + b);
+        }
+    }
+
+    return corpus;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Chains of operators the rules reassociate and factor
+static std::vector<std::string> make_chain_corpus()
+{
+    const std::vector<std::string> operands = { "x", "n", "m", "i", "1",
+        "2", "2.5", "s", "(n + 1)", "(x * 2)", "sin(x)", "(n * m)",
+        "(x + y)", "3", "true", "false" };
+
+    const std::vector<std::string> operators = { "+", "*", "-", "/" };
+
+    std::vector<std::string> corpus = { "n*m + n*3", "(n + 1) + 2",
+        "x*y + x*2", "log(exp(x))", "exp(x)*exp(y)", "(n + m) + (m + n)",
+        "2*n + 3*n", "(x + 1) + 2", "n*(m*2)*3", "s + s", "i*n + i*m",
+        "true - false", "true div false", "x + (true - false)",
+        "min(false - true, x) - 2", "true - false band 2.0",
+        "(true + false) * n", "false - true - n" };
+
+    for (const auto& a : operands)
+        for (const auto& op : operators)
+            for (const auto& b : operands)
+                for (const auto& op2 : operators)
+                    corpus.push_back(a + op + b + op2 + "n");
+
+    return corpus;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Divisions by expressions whose range may or may not include zero
+static std::vector<std::string> make_division_corpus()
+{
+    const std::vector<std::string> divisors = { "(1 + x^2)", "x",
+        "(x*x + 1)", "k", "(k + 1)", "(n^2 + 1)", "(i^2 + 1)", "exp(x)",
+        "(2 + sin(x))", "(x - x)", "(k - 1)", "(abs(x) + 0.5)",
+        "(n mod 3 + 3)", "(i*i + 1)", "cosh(x)", "max(k, 2)", "(1 + n)",
+        "(0.1 + x^2)", "(1e-300*exp(x))", "(k*k)", "(x^3 + 2)",
+        "(x^4 + 1e-320)", "(x^2 + x^2)", "(x^2)", "(i mod 7 - 10)" };
+
+    const std::vector<std::string> dividends = { "1", "x", "n", "i", "y" };
+
+    std::vector<std::string> corpus;
+
+    for (const auto& a : dividends)
+        for (const auto& d : divisors)
+            for (const auto& op : { " / ", " div ", " mod " })
+                corpus.push_back(a + op + d);
+
+    return corpus;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static void test_program(const std::vector<std::string>& corpus)
+{
+    for (const auto& text : corpus) {
+        auto expr = compile(text);
+
+        if (!expr)
+            continue;
+
+        expr_program_t program(expr);
+
+        const auto expected
+            = run([&](ctx_t& ctx) { return expr->eval(ctx); });
+
+        // A program is run twice, since it reuses its registers
+        for (int k = 0; k < 2; ++k) {
+            expect_same("program", text, expected,
+                run([&](ctx_t& ctx) { return program.run(ctx); }));
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Evaluates the expressions bound to slots in a slot_ctx_t, and the
+// original ones in a ctx_t to which the same changes are applied, so
+// that the addresses cached by the slots are checked to follow the
+// variables as they are defined, erased and cleared
+static void test_slots(const std::vector<std::string>& corpus)
+{
+    auto tbl = std::make_shared<slot_tbl_t>();
+    expr_slot_binder_t binder(tbl);
+
+    for (const auto& text : corpus) {
+        auto expr = compile(text);
+
+        if (!expr)
+            continue;
+
+        auto bound = binder(expr);
+
+        ctx_t ctx;
+        slot_ctx_t slot_ctx(tbl);
+
+        auto update = [&](std::function<void(ctx_t&)> f) {
+            f(ctx);
+            f(slot_ctx);
+
+            expect_same("slots", text,
+                run_in(ctx, [&](ctx_t& c) { return expr->eval(c); }),
+                run_in(slot_ctx, [&](ctx_t& c) { return bound->eval(c); }));
+        };
+
+        update([](ctx_t& c) { define_vars(c, 0); });
+        update([](ctx_t& c) { define_vars(c, 1); });
+        update([](ctx_t& c) { c.erase("x"); });
+        update([](ctx_t& c) {
+            c.erase("n");
+            c.erase("s");
+        });
+        update([](ctx_t& c) { define_vars(c, 2); });
+        update([](ctx_t& c) { c.clear(); });
+        update([](ctx_t& c) { define_vars(c, 3); });
+
+        // A plain ctx_t provides no slot: variables are looked up by name
+        expect_same("slots", text,
+            run([&](ctx_t& c) { return expr->eval(c); }, 4),
+            run([&](ctx_t& c) { return bound->eval(c); }, 4));
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Compiles the corpus drawing the nodes from arenas, then evaluates the
+// expressions once the compiler has been destroyed and, after that,
+// once the arenas are held by the expressions only
+static void test_arena(const std::vector<std::string>& corpus)
+{
+    std::vector<std::pair<std::string, expr_any_t::handle_t>> exprs;
+
+    auto first = std::make_shared<arena_t>();
+    auto second = std::make_shared<arena_t>();
+
+    {
+        expr_compiler_t compiler(first);
+
+        for (const auto& text : corpus) {
+            // A long-lived compiler switches arena for each batch
+            if (exprs.size() == corpus.size() / 2)
+                compiler.set_arena(second);
+
+            try {
+                tokenizer_t tknzr(text);
+                exprs.emplace_back(text, compiler.compile(tknzr));
+            } catch (std::exception&) {
+            }
+        }
+    }
+
+    expect_same("arena", "blocks", "1 1",
+        std::to_string(first->blocks() > 0) + " "
+            + std::to_string(second->blocks() > 0));
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const auto& e : exprs) {
+            auto expr = compile(e.first);
+
+            expect_same("arena", e.first,
+                run([&](ctx_t& ctx) { return expr->eval(ctx); }),
+                run([&](ctx_t& ctx) { return e.second->eval(ctx); }));
+        }
+
+        first.reset();
+        second.reset();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Each expression is compared with one which brackets its operators the
+// way the parser applies them. The arguments following the first one of
+// a function call are parsed as the former rewriter did (see
+// expr_compiler_t::parser_t); &H0 is the 0 of a missing operand
+static void test_parser()
+{
+    const std::vector<std::pair<std::string, std::string>> cases = {
+        { "max(1, 2 * -1)", "max(1, (2 * &H0) - 1)" },
+        { "max(1, 1 = -1)", "max(1, (1 = &H0) - 1)" },
+        { "max(1, \"3.5\" = -1)", "max(1, (\"3.5\" = &H0) - 1)" },
+        { "left(\"ab\", 1 div -1 or 3)",
+            "left(\"ab\", (1 div &H0) - (1 or 3))" },
+        { "right(1, 7 / -0.0 xor 0.1)", "right(1, (7 / &H0) - (0.0 xor 0.1))" },
+        { "left(\"abc\", -1 + 3)", "left(\"abc\", &H0 - (1 + 3))" },
+        { "min(1, 2 - 2 bor \"12\")", "min(1, 2 - (2 bor \"12\"))" },
+        { "pow(&HFF, -1 or 3)", "pow(&HFF, &H0 - (1 or 3))" },
+        { "mid(\"ab\", sqrt(2.5), -1 ^ 0)",
+            "mid(\"ab\", sqrt(2.5), &H0 - (1 ^ 0))" },
+        { "max(0, 10 - 2 - 3)", "max(0, 10 - (2 - 3))" },
+        { "max(0, 2 * 3 + 1)", "max(0, 2 * (3 + 1))" },
+        { "max(2 * 3 + 1, 0)", "max((2 * 3) + 1, 0)" },
+        { "min(3, 1 + -abs(2))", "min(3, (1 + &H0) - abs(2))" },
+        { "min(9, abs(2 * -max(3, 7)))", "min(9, abs((2 * &H0) - max(3, 7)))" },
+        { "max(-9, 2 * -1 + 5 * -3 - 7)",
+            "max(-9, (2 * &H0) - (1 + (5 * &H0)))" },
+        { "max(0, 1E+2 * 3)", "max(0, 300.0)" },
+        { "max(1, +5)", "max(1, &H0 + 5)" },
+
+        // The former rewriter could group an operand in brackets with
+        // the wrong operator, or reject the expression
+        { "1 + (4) * (2)", "1 + (4 * 2)" },
+        { "3 and 0.1 * 1 + (-1)", "3 and ((0.1 * 1) + (-1))" },
+        { "2 and (sqr(2)) / (true / .5)", "2 and (sqr(2) / (true / .5))" },
+        { "pow(1, sqrt(1)) ^ sqrt(1)", "(pow(1, sqrt(1))) ^ (sqrt(1))" },
+        { "3.0 xor \"AbC\" <> substr(\"3.5\", .5, false) ^ sqr(0.5)",
+            "3.0 xor (\"AbC\" <> (substr(\"3.5\", .5, false) ^ sqr(0.5)))" },
+        { "\"ab\" ^ 2", "\"ab\" - 2" }
+    };
+
+    for (const auto& c : cases) {
+        auto expr = compile(c.first);
+        auto expected = compile(c.second);
+
+        expect_same("parser", c.first, expected ? "valid" : "invalid",
+            expr ? "valid" : "invalid");
+
+        if (!expr || !expected)
+            continue;
+
+        expect_same("parser", c.first,
+            run([&](ctx_t& ctx) { return expected->eval(ctx); }),
+            run([&](ctx_t& ctx) { return expr->eval(ctx); }));
+    }
+
+    // A repeated operator, or an operator following "(" other than a
+    // sign, remains a syntax error
+    for (const auto& text : { "max(0, 1 - -1)", "max(0, (* 1))",
+             "max(0, min(* 2, 3))", "2 * -1" }) {
+        expect_same(
+            "parser", text, "invalid", compile(text) ? "valid" : "invalid");
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Built-in operators are bound to their opcode only while their entry
+// of the operator table is the built-in one
+static void test_operator_override()
+{
+    auto& optbl = global_operator_tbl_t::get_instance();
+    const auto builtin = optbl["+"];
+
+    auto opcode = [](const expr_any_t::handle_t& expr) {
+        auto bin = dynamic_cast<const expr_bin_t*>(expr.get());
+        return bin ? std::to_string(int(bin->opcode())) : "?";
+    };
+
+    const auto add = std::to_string(int(bin_opcode_t::ADD));
+    const auto custom = std::to_string(int(bin_opcode_t::CUSTOM));
+
+    expect_same("operator override", "built-in", add, opcode(compile("n + 1")));
+
+    optbl["+"] = [](const variant_t& a, const variant_t& b) {
+        return variant_t(a.to_long64() * 10 + b.to_long64());
+    };
+
+    auto expr = compile("n + 1");
+
+    expect_same("operator override", "replaced", custom, opcode(expr));
+    expect_same("operator override", "n + 1",
+        run([](ctx_t&) { return variant_t(long64_t(71)); }),
+        run([&](ctx_t& ctx) { return expr->eval(ctx); }));
+
+    optbl["+"] = builtin;
+
+    expect_same("operator override", "restored", add, opcode(compile("n + 1")));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Checks that atoms share an entry of the atom table while any of them
+// is alive, that the entry is removed with the last one, and that a
+// string can be interned again while its previous entry is released
+static void test_atoms()
+{
+    const auto before = atom_t::interned();
+
+    auto count = [before]() {
+        return std::to_string(atom_t::interned() - before);
+    };
+
+    {
+        atom_t a("nu atom test a");
+        atom_t b(std::string("nu atom test a"));
+        atom_t c("nu atom test c");
+
+        expect_same("atoms", "a == b, a != c", "1 1",
+            std::to_string(a == b) + " " + std::to_string(a != c));
+        expect_same("atoms", "a, c", "2", count());
+
+        {
+            atom_t d(c);
+            c = atom_t();
+            expect_same("atoms", "copy of c", "2", count());
+        }
+
+        expect_same("atoms", "a", "1", count());
+    }
+
+    expect_same("atoms", "none", "0", count());
+
+    {
+        atom_t a("nu atom test a");
+        expect_same("atoms", "a interned again", "nu atom test a 1",
+            a.str() + " " + count());
+    }
+
+    // The last atom of a string is released by a thread while the other
+    // ones intern it again (which needs more than one processor)
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(4);
+
+    for (size_t t = 0; t < errors.size(); ++t) {
+        threads.emplace_back([t, &errors]() {
+            for (int k = 0; k < 100000; ++k) {
+                atom_t a("nu atom test race");
+                atom_t b(std::string("nu atom test race"));
+
+                if (a != b || a.str() != "nu atom test race"
+                    || a.hash() != std::hash<std::string>()(a.str())) {
+                    errors[t] = "atoms differ";
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& error : errors)
+        expect_same("atoms", "re-interning", "", error);
+
+    expect_same("atoms", "none after re-interning", "0", count());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+static void test_flat(const std::vector<std::string>& corpus)
+{
+    for (const auto& text : corpus) {
+        auto expr = compile(text);
+
+        if (!expr)
+            continue;
+
+        expr_flat_t flat(expr);
+
+        expect_same("flat", text,
+            run([&](ctx_t& ctx) { return expr->eval(ctx); }),
+            run([&](ctx_t& ctx) { return flat.eval(ctx); }));
+    }
+
+    // Nested too deeply for the tree interpreter, which is replaced by
+    // the program: both evaluate without native recursion
+    std::string deep;
+
+    for (int k = 0; k < 100000; ++k)
+        deep += "(1 + ";
+
+    deep += "x";
+    deep += std::string(100000, ')');
+
+    auto expr = compile(deep);
+    expr_program_t program(expr);
+    expr_flat_t flat(expr);
+
+    expect_same("flat", "(1 + (1 + ... x))",
+        run([&](ctx_t& ctx) { return program.run(ctx); }),
+        run([&](ctx_t& ctx) { return flat.eval(ctx); }));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Runs a rewriter pass on each expression of the corpus and compares
+// the rewritten tree with the original one, evaluating both with the
+// first sets of values in a row
+template <class P>
+static void test_pass(const std::string& test,
+    const std::vector<std::string>& corpus, P pass, size_t sets = 2,
+    bool nan_sign = true)
+{
+    // The sign of a NaN computed from two NaN operands depends on the
+    // order the compiler gives them, which passes evaluating in plain
+    // doubles may not share with variant_t
+    auto result = [nan_sign](std::string s) {
+        size_t pos = 0;
+
+        while (!nan_sign && (pos = s.find("-nan")) != std::string::npos)
+            s.erase(pos, 1);
+
+        return s;
+    };
+
+    for (const auto& text : corpus) {
+        auto expr = compile(text);
+
+        if (!expr)
+            continue;
+
+        auto rewritten = pass(expr);
+
+        for (size_t values = 0; values < sets; ++values) {
+            expect_same(test, text,
+                result(run(
+                    [&](ctx_t& ctx) { return expr->eval(ctx); }, values)),
+                result(run([&](ctx_t& ctx) { return rewritten->eval(ctx); },
+                    values)));
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Evaluates expr, returning its value or the error it raises
+static variant_t eval_or_error(
+    const expr_any_t::handle_t& expr, size_t values, std::string& error)
+{
+    ctx_t ctx;
+    define_vars(ctx, values);
+
+    try {
+        return expr->eval(ctx);
+    } catch (runtime_error_t& e) {
+        error = "runtime error " + std::to_string(e.get_error_code());
+    } catch (std::exception& e) {
+        error = std::string("error ") + e.what();
+    }
+
+    return variant_t();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Polynomials are evaluated in a different order, so their results are
+// compared allowing for rounding errors
+static void test_polynomial()
+{
+    const std::vector<std::string> corpus = {
+        "y*x^4 + n*x^3 + m*x^2 + i*x + 1", "3*x^2 - 2*x + 1", "x^2 + x",
+        "1 + x + x^2/2", "2*x*x - y*x^3*2 + 7 - x", "x^2 + y^2", "s + x^2",
+        "x^12 + 2*x^11 + 3*x^10 + 4*x^9 + 5*x^8 + 6*x^7 + 7*x^6 + 8*x^5"
+        " + 9*x^4 + 10*x^3 + 11*x^2 + 12*x + 13",
+        "(y + n)*x^3 - x^3 + sin(y)*x^2 + 1", "x + 1", "x^2 + n*x",
+        "x^3 + undefvar*x^2", "x^2 + ++n*x", "x^2 + (1/0)*x" };
+
+    expr_polynomial_t polynomial(8);
+    bind_vars(polynomial);
+
+    for (const auto& text : corpus) {
+        auto expr = compile(text);
+
+        if (!expr)
+            continue;
+
+        auto rewritten = polynomial(expr);
+
+        for (size_t values = 0; values < value_sets; ++values) {
+            // Rounding errors of infinite values are not bounded
+            if (!std::isfinite(x_values[values % x_count])
+                || std::fabs(x_values[values % x_count]) > 1e100) {
+                continue;
+            }
+
+            std::string expected, actual;
+            auto a = eval_or_error(expr, values, expected);
+            auto b = eval_or_error(rewritten, values, actual);
+
+            if (expected.empty() && actual.empty()) {
+                const double x = a.to_double();
+                const double y = b.to_double();
+
+                expected = variant_t::get_type_desc(a.get_type());
+                actual = variant_t::get_type_desc(b.get_type());
+
+                if (std::fabs(x - y) > 1e-9 * std::max(1.0, std::fabs(x))) {
+                    expected += " " + std::to_string(x);
+                    actual += " " + std::to_string(y);
+                }
+            }
+
+            expect_same("polynomial", text, expected, actual);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Writes the structure of a compiled expression to os
+static void dump(std::ostream& os, const expr_any_t::handle_t& expr)
+{
+    const auto node = expr.get();
+
+    if (auto bin = dynamic_cast<const expr_bin_t*>(node)) {
+        os << "(" << int(bin->opcode()) << " ";
+        dump(os, bin->left());
+        os << " ";
+        dump(os, bin->right());
+        os << ")";
+    } else if (auto literal = dynamic_cast<const expr_literal_t*>(node)) {
+        os << "L[" << literal->value() << ":"
+           << int(literal->value().get_type()) << "]";
+    } else if (auto var = dynamic_cast<const expr_var_t*>(node)) {
+        os << "V[" << var->name() << "]";
+    } else if (auto unary = dynamic_cast<const expr_unary_op_t*>(node)) {
+        os << "U[" << unary->op_name() << "]";
+        dump(os, unary->operand());
+    } else if (dynamic_cast<const expr_empty_t*>(node)) {
+        os << "E";
+    } else if (dynamic_cast<const expr_subscrop_t*>(node)
+        || dynamic_cast<const expr_function_t*>(node)) {
+        os << (dynamic_cast<const expr_subscrop_t*>(node) ? "S[" : "F[")
+           << node->name() << "](";
+
+        for (const auto& arg : node->get_args()) {
+            dump(os, arg);
+            os << ",";
+        }
+
+        os << ")";
+    } else {
+        os << "?";
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the structure of the expression compiled by f, or the error
+// it raises, followed by the tokens, which are read after calling f
+template <class F>
+static std::string structure(F f, const token_list_t& tokens)
+{
+    std::stringstream ss;
+
+    try {
+        dump(ss, f());
+    } catch (std::exception& e) {
+        ss << "error " << e.what();
+    }
+
+    ss << " |";
+
+    for (const auto& t : tokens.data()) {
+        ss << " " << int(t.type()) << ":" << t.position() << ":"
+           << t.length() << ":" << tokens.identifier(t);
+    }
+
+    return ss.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Applies random edits to the texts of the corpus, updating their
+// compilation, and compares it with a full compilation of the new text
+static void test_incremental(const std::vector<std::string>& corpus)
+{
+    static const size_t rounds = 3000;
+    static const size_t edits = 12;
+
+    const std::vector<std::string> snippets = { "(", ")", "+", "-", "*",
+        " ", "1", "2.5", ".", "E", "e+", "\"", "ab", "sin(", ",", "and",
+        " or ", "<", ">=", "'", "x", "1E", "\n", "mod", "0", "&H1F", "[",
+        "]", "++", "-(" };
+
+    auto full = [](const std::string& text) {
+        tokenizer_t tknzr(text);
+        token_list_t tokens;
+        tknzr.get_tknlst(tokens);
+
+        return structure(
+            [&text]() {
+                tokenizer_t tknzr(text);
+                expr_compiler_t compiler;
+                return compiler.compile(tknzr);
+            },
+            tokens);
+    };
+
+    std::mt19937 rng(1);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        auto text = corpus[rng() % corpus.size()];
+
+        expr_compiler_t compiler;
+        expr_compiler_t::compilation_t c;
+
+        auto actual = structure(
+            [&]() {
+                tokenizer_t tknzr(text);
+                return compiler.compile(tknzr, c);
+            },
+            c.tokens());
+
+        expect_same("incremental", text, full(text), actual);
+
+        for (size_t edit = 0; edit < edits; ++edit) {
+            const size_t pos = rng() % (text.size() + 1);
+            const size_t left = text.size() - pos;
+            const size_t erased
+                = rng() % 3 == 0 ? 0 : rng() % (std::min<size_t>(left, 5) + 1);
+
+            std::string inserted;
+
+            for (size_t n = rng() % 3; n > 0; --n)
+                inserted += snippets[rng() % snippets.size()];
+
+            if (rng() % 10 == 0) {
+                const auto& other = corpus[rng() % corpus.size()];
+                inserted += other.substr(rng() % other.size(), rng() % 20);
+            }
+
+            const auto before = text;
+            text = text.substr(0, pos) + inserted + text.substr(pos + erased);
+
+            // The tokens are dumped after recompile() updated them
+            actual = structure(
+                [&]() {
+                    tokenizer_t tknzr(text);
+                    return compiler.recompile(
+                        tknzr, c, pos, erased, inserted.size());
+                },
+                c.tokens());
+
+            expect_same(
+                "incremental", before + " -> " + text, full(text), actual);
+        }
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Returns the bits of the double returned by f, or the error it raises
+template <class F> static std::string parsed(F f)
+{
+    std::stringstream ss;
+
+    try {
+        const double x = f();
+        unsigned long long bits = 0;
+        std::memcpy(&bits, &x, sizeof(bits));
+        ss << std::hex << bits;
+    } catch (std::invalid_argument&) {
+        ss << "invalid argument";
+    } catch (std::out_of_range&) {
+        ss << "out of range";
+    }
+
+    return ss.str();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+// Compares the number conversions with the ones of the C library,
+// which std::stod(), std::stoll() and std::to_string() are based on
+static void test_number_conversions()
+{
+    static const size_t rounds = 50000;
+
+    std::vector<std::string> texts = { "0", "-0", "1", "+1", "0.1",
+        ".5", "5.", ".", "-", "", " 12", "12 ", "12abc", "1e", "1e+",
+        "1E-5", "1e308", "1.7976931348623157e308", "1.8e308", "1e400",
+        "1e-400", "4.9406564584124654e-324", "2.2250738585072011e-308",
+        "9007199254740993", "9007199254740993.0000000000000001",
+        "123456789012345678901234567890", "0.000000000000000000001",
+        "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+        "-9223372036854775809", "0x1p3", "0x10", "inf", "-nan", "007",
+        "1,5", "\t-3" };
+
+    std::vector<double> values = { 0.0, -0.0, 0.5, 1.5, 2.5, -2.5,
+        0.0000005, 0.0000015, 0.0000025, 1e-7, 999999.9999995, 1e15,
+        9007199254740993.0, 1e22, 1e300, 1.7976931348623157e308,
+        4.9406564584124654e-324, INFINITY, -INFINITY, NAN, -NAN };
+
+    std::mt19937_64 rng(1);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        std::string text;
+
+        if (rng() % 4 == 0)
+            text += "-";
+
+        for (size_t n = rng() % 24; n > 0; --n)
+            text += char('0' + rng() % 10);
+
+        if (rng() % 2) {
+            text += ".";
+
+            for (size_t n = rng() % 24; n > 0; --n)
+                text += char('0' + rng() % 10);
+        }
+
+        if (rng() % 3 == 0)
+            text += "e" + std::to_string(int(rng() % 700) - 350);
+
+        texts.push_back(text);
+
+        // Any bit pattern, then a value with few decimal digits
+        const auto bits = rng();
+        double x = 0;
+        std::memcpy(&x, &bits, sizeof(x));
+        values.push_back(x);
+        values.push_back(double(long64_t(rng() % 2000000) - 1000000) / 64);
+    }
+
+    for (const auto& text : texts) {
+        expect_same("stod", text,
+            parsed([&text]() { return std::stod(text); }),
+            parsed([&text]() { return nu::stod(text); }));
+
+        std::string expected, actual;
+
+        try {
+            expected = std::to_string(std::stoll(text));
+        } catch (std::exception& e) {
+            expected = std::string("error ") + typeid(e).name();
+        }
+
+        try {
+            actual = std::to_string(nu::stoll(text));
+        } catch (std::exception& e) {
+            actual = std::string("error ") + typeid(e).name();
+        }
+
+        expect_same("stoll", text, expected, actual);
+    }
+
+    char buffer[512];
+
+    for (const auto& x : values) {
+        for (int prec : { 6, 0, 2, 17 }) {
+            std::snprintf(buffer, sizeof(buffer), "%.*f", prec, x);
+            expect_same("format_fixed", parsed([&x]() { return x; }), buffer,
+                nu::format_fixed(x, prec));
+        }
+
+        const auto n = long64_t(x);
+
+        if (std::fabs(x) < 9e18) {
+            expect_same("format_integer", std::to_string(n),
+                std::to_string(n), nu::format_integer(n));
+        }
+    }
+
+    // Precisions beyond the bounded one print the same digits
+    char wide[1400];
+
+    for (const auto& x : { 1.0 / 3, -1.7976931348623157e308, 5e-324 }) {
+        std::snprintf(
+            wide, sizeof(wide), "%.*f", int(FORMAT_FIXED_MAX_PREC), x);
+
+        for (int prec : { int(FORMAT_FIXED_MAX_PREC), 2000, INT_MAX }) {
+            expect_same("format_fixed", std::to_string(prec), wide,
+                nu::format_fixed(x, prec));
+        }
+    }
+
+    // strp() formats with the absolute value of its precision, which
+    // must neither allocate unbounded buffers nor overflow
+    for (const auto& text : { "strp(x, 2000000000)", "strp(x, -2147483648)",
+             "strp(x, 1e10)", "strp(x, -1e10)", "strp(1/3, 2000000000)" }) {
+        auto expr = compile(text);
+
+        const auto actual = run([&](ctx_t& ctx) {
+            auto value = expr->eval(ctx);
+            return variant_t(integer_t(value.to_str().size() <= 1400));
+        });
+
+        expect_same("strp", text,
+            run([](ctx_t&) { return variant_t(integer_t(1)); }), actual);
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+int main()
+{
+    const auto corpus = make_corpus();
+
+    test_program(corpus);
+    test_slots(corpus);
+    test_arena(corpus);
+    test_flat(corpus);
+
+    test_pass("const folder", corpus, expr_const_folder_t());
+
+    expr_type_inference_t types;
+    bind_vars(types);
+
+    test_pass("type inference", corpus, types, 2, false);
+    test_pass("type inference", make_algebraic_corpus(), types, value_sets,
+        false);
+    test_pass("type inference", make_chain_corpus(), types, value_sets,
+        false);
+    test_pass("type inference",
+        { "-1*x^4 + sin(y)*x^3 + y*x^2 + 0*x + 0.5", "x^2 - x*x", "-x^3",
+            "0*x", "x*0 - y^2", "x - x^2*x", "2*x^2 + y - x^3" },
+        types, value_sets, false);
+
+    test_pass("cse", make_repeated_corpus(), expr_cse_t());
+
+    expr_simplifier_t simplifier;
+    bind_vars(simplifier);
+
+    test_pass("simplifier", make_algebraic_corpus(), simplifier, value_sets);
+
+    test_polynomial();
+
+    expr_egraph_t egraph;
+    bind_vars(egraph);
+
+    test_pass("e-graph", make_chain_corpus(), egraph, value_sets);
+
+    expr_range_analysis_t ranges;
+    bind_vars(ranges);
+    ranges.bind("k", variant_t::type_t::LONG64, 1, 5);
+
+    test_pass("range analysis", make_division_corpus(), ranges, value_sets);
+
+    test_parser();
+    test_operator_override();
+    test_atoms();
+
+    test_incremental(corpus);
+
+    test_number_conversions();
+
+    std::cout << checks << " checks, " << failures << " failures" << std::endl;
+
+    return failures ? 1 : 0;
+}
+
+
+/* -------------------------------------------------------------------------- */